@@ -0,0 +1,40 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// buffer_access_strategy.cpp
+//
+// Identification: src/buffer/buffer_access_strategy.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "buffer/buffer_access_strategy.h"
+
+#include <algorithm>
+
+namespace bustub {
+
+BufferAccessStrategy::BufferAccessStrategy(BufferAccessStrategyType type)
+    : type_(type), ring_size_(type == BufferAccessStrategyType::BULKWRITE ? BULKWRITE_RING_SIZE : BULKREAD_RING_SIZE) {}
+
+auto BufferAccessStrategy::GetRingFrames(size_t pool_size, size_t num_instances) const -> size_t {
+  return std::max<size_t>(std::min(ring_size_ / num_instances, pool_size / RING_POOL_FRACTION), 2);
+}
+
+auto BufferAccessStrategy::NextSlot(uint32_t instance_index, size_t ring_frames) -> RingSlot * {
+  Ring *ring;
+  {
+    std::lock_guard<std::mutex> lock(latch_);
+    ring = &rings_[instance_index];
+    if (ring->slots_.empty()) {
+      ring->slots_.resize(ring_frames);
+    }
+  }
+  RingSlot *slot = &ring->slots_[ring->next_];
+  ring->next_ = (ring->next_ + 1) % ring->slots_.size();
+  return slot;
+}
+
+}  // namespace bustub
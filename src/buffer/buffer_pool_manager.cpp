@@ -0,0 +1,52 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// buffer_pool_manager.cpp
+//
+// Identification: src/buffer/buffer_pool_manager.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "buffer/buffer_pool_manager.h"
+
+#include <fstream>
+
+#include "common/logger.h"
+
+namespace bustub {
+
+// The file is just the page ids, in the order GetResidentPages() returned them.
+
+auto BufferPoolManager::DumpResidentPages(const std::string &file_name) -> bool {
+  std::vector<page_id_t> page_ids = GetResidentPages();
+  std::ofstream file(file_name, std::ios::binary | std::ios::trunc);
+  file.write(reinterpret_cast<const char *>(page_ids.data()), page_ids.size() * sizeof(page_id_t));
+  file.close();
+  if (file.fail()) {
+    LOG_DEBUG("I/O error while writing the resident pages");
+    return false;
+  }
+  return true;
+}
+
+auto BufferPoolManager::PreloadResidentPages(const std::string &file_name) -> bool {
+  std::ifstream file(file_name, std::ios::binary | std::ios::ate);
+  if (!file.is_open()) {
+    return false;
+  }
+  auto size = static_cast<size_t>(file.tellg());
+  std::vector<page_id_t> page_ids(size / sizeof(page_id_t));
+  file.seekg(0);
+  file.read(reinterpret_cast<char *>(page_ids.data()), page_ids.size() * sizeof(page_id_t));
+  if (file.fail()) {
+    LOG_DEBUG("I/O error while reading the resident pages");
+    return false;
+  }
+  PreloadPages(std::move(page_ids));
+  return true;
+}
+
+}  // namespace bustub
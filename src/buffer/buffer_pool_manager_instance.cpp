@@ -13,6 +13,17 @@
 
 #include "buffer/buffer_pool_manager_instance.h"
 
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <deque>
+#include <future>  // NOLINT
+#include <new>
+#include <utility>
+#include <vector>
+
+#include "buffer/clock_replacer.h"
+#include "buffer/lru_k_replacer.h"
 #include "common/macros.h"
 
 #include "common/logger.h"
@@ -20,170 +31,465 @@
 namespace bustub {
 // log_manager头文件那里已经有默认值nullptr
 BufferPoolManagerInstance::BufferPoolManagerInstance(size_t pool_size, DiskManager *disk_manager,
-                                                     LogManager *log_manager)
-    : BufferPoolManagerInstance(pool_size, 1, 0, disk_manager, log_manager) {}
+                                                     LogManager *log_manager, const BufferPoolOptions &options)
+    : BufferPoolManagerInstance(pool_size, 1, 0, disk_manager, log_manager, options) {}
 
 BufferPoolManagerInstance::BufferPoolManagerInstance(size_t pool_size, uint32_t num_instances, uint32_t instance_index,
-                                                     DiskManager *disk_manager, LogManager *log_manager)
+                                                     DiskManager *disk_manager, LogManager *log_manager,
+                                                     const BufferPoolOptions &options)
     : pool_size_(pool_size),
       num_instances_(num_instances),
       instance_index_(instance_index),
       next_page_id_(instance_index),
+      options_(options),
+      arena_(pool_size, options.use_huge_pages_),
       disk_manager_(disk_manager),
       log_manager_(log_manager) {
   BUSTUB_ASSERT(num_instances > 0, "If BPI is not part of a pool, then the pool size should just be 1");
   BUSTUB_ASSERT(
       instance_index < num_instances,
       "BPI index cannot be greater than the number of BPIs in the pool. In non-parallel case, index should just be 1.");
-  // We allocate a consecutive memory space for the buffer pool.
-  pages_ = new Page[pool_size_];
-  replacer_ = new LRUReplacer(pool_size);
+  // We allocate a consecutive memory space for the buffer pool: the data in the arena, page-aligned, and the
+  // descriptors in an array of their own, cache-line-aligned.
+  pages_ = static_cast<Page *>(::operator new[](pool_size_ * sizeof(Page), std::align_val_t{alignof(Page)}));
+  for (size_t i = 0; i < pool_size_; ++i) {
+    new (&pages_[i]) Page(arena_.GetFrameData(static_cast<frame_id_t>(i)));
+  }
+  switch (options_.replacer_type_) {
+    case ReplacerType::LRU_K:
+      replacer_ = new LRUKReplacer(pool_size, options_.lru_k_, options_.lru_k_correlated_period_);
+      break;
+    case ReplacerType::CLOCK:
+      replacer_ = new ClockReplacer(pool_size);
+      break;
+    case ReplacerType::LRU:
+    default:
+      replacer_ = new LRUReplacer(pool_size);
+      break;
+  }
 
   // Initially, every page is in the free list.
   for (size_t i = 0; i < pool_size_; ++i) {
     // 强制类型转换
     free_list_.emplace_back(static_cast<int>(i));
   }
+  free_frames_ = pool_size_;
+
+  if (options_.enable_cleaner_) {
+    cleaner_thread_ = std::thread(&BufferPoolManagerInstance::CleanerLoop, this);
+  }
+  if (!options_.warmup_file_.empty()) {
+    PreloadResidentPages(options_.warmup_file_);
+  }
 }
 
 BufferPoolManagerInstance::~BufferPoolManagerInstance() {
-  delete[] pages_;
+  preload_stop_ = true;
+  {
+    std::lock_guard<std::mutex> lock(preload_latch_);
+    if (preload_thread_.joinable()) {
+      preload_thread_.join();
+    }
+  }
+  if (!options_.warmup_file_.empty()) {
+    DumpResidentPages(options_.warmup_file_);
+  }
+  {
+    std::lock_guard<std::mutex> lock(prefetch_latch_);
+    prefetch_stop_ = true;
+  }
+  prefetch_cv_.notify_one();
+  if (prefetch_thread_.joinable()) {
+    prefetch_thread_.join();
+  }
+  if (cleaner_thread_.joinable()) {
+    {
+      std::lock_guard<std::mutex> lock(cleaner_latch_);
+      cleaner_stop_ = true;
+    }
+    cleaner_cv_.notify_one();
+    cleaner_thread_.join();
+  }
+  for (size_t i = 0; i < pool_size_; ++i) {
+    pages_[i].~Page();
+  }
+  ::operator delete[](pages_, std::align_val_t{alignof(Page)});
   delete replacer_;
 }
 
 auto BufferPoolManagerInstance::FlushPgImp(page_id_t page_id) -> bool {
   // Make sure you call DiskManager::WritePage!
-  std::lock_guard<std::mutex> lock(latch_);
   if (page_id == INVALID_PAGE_ID) {
     // LOG_DEBUG("因为invlid不能写入数据的，%d", page_id);
     return false;
   }
-  auto iter = page_table_.find(page_id);
+  // Pinning keeps the frame from being evicted while we write it, without holding any latch across the I/O.
+  Page *page = PinResidentPage(page_id);
   // 如果page不在页表中
-  if (iter == page_table_.end()) {
+  if (page == nullptr) {
     return false;
   }
-  // 在页表中找到frameid，然后根据他获取Page对象
-  frame_id_t frame_id = iter->second;
-  Page *page = &pages_[frame_id];
-  disk_manager_->WritePage(page_id, page->GetData());
+  WaitForLoad(page);
+  // Like BeginFlushPage(), keep writers that pinned the page from changing it under the write; changes after it make
+  // the page dirty again.
+  page->RLatch();
   page->is_dirty_ = false;  // 刷新之后重置dirty状态
+  if (!FlushLogUpTo(page->GetLSN())) {
+    page->is_dirty_ = true;
+    page->RUnlatch();
+    UnpinPgImp(page_id, false);
+    return false;
+  }
+  disk_manager_->WritePage(page_id, page->GetData());
+  page->RUnlatch();
+  disk_manager_->Sync();
+  stats_.Add(BufferPoolEvent::FLUSH);
+  UnpinPgImp(page_id, false);
   return true;
 }
 
 void BufferPoolManagerInstance::FlushAllPgsImp() {
   // You can do it!
-  std::lock_guard<std::mutex> lock(latch_);
-  // for (size_t i = 0; i < page_table_.size(); ++i) {
-  //   if (pages_[i].is_dirty_) {
-  //     disk_manager_->WritePage(pages_[i].page_id_, pages_[i].data_);
-  //   }
-  // }
-  for (auto c : page_table_) {
-    frame_id_t frame_id = c.second;
-    page_id_t page_id = c.first;
-    disk_manager_->WritePage(page_id, pages_[frame_id].data_);
+  FlushDirtyPgsImp();
+}
+
+auto BufferPoolManagerInstance::FlushDirtyPgsImp() -> FlushStats {
+  std::vector<DirtyPage> dirty;
+  CollectDirtyPages(&dirty);
+  return WriteDirtyPages(std::move(dirty), 1);
+}
+
+void BufferPoolManagerInstance::CollectDirtyPages(std::vector<DirtyPage> *dirty) {
+  // Holding latch_ keeps every frame's page assignment stable while we walk the pool.
+  std::unique_lock<std::mutex> lock(latch_, std::defer_lock);
+  LockLatch(&lock);
+  for (size_t i = 0; i < pool_size_; ++i) {
+    Page *page = &pages_[i];
+    if (page->page_id_ == INVALID_PAGE_ID) {
+      continue;
+    }
+    std::lock_guard<std::mutex> stripe_lock(GetStripe(page->page_id_).latch_);
+    // A READING frame does not hold its page's content yet (and is clean anyway). A WRITING one is being written by
+    // the cleaner, an eviction or another flush, but that write may fail or back out and leave the page dirty.
+    if ((page->state_ == FrameState::VALID && page->is_dirty_) || page->state_ == FrameState::WRITING) {
+      dirty->push_back({page->page_id_, static_cast<frame_id_t>(i), this});
+    }
+  }
+}
+
+auto BufferPoolManagerInstance::WriteDirtyPages(std::vector<DirtyPage> dirty, size_t num_threads) -> FlushStats {
+  std::sort(dirty.begin(), dirty.end(),
+            [](const DirtyPage &a, const DirtyPage &b) { return a.page_id_ < b.page_id_; });
+  std::vector<char> written(dirty.size(), 0);
+  FlushStats stats = WriteSortedPages(dirty, num_threads, &written);
+
+  // The pages somebody else was writing were skipped. Wait for those writes, and write what they left dirty.
+  std::vector<DirtyPage> retry;
+  for (size_t i = 0; i < dirty.size(); ++i) {
+    if (written[i] == 0 && dirty[i].owner_->WaitForWriteBack(dirty[i])) {
+      retry.push_back(dirty[i]);
+    }
+  }
+  if (!retry.empty()) {
+    std::vector<char> retry_written(retry.size(), 0);
+    FlushStats retry_stats = WriteSortedPages(retry, 1, &retry_written);
+    stats.pages_written_ += retry_stats.pages_written_;
+    stats.bytes_written_ += retry_stats.bytes_written_;
+    stats.writes_ += retry_stats.writes_;
+  }
+  // One sync for the whole batch instead of one per write.
+  if (stats.writes_ > 0) {
+    dirty.front().owner_->disk_manager_->Sync();
+  }
+  return stats;
+}
+
+auto BufferPoolManagerInstance::WriteSortedPages(const std::vector<DirtyPage> &dirty, size_t num_threads,
+                                                 std::vector<char> *written) -> FlushStats {
+  // Split into runs of consecutive page ids, each short enough to be staged in one buffer.
+  std::vector<std::pair<size_t, size_t>> runs;
+  for (size_t i = 0; i < dirty.size(); ++i) {
+    if (runs.empty() || dirty[i].page_id_ != dirty[i - 1].page_id_ + 1 ||
+        i - runs.back().first == FLUSH_MAX_RUN_PAGES) {
+      runs.emplace_back(i, i);
+    }
+    runs.back().second = i + 1;
+  }
+
+  num_threads = std::min(num_threads, runs.size());
+  if (num_threads <= 1) {
+    return WriteRuns(dirty, runs, 0, 1, written);
+  }
+  FlushStats stats;
+  std::vector<FlushStats> thread_stats(num_threads);
+  std::vector<std::thread> threads;
+  for (size_t t = 0; t < num_threads; ++t) {
+    threads.emplace_back([&, t] { thread_stats[t] = WriteRuns(dirty, runs, t, num_threads, written); });
+  }
+  for (size_t t = 0; t < num_threads; ++t) {
+    threads[t].join();
+    stats.pages_written_ += thread_stats[t].pages_written_;
+    stats.bytes_written_ += thread_stats[t].bytes_written_;
+    stats.writes_ += thread_stats[t].writes_;
+  }
+  return stats;
+}
+
+auto BufferPoolManagerInstance::WriteRuns(const std::vector<DirtyPage> &dirty,
+                                          const std::vector<std::pair<size_t, size_t>> &runs, size_t first,
+                                          size_t stride, std::vector<char> *written) -> FlushStats {
+  FlushStats stats;
+  // Several runs are written at once, each staged in a buffer of its own. Their pages stay WRITING until it is done.
+  struct PendingWrite {
+    size_t begin_;
+    size_t num_pages_;
+    std::vector<char> buffer_;
+    std::future<bool> done_;
+  };
+  std::deque<PendingWrite> pending;
+  auto finish_write = [&](PendingWrite *write) {
+    bool ok = write->done_.get();
+    for (size_t k = write->begin_; k < write->begin_ + write->num_pages_; ++k) {
+      dirty[k].owner_->EndFlushPage(dirty[k], ok);
+      (*written)[k] = 1;
+    }
+    if (ok) {
+      stats.pages_written_ += write->num_pages_;
+      stats.bytes_written_ += write->num_pages_ * PAGE_SIZE;
+      stats.writes_++;
+    }
+  };
+
+  for (size_t r = first; r < runs.size(); r += stride) {
+    auto [begin, end] = runs[r];
+    // Pages are copied out one at a time, so the flusher never holds more than one page latch. A page that cannot be
+    // flushed any more splits the run in two.
+    size_t i = begin;
+    while (i < end) {
+      std::vector<char> buffer;
+      if (pending.size() == FLUSH_MAX_IN_FLIGHT) {
+        finish_write(&pending.front());
+        buffer = std::move(pending.front().buffer_);
+        pending.pop_front();
+      }
+      buffer.resize(FLUSH_MAX_RUN_PAGES * PAGE_SIZE);
+      size_t n = 0;
+      while (i + n < end && dirty[i + n].owner_->BeginFlushPage(dirty[i + n], buffer.data() + n * PAGE_SIZE)) {
+        n++;
+      }
+      if (n > 0) {
+        PendingWrite &write = pending.emplace_back();
+        write.begin_ = i;
+        write.num_pages_ = n;
+        write.buffer_ = std::move(buffer);
+        write.done_ = dirty[i].owner_->disk_manager_->WritePagesAsync(dirty[i].page_id_, write.buffer_.data(), n);
+      }
+      i += n + 1;
+    }
+  }
+  for (auto &write : pending) {
+    finish_write(&write);
   }
+  return stats;
+}
+
+auto BufferPoolManagerInstance::BeginFlushPage(const DirtyPage &dirty, char *buffer) -> bool {
+  Page *page = &pages_[dirty.frame_id_];
+  {
+    PageTableStripe &stripe = GetStripe(dirty.page_id_);
+    std::lock_guard<std::mutex> stripe_lock(stripe.latch_);
+    auto iter = stripe.table_.find(dirty.page_id_);
+    if (iter == stripe.table_.end() || iter->second != dirty.frame_id_ || page->state_ != FrameState::VALID ||
+        !page->is_dirty_) {
+      return false;
+    }
+    page->state_ = FrameState::WRITING;
+  }
+  // Writers that pinned the page wait for the copy; changes after it make the page dirty again.
+  page->RLatch();
+  page->is_dirty_ = false;
+  memcpy(buffer, page->GetData(), PAGE_SIZE);
+  lsn_t lsn = page->GetLSN();
+  page->RUnlatch();
+  // The copy goes out later, with the rest of its run, but its log records have to be out first.
+  if (!FlushLogUpTo(lsn)) {
+    EndFlushPage(dirty, false);
+    return false;
+  }
+  return true;
+}
+
+auto BufferPoolManagerInstance::WaitForWriteBack(const DirtyPage &dirty) -> bool {
+  Page *page = &pages_[dirty.frame_id_];
+  if (page->state_ == FrameState::WRITING) {
+    std::unique_lock<std::mutex> lock(latch_, std::defer_lock);
+    LockLatch(&lock);
+    while (page->state_ == FrameState::WRITING) {
+      write_back_cv_.wait_for(lock, WRITE_BACK_WAIT);
+    }
+  }
+  PageTableStripe &stripe = GetStripe(dirty.page_id_);
+  std::lock_guard<std::mutex> stripe_lock(stripe.latch_);
+  auto iter = stripe.table_.find(dirty.page_id_);
+  return iter != stripe.table_.end() && iter->second == dirty.frame_id_ && page->state_ == FrameState::VALID &&
+         page->is_dirty_;
+}
+
+void BufferPoolManagerInstance::EndFlushPage(const DirtyPage &dirty, bool written) {
+  if (written) {
+    stats_.Add(BufferPoolEvent::FLUSH);
+  }
+  PageTableStripe &stripe = GetStripe(dirty.page_id_);
+  std::lock_guard<std::mutex> stripe_lock(stripe.latch_);
+  if (!written) {
+    // The disk still has the old content, so the next flush has to try again.
+    pages_[dirty.frame_id_].is_dirty_ = true;
+  }
+  pages_[dirty.frame_id_].state_ = FrameState::VALID;
+  // Victim() may have picked the frame during the write, and EvictFrame() dropped it because it was busy.
+  if (pages_[dirty.frame_id_].pin_count_ == 0) {
+    QueueReplacerEvent(&stripe, dirty.frame_id_, true);
+  }
+  write_back_cv_.notify_all();
 }
 
 auto BufferPoolManagerInstance::NewPgImp(page_id_t *page_id) -> Page * {
-  std::lock_guard<std::mutex> lock(latch_);
+  return NewPgWithStrategyImp(page_id, nullptr);
+}
+
+auto BufferPoolManagerInstance::NewPgWithStrategyImp(page_id_t *page_id, BufferAccessStrategy *strategy) -> Page * {
+  RingSlot *slot = NextRingSlot(strategy);
+  std::unique_lock<std::mutex> lock(latch_, std::defer_lock);
+  LockLatch(&lock);
   // 0.   Make sure you call AllocatePage!
   // 1.   If all the pages in the buffer pool are pinned, return nullptr.
   // 2.   Pick a victim page P from either the free list or the replacer. Always pick from the free list first.
-
+  frame_id_t frame_id;
+  if (!AcquireFrame(&frame_id, &lock, slot)) {
+    stats_.Add(BufferPoolEvent::NO_FREE_FRAME);
+    return nullptr;
+  }
+  stats_.Add(BufferPoolEvent::NEW_PAGE);
   // 3.   Update P's metadata, zero out memory and add P to the page table.
+  // 只要是new，一定是一个新的页号，对于一个新建的文件肯定是没有这个页号，只要读就会出问题。
+  const page_id_t fresh_page_id = next_page_id_;
+  page_id_t new_page_id = AllocatePage();
+  Page *page = &pages_[frame_id];
+  page->ResetMemory();
+  page->page_id_ = new_page_id;
+  // A deallocated page that is handed out again still has its old content on disk. The zeroes have to replace it even
+  // if nobody writes to the page.
+  page->is_dirty_ = new_page_id != fresh_page_id;
+  page->pin_count_ = 1;
+  InstallPage(new_page_id, frame_id);
+  if (slot != nullptr) {
+    *slot = {frame_id, new_page_id};
+  }
   // 4.   Set the page ID output parameter. Return a pointer to P.
-
-  if (!free_list_.empty()) {
-    page_id_t new_page_id = AllocatePage();
-    // LOG_DEBUG("%d", new_page_id);
-    *page_id = new_page_id;
-    frame_id_t fra_id = free_list_.back();
-    free_list_.pop_back();
-    page_table_[new_page_id] = fra_id;
-    // 不能上来就读，因为test.db文件不存在，会报告读不到一个pageSize大小的页
-    // disk_manager_->ReadPage(new_page_id, pages_[fra_id].data_);
-    pages_[fra_id].ResetMemory();
-    pages_[fra_id].page_id_ = new_page_id;
-    pages_[fra_id].is_dirty_ = false;
-    pages_[fra_id].pin_count_ = 1;
-    replacer_->Pin(fra_id);
-    return pages_ + fra_id;
-  }
-
-  frame_id_t replace_frame;
-  if (replacer_->Victim(&replace_frame)) {
-    if (pages_[replace_frame].is_dirty_) {
-      disk_manager_->WritePage(pages_[replace_frame].page_id_, pages_[replace_frame].data_);
-    }
-    page_id_t new_page_id = AllocatePage();
-    // LOG_DEBUG("%d", new_page_id);
-    *page_id = new_page_id;
-
-    page_table_.erase(pages_[replace_frame].page_id_);
-    pages_[replace_frame].ResetMemory();
-    pages_[replace_frame].is_dirty_ = false;
-
-    pages_[replace_frame].page_id_ = new_page_id;
-    // 这里不能自加
-    pages_[replace_frame].pin_count_ = 1;
-    page_table_[new_page_id] = replace_frame;
-    replacer_->Pin(replace_frame);
-    // 只要是new，一定是一个新的页号，对于一个新建的文件肯定是没有这个页号，只要读就会出问题。
-    // disk_manager_->ReadPage(new_page_id, pages_[replace_frame].data_);
-    return pages_ + replace_frame;
-  }
-  return nullptr;
+  *page_id = new_page_id;
+  return page;
 }
 
 auto BufferPoolManagerInstance::FetchPgImp(page_id_t page_id) -> Page * {
-  std::lock_guard<std::mutex> lock(latch_);
+  return FetchPgWithStrategyImp(page_id, nullptr);
+}
 
-  //        Note that pages are always found from the free list first.
+auto BufferPoolManagerInstance::FetchPgWithStrategyImp(page_id_t page_id, BufferAccessStrategy *strategy) -> Page * {
+  Page *page = PinPage(page_id, strategy, false);
+  if (page != nullptr) {
+    WaitForLoad(page);
+  }
+  return page;
+}
+
+auto BufferPoolManagerInstance::PinPage(page_id_t page_id, BufferAccessStrategy *strategy, bool prefetch) -> Page * {
   // 1.     Search the page table for the requested page (P).
-  // 1.1    If P exists, pin it and return it immediately.
-  if (page_table_.count(page_id) > 0) {
-    Page *page_tmp = pages_ + page_table_[page_id];
-    page_tmp->pin_count_++;
-    replacer_->Pin(page_table_[page_id]);
-    return page_tmp;
+  // 1.1    If P exists, pin it and return it immediately. This is the hot path and never touches latch_.
+  Page *page = PinResidentPage(page_id);
+  if (page != nullptr) {
+    stats_.Add(BufferPoolEvent::FETCH_HIT);
+    if (prefetch) {
+      UnpinFrameImp(page, false);
+    }
+    return page;
   }
+
+  RingSlot *slot = NextRingSlot(strategy);
+  std::unique_lock<std::mutex> lock(latch_, std::defer_lock);
+  LockLatch(&lock);
   // 1.2    If P does not exist, find a replacement page (R) from either the free list or the replacer.
-  if (!free_list_.empty()) {
-    // 取出空闲的物理块
-    frame_id_t frame_id = free_list_.front();
-    free_list_.pop_front();
-    // 完成读取操作
-    pages_[frame_id].ResetMemory();
-    page_table_[page_id] = frame_id;
-    disk_manager_->ReadPage(page_id, pages_[frame_id].data_);
-    pages_[frame_id].page_id_ = page_id;
-    pages_[frame_id].is_dirty_ = false;
-    pages_[frame_id].pin_count_ = 1;
-    return pages_ + frame_id;
-  }
-  // 没有空闲块，而且page_id不在内存中
-  // 2.     If R is dirty, write it back to the disk.
+  //        Note that pages are always found from the free list first, unless the caller's ring has a frame to reuse.
+  // 2.     If R is dirty, write it back to the disk. AcquireFrame() drops latch_ while doing so.
+  // 3.     Delete R from the page table and insert P.
   frame_id_t frame_id;
   // 如果有可以替换的页框，没有只能直接返回nullptr，告诉这个时候没有空闲，没有可替换的块
-  if (replacer_->Victim(&frame_id)) {
-    if (pages_[frame_id].is_dirty_) {
-      disk_manager_->WritePage(pages_[frame_id].GetPageId(), pages_[frame_id].GetData());
+  if (!AcquireFrame(&frame_id, &lock, slot)) {
+    // P may have been brought in by someone else while we waited, in which case it is not a miss after all.
+    page = PinResidentPage(page_id);
+    lock.unlock();
+    if (page == nullptr) {
+      stats_.Add(BufferPoolEvent::NO_FREE_FRAME);
+      return nullptr;
+    }
+    stats_.Add(BufferPoolEvent::FETCH_HIT);
+    if (prefetch) {
+      UnpinFrameImp(page, false);
     }
-    // 3.     Delete R from the page table and insert P.
-    page_table_.erase(pages_[frame_id].GetPageId());
-    page_table_[page_id] = frame_id;
-    pages_[frame_id].ResetMemory();
-    // 4.     Update P's metadata, read in the page content from disk, and then return a pointer to P.
-    disk_manager_->ReadPage(page_id, (pages_ + frame_id)->GetData());
-    pages_[frame_id].is_dirty_ = false;
-    pages_[frame_id].page_id_ = page_id;
-    pages_[frame_id].pin_count_ = 1;
-    return pages_ + frame_id;
+    return page;
+  }
+  // Another thread may have brought P in while we were waiting for latch_ or writing back R.
+  page = PinResidentPage(page_id);
+  if (page != nullptr) {
+    free_list_.emplace_front(frame_id);
+    free_frames_++;
+    lock.unlock();
+    stats_.Add(BufferPoolEvent::FETCH_HIT);
+    if (prefetch) {
+      UnpinFrameImp(page, false);
+    }
+    return page;
+  }
+  // 4.     Update P's metadata, read in the page content from disk, and then return a pointer to P.
+  //        The frame is published as READING with its write latch held, so concurrent fetchers of P pin it and
+  //        wait on this frame alone while everybody else carries on without latch_.
+  page = &pages_[frame_id];
+  page->page_id_ = page_id;
+  page->is_dirty_ = false;
+  page->pin_count_ = 1;
+  page->state_ = FrameState::READING;
+  page->WLatch();
+  InstallPage(page_id, frame_id);
+  lock.unlock();
+  if (slot != nullptr) {
+    *slot = {frame_id, page_id};
   }
 
-  return nullptr;
+  stats_.Add(BufferPoolEvent::FETCH_MISS);
+  LoadPage(page_id, page, prefetch);
+  return page;
+}
+
+void BufferPoolManagerInstance::LoadPage(page_id_t page_id, Page *page, bool prefetch) {
+  if (prefetch) {
+    std::lock_guard<std::mutex> lock(prefetch_latch_);
+    prefetch_in_flight_++;
+  }
+  disk_manager_->ReadPagesAsync(page_id, page->data_, 1, [this, page, prefetch](bool ok) {
+    if (!ok) {
+      // Like ReadPage(), hand out zeroes rather than whatever the frame held before.
+      memset(page->data_, 0, PAGE_SIZE);
+    }
+    // The frame must be VALID before anybody can unpin it, or EvictFrame() would turn it down for good.
+    page->state_ = FrameState::VALID;
+    page->WUnlatch();
+    if (prefetch) {
+      // The prefetch pin kept the frame from being evicted while it was READING.
+      UnpinFrameImp(page, false);
+      std::lock_guard<std::mutex> lock(prefetch_latch_);
+      prefetch_in_flight_--;
+      prefetch_cv_.notify_all();
+    }
+  });
 }
 
 auto BufferPoolManagerInstance::DeletePgImp(page_id_t page_id) -> bool {
@@ -192,63 +498,664 @@ auto BufferPoolManagerInstance::DeletePgImp(page_id_t page_id) -> bool {
   // 1.   If P does not exist, return true.
   // 2.   If P exists, but has a non-zero pin-count, return false. Someone is using the page.
   // 3.   Otherwise, P can be deleted. Remove P from the page table, reset its metadata and return it to the free list.
-  std::lock_guard<std::mutex> lock(latch_);
-  DeallocatePage(page_id);
-  if (page_table_.count(page_id) == 0) {
-    return true;
-  }
-  frame_id_t frame_id = page_table_[page_id];
-  if (pages_[frame_id].pin_count_ > 0) {
-    return false;
+  std::unique_lock<std::mutex> lock(latch_, std::defer_lock);
+  LockLatch(&lock);
+  PageTableStripe &stripe = GetStripe(page_id);
+  frame_id_t frame_id;
+  {
+    std::lock_guard<std::mutex> stripe_lock(stripe.latch_);
+    auto iter = stripe.table_.find(page_id);
+    if (iter == stripe.table_.end()) {
+      DeallocatePage(page_id);
+      return true;
+    }
+    frame_id = iter->second;
+    // Pages with I/O in flight are in use as well.
+    if (pages_[frame_id].pin_count_ > 0 || pages_[frame_id].state_ != FrameState::VALID) {
+      return false;
+    }
+    stripe.table_.erase(iter);
+    // The frame's queued pins and unpins must not reach the replacer after it is gone.
+    DrainReplacerEvents(&stripe);
+    replacer_->Remove(frame_id);
   }
+  // Only a page that is really gone may be handed out again; a pinned one is still in use.
+  DeallocatePage(page_id);
 
-  replacer_->Pin(page_table_[page_id]);
-
-  if (pages_[frame_id].is_dirty_) {
-    disk_manager_->WritePage(pages_[frame_id].page_id_, pages_[frame_id].data_);
-  }
-  page_table_.erase(page_id);
-  pages_[frame_id].ResetMemory();
-  pages_[frame_id].is_dirty_ = false;
-  pages_[frame_id].page_id_ = INVALID_PAGE_ID;
-  pages_[frame_id].pin_count_ = 0;
+  // The page is gone, so there is no point in writing back its content.
+  Page *page = &pages_[frame_id];
+  page->ResetMemory();
+  page->is_dirty_ = false;
+  page->page_id_ = INVALID_PAGE_ID;
+  page->pin_count_ = 0;
   free_list_.emplace_back(frame_id);
-  // DeallocatePage(page_id);
+  free_frames_++;
   return true;
 }
 
 auto BufferPoolManagerInstance::UnpinPgImp(page_id_t page_id, bool is_dirty) -> bool {
-  std::lock_guard<std::mutex> lock(latch_);
+  PageTableStripe &stripe = GetStripe(page_id);
+  std::lock_guard<std::mutex> stripe_lock(stripe.latch_);
   // 可能传入不存在的page_id
-  if (page_table_.count(page_id) == 0) {
+  auto iter = stripe.table_.find(page_id);
+  if (iter == stripe.table_.end()) {
     return false;
   }
-  frame_id_t frame_id = page_table_[page_id];
-  if (pages_[frame_id].pin_count_ <= 0) {
+  frame_id_t frame_id = iter->second;
+  Page *page = &pages_[frame_id];
+  if (page->pin_count_ <= 0) {
     return false;
   }
   // 这里即使传入的is_dirty是false，也不能直接赋值false，因为即使这次使用没有更改，可能别的线程使用更改了已经
   if (is_dirty) {
-    pages_[frame_id].is_dirty_ = true;
+    page->is_dirty_ = true;
   }
-  pages_[frame_id].pin_count_--;
-  if (pages_[frame_id].pin_count_ == 0) {
-    // LOG_DEBUG("%d", page_id);
-    replacer_->Unpin(frame_id);
+  if (--page->pin_count_ == 0) {
+    QueueReplacerEvent(&stripe, frame_id, true);
   }
+  return true;
+}
 
+auto BufferPoolManagerInstance::UnpinFrameImp(Page *page, bool is_dirty) -> bool {
+  // 调用者持有 pin，frame 不会被替换，page_id_ 稳定；pin_count_ 仍由页表分片的锁保护
+  PageTableStripe &stripe = GetStripe(page->GetPageId());
+  std::lock_guard<std::mutex> stripe_lock(stripe.latch_);
+  if (page->pin_count_ <= 0) {
+    return false;
+  }
+  if (is_dirty) {
+    page->is_dirty_ = true;
+  }
+  if (--page->pin_count_ == 0) {
+    QueueReplacerEvent(&stripe, static_cast<frame_id_t>(page - pages_), true);
+  }
   return true;
 }
 
+auto BufferPoolManagerInstance::GetStripe(page_id_t page_id) -> PageTableStripe & {
+  static_assert((PAGE_TABLE_STRIPES & (PAGE_TABLE_STRIPES - 1)) == 0, "stripe count must be a power of two");
+  // Fibonacci hashing spreads page ids evenly even when a parallel BPM stripes them across instances.
+  auto hash = static_cast<uint32_t>(page_id) * 2654435769U;
+  return page_table_[(hash >> 16) & (PAGE_TABLE_STRIPES - 1)];
+}
+
+auto BufferPoolManagerInstance::PinResidentPage(page_id_t page_id) -> Page * {
+  PageTableStripe &stripe = GetStripe(page_id);
+  std::lock_guard<std::mutex> stripe_lock(stripe.latch_);
+  auto iter = stripe.table_.find(page_id);
+  if (iter == stripe.table_.end()) {
+    return nullptr;
+  }
+  Page *page = &pages_[iter->second];
+  // Whatever happened to a clean page that nobody holds is on disk already; the next change gets a later LSN.
+  if (page->pin_count_ == 0 && !page->is_dirty_ && page->state_ == FrameState::VALID) {
+    page->rec_lsn_ = NextLSN();
+  }
+  page->pin_count_++;
+  QueueReplacerEvent(&stripe, iter->second, false);
+  return page;
+}
+
+void BufferPoolManagerInstance::QueueReplacerEvent(PageTableStripe *stripe, frame_id_t frame_id, bool unpin) {
+  if (stripe->num_pending_ == REPLACER_BATCH_SIZE) {
+    DrainReplacerEvents(stripe);
+  }
+  // A clock read, unlike a shared counter, does not bounce a cache line between the cores.
+  int64_t now = std::chrono::steady_clock::now().time_since_epoch().count();
+  stripe->pending_[stripe->num_pending_++] = {now, frame_id, unpin};
+}
+
+void BufferPoolManagerInstance::DrainReplacerEvents(PageTableStripe *stripe) {
+  for (size_t i = 0; i < stripe->num_pending_; ++i) {
+    ApplyReplacerEvent(stripe->pending_[i]);
+  }
+  stripe->num_pending_ = 0;
+}
+
+void BufferPoolManagerInstance::DrainAllReplacerEvents() {
+  std::vector<ReplacerEvent> events;
+  for (auto &stripe : page_table_) {
+    std::lock_guard<std::mutex> stripe_lock(stripe.latch_);
+    events.insert(events.end(), stripe.pending_.begin(), stripe.pending_.begin() + stripe.num_pending_);
+    stripe.num_pending_ = 0;
+  }
+  std::stable_sort(events.begin(), events.end(),
+                   [](const ReplacerEvent &a, const ReplacerEvent &b) { return a.time_ < b.time_; });
+  for (const auto &event : events) {
+    ApplyReplacerEvent(event);
+  }
+}
+
+void BufferPoolManagerInstance::ApplyReplacerEvent(const ReplacerEvent &event) {
+  // A batch drained meanwhile may have overtaken this event, so the frame's pin count decides where it ends up. A
+  // frame cannot change pages until then: callers hold either its stripe latch or latch_.
+  bool pinned = pages_[event.frame_id_].pin_count_ > 0;
+  if (!event.unpin_) {
+    replacer_->Pin(event.frame_id_);
+  }
+  if (!pinned) {
+    replacer_->Unpin(event.frame_id_);
+  }
+}
+
+void BufferPoolManagerInstance::WaitForLoad(Page *page) {
+  if (page->state_ == FrameState::READING) {
+    // The loader holds the write latch until the content is in place.
+    page->RLatch();
+    page->RUnlatch();
+  }
+}
+
+auto BufferPoolManagerInstance::NextRingSlot(BufferAccessStrategy *strategy) -> RingSlot * {
+  if (strategy == nullptr) {
+    return nullptr;
+  }
+  // Split the ring across the instances, but never let it take over too much of this one.
+  return strategy->NextSlot(instance_index_, strategy->GetRingFrames(pool_size_, num_instances_));
+}
+
+auto BufferPoolManagerInstance::AcquireFrame(frame_id_t *frame_id, std::unique_lock<std::mutex> *lock, RingSlot *slot)
+    -> bool {
+  // A ring frame is only recycled if it still holds the page the strategy put there, i.e. nobody else has evicted it
+  // and reused it for a page of their own in the meantime.
+  if (slot != nullptr && slot->page_id_ != INVALID_PAGE_ID && pages_[slot->frame_id_].page_id_ == slot->page_id_ &&
+      EvictFrame(slot->frame_id_, lock)) {
+    *frame_id = slot->frame_id_;
+    return true;
+  }
+  frame_id_t victim;
+  bool drained = false;
+  while (true) {
+    if (!free_list_.empty()) {
+      *frame_id = free_list_.front();
+      free_list_.pop_front();
+      free_frames_--;
+      return true;
+    }
+    // The replacer has to know about the recent hits before it picks a victim; a miss can afford that.
+    if (!drained) {
+      DrainAllReplacerEvents();
+      drained = true;
+    }
+    if (!replacer_->Victim(&victim)) {
+      // Frames that are being written back are only out of reach until their writes are done, and a flush may well
+      // have all of them in flight at once.
+      if (!IsWritingBack()) {
+        return false;
+      }
+      write_back_cv_.wait_for(*lock, WRITE_BACK_WAIT);
+      drained = false;
+      continue;
+    }
+    if (EvictFrame(victim, lock)) {
+      *frame_id = victim;
+      return true;
+    }
+  }
+}
+
+auto BufferPoolManagerInstance::IsWritingBack() const -> bool {
+  for (size_t i = 0; i < pool_size_; ++i) {
+    if (pages_[i].state_ == FrameState::WRITING) {
+      return true;
+    }
+  }
+  return false;
+}
+
+auto BufferPoolManagerInstance::EvictFrame(frame_id_t frame_id, std::unique_lock<std::mutex> *lock) -> bool {
+  Page *page = &pages_[frame_id];
+  page_id_t old_page_id = page->page_id_;
+  PageTableStripe &stripe = GetStripe(old_page_id);
+  {
+    std::lock_guard<std::mutex> stripe_lock(stripe.latch_);
+    // The frame's queued pins and unpins must not reach the replacer after it is gone.
+    DrainReplacerEvents(&stripe);
+    // A cache hit may have pinned the frame between Victim() and taking the stripe latch. It will go back to the
+    // replacer when that pin is released, so the caller just looks elsewhere. The same goes for a frame that another
+    // thread is already writing back.
+    if (page->pin_count_ > 0 || page->state_ != FrameState::VALID) {
+      return false;
+    }
+    // A hit may also have pinned and unpinned the frame since Victim(), making it evictable again. Ring frames were
+    // never taken out of the replacer in the first place.
+    replacer_->Remove(frame_id);
+    if (!page->is_dirty_) {
+      stripe.table_.erase(old_page_id);
+      stats_.Add(BufferPoolEvent::EVICTION);
+      return true;
+    }
+    // The page stays resident and readable while it is written back.
+    page->state_ = FrameState::WRITING;
+    page->is_dirty_ = false;
+  }
+
+  lock->unlock();
+  // The cleaner did not keep up, so give it a nudge while we do its job.
+  stats_.Add(BufferPoolEvent::SYNC_WRITE_BACK);
+  WakeCleaner();
+  // Like the cleaner, keep writers that pin the page meanwhile from changing it under the write.
+  page->RLatch();
+  if (!FlushLogUpTo(page->GetLSN()) || !disk_manager_->WritePagesAsync(old_page_id, page->GetData(), 1).get()) {
+    // Keep the page: the disk still has the old content.
+    page->is_dirty_ = true;
+  }
+  page->RUnlatch();
+  LockLatch(lock);
+
+  std::lock_guard<std::mutex> stripe_lock(stripe.latch_);
+  page->state_ = FrameState::VALID;
+  write_back_cv_.notify_all();
+  DrainReplacerEvents(&stripe);
+  if (page->pin_count_ == 0 && !page->is_dirty_) {
+    // Somebody may have pinned and unpinned the page during the write, putting it back into the replacer.
+    replacer_->Remove(frame_id);
+    stripe.table_.erase(old_page_id);
+    stats_.Add(BufferPoolEvent::EVICTION);
+    return true;
+  }
+  // The page was used again while being written. Keep it resident, and evictable once its pins are released.
+  if (page->pin_count_ == 0) {
+    QueueReplacerEvent(&stripe, frame_id, true);
+  }
+  return false;
+}
+
+void BufferPoolManagerInstance::PrefetchPgsImp(const std::vector<page_id_t> &page_ids,
+                                               std::shared_ptr<BufferAccessStrategy> strategy) {
+  {
+    std::lock_guard<std::mutex> lock(prefetch_latch_);
+    if (prefetch_stop_) {
+      return;
+    }
+    if (!prefetch_thread_.joinable()) {
+      prefetch_thread_ = std::thread(&BufferPoolManagerInstance::PrefetchLoop, this);
+    }
+    for (auto page_id : page_ids) {
+      if (prefetch_queue_.size() >= PREFETCH_QUEUE_DEPTH) {
+        break;
+      }
+      prefetch_queue_.push_back({page_id, strategy});
+    }
+  }
+  prefetch_cv_.notify_one();
+}
+
+void BufferPoolManagerInstance::PrefetchLoop() {
+  std::unique_lock<std::mutex> lock(prefetch_latch_);
+  while (true) {
+    prefetch_cv_.wait(lock, [this] {
+      return prefetch_stop_ || (!prefetch_queue_.empty() && prefetch_in_flight_ < PREFETCH_MAX_IN_FLIGHT);
+    });
+    if (prefetch_stop_) {
+      break;
+    }
+    PrefetchRequest request = std::move(prefetch_queue_.front());
+    prefetch_queue_.pop_front();
+    lock.unlock();
+    // Reading past the end of the file would only bring in a zeroed page.
+    if (request.page_id_ >= 0 && request.page_id_ < disk_manager_->GetNumPages()) {
+      // Starting the read is all it takes: whoever asks for the page meanwhile pins it and waits for this read.
+      PinPage(request.page_id_, request.strategy_.get(), true);
+    }
+    lock.lock();
+  }
+  // The reads still in flight touch their frames and this latch when they complete.
+  prefetch_cv_.wait(lock, [this] { return prefetch_in_flight_ == 0; });
+}
+
+void BufferPoolManagerInstance::LockLatch(std::unique_lock<std::mutex> *lock) {
+  // Only a contended latch is worth two clock reads.
+  if (lock->try_lock()) {
+    stats_.RecordLatchWait(0);
+    return;
+  }
+  auto start = std::chrono::steady_clock::now();
+  lock->lock();
+  auto wait = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+  stats_.RecordLatchWait(std::max<int64_t>(wait.count(), 1));
+}
+
+void BufferPoolManagerInstance::CleanerLoop() {
+  std::unique_lock<std::mutex> lock(cleaner_latch_);
+  while (!cleaner_stop_) {
+    cleaner_cv_.wait_for(lock, options_.cleaner_interval_, [this] { return cleaner_stop_ || cleaner_wakeup_; });
+    cleaner_wakeup_ = false;
+    if (cleaner_stop_) {
+      break;
+    }
+    lock.unlock();
+    CleanPages();
+    lock.lock();
+  }
+}
+
+void BufferPoolManagerInstance::WakeCleaner() {
+  if (!options_.enable_cleaner_) {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(cleaner_latch_);
+    cleaner_wakeup_ = true;
+  }
+  cleaner_cv_.notify_one();
+}
+
+void BufferPoolManagerInstance::CleanPages() {
+  auto target = static_cast<size_t>(options_.cleaner_clean_fraction_ * pool_size_);
+  size_t clean;
+  std::vector<std::pair<page_id_t, frame_id_t>> dirty;
+  {
+    // latch_ keeps page_id_ stable while we look. Pins and dirty bits may change right after; that only makes this
+    // round write a page more or less than needed.
+    std::unique_lock<std::mutex> lock(latch_, std::defer_lock);
+    LockLatch(&lock);
+    clean = free_list_.size();
+    for (size_t i = 0; i < pool_size_; ++i) {
+      Page *page = &pages_[i];
+      if (page->page_id_ == INVALID_PAGE_ID || page->pin_count_ > 0 || page->state_ != FrameState::VALID) {
+        continue;
+      }
+      if (page->is_dirty_) {
+        dirty.emplace_back(page->page_id_, static_cast<frame_id_t>(i));
+      } else {
+        clean++;
+      }
+    }
+  }
+  // Writing in page id order turns a run of neighbouring dirty pages into sequential I/O. Several writes are in
+  // flight at once; each page stays WRITING and read latched until its write is done.
+  std::sort(dirty.begin(), dirty.end());
+  struct PendingClean {
+    page_id_t page_id_;
+    frame_id_t frame_id_;
+    std::future<bool> done_;
+  };
+  std::deque<PendingClean> pending;
+  auto finish_clean = [&](PendingClean *write) {
+    if (EndCleanPage(write->page_id_, write->frame_id_, write->done_.get())) {
+      clean++;
+    }
+  };
+  for (auto &[page_id, frame_id] : dirty) {
+    if (clean + pending.size() >= target) {
+      break;
+    }
+    if (pending.size() == CLEANER_MAX_IN_FLIGHT) {
+      finish_clean(&pending.front());
+      pending.pop_front();
+    }
+    std::future<bool> done;
+    if (BeginCleanPage(page_id, frame_id, &done)) {
+      pending.push_back({page_id, frame_id, std::move(done)});
+    }
+  }
+  for (auto &write : pending) {
+    finish_clean(&write);
+  }
+}
+
+auto BufferPoolManagerInstance::BeginCleanPage(page_id_t page_id, frame_id_t frame_id, std::future<bool> *done)
+    -> bool {
+  Page *page = &pages_[frame_id];
+  {
+    PageTableStripe &stripe = GetStripe(page_id);
+    std::lock_guard<std::mutex> stripe_lock(stripe.latch_);
+    auto iter = stripe.table_.find(page_id);
+    if (iter == stripe.table_.end() || iter->second != frame_id || page->pin_count_ > 0 ||
+        page->state_ != FrameState::VALID || !page->is_dirty_) {
+      return false;
+    }
+    // Unlike an eviction, the frame stays in the replacer so that its place in the eviction order is kept.
+    page->state_ = FrameState::WRITING;
+  }
+
+  // Anybody who pins the page meanwhile can read it, but has to wait for the write to finish before changing it.
+  page->RLatch();
+  // WAL: a page may only reach the disk after the log records that changed it.
+  if (LogIsBehind(page->GetLSN())) {
+    EndCleanPage(page_id, frame_id, false);
+    return false;
+  }
+  page->is_dirty_ = false;
+  *done = disk_manager_->WritePagesAsync(page_id, page->GetData(), 1);
+  return true;
+}
+
+auto BufferPoolManagerInstance::EndCleanPage(page_id_t page_id, frame_id_t frame_id, bool written) -> bool {
+  Page *page = &pages_[frame_id];
+  if (!written) {
+    page->is_dirty_ = true;
+  }
+  page->RUnlatch();
+
+  PageTableStripe &stripe = GetStripe(page_id);
+  std::lock_guard<std::mutex> stripe_lock(stripe.latch_);
+  page->state_ = FrameState::VALID;
+  // Victim() may have picked the frame during the write, and EvictFrame() dropped it because it was busy.
+  if (page->pin_count_ == 0) {
+    QueueReplacerEvent(&stripe, frame_id, true);
+  }
+  write_back_cv_.notify_all();
+  if (written) {
+    stats_.Add(BufferPoolEvent::CLEANER_WRITE_BACK);
+  }
+  return written;
+}
+
+void BufferPoolManagerInstance::InstallPage(page_id_t page_id, frame_id_t frame_id) {
+  PageTableStripe &stripe = GetStripe(page_id);
+  std::lock_guard<std::mutex> stripe_lock(stripe.latch_);
+  stripe.table_[page_id] = frame_id;
+  pages_[frame_id].rec_lsn_ = NextLSN();
+  QueueReplacerEvent(&stripe, frame_id, false);
+}
+
+auto BufferPoolManagerInstance::GetResidentPgsImp() -> std::vector<page_id_t> {
+  std::vector<page_id_t> page_ids;
+  // Which page a frame holds only changes under latch_.
+  std::unique_lock<std::mutex> lock(latch_, std::defer_lock);
+  LockLatch(&lock);
+  for (size_t i = 0; i < pool_size_; ++i) {
+    if (pages_[i].pin_count_ > 0) {
+      page_ids.push_back(pages_[i].page_id_);
+    }
+  }
+  DrainAllReplacerEvents();
+  std::vector<frame_id_t> eviction_order = replacer_->GetEvictionOrder();
+  for (auto frame_id = eviction_order.rbegin(); frame_id != eviction_order.rend(); ++frame_id) {
+    page_ids.push_back(pages_[*frame_id].page_id_);
+  }
+  return page_ids;
+}
+
+auto BufferPoolManagerInstance::GetDirtyPageTableImp() -> std::vector<std::pair<page_id_t, lsn_t>> {
+  std::vector<std::pair<page_id_t, lsn_t>> dirty_pages;
+  std::unique_lock<std::mutex> lock(latch_, std::defer_lock);
+  LockLatch(&lock);
+  for (size_t i = 0; i < pool_size_; ++i) {
+    Page *page = &pages_[i];
+    if (page->page_id_ == INVALID_PAGE_ID) {
+      continue;
+    }
+    std::lock_guard<std::mutex> stripe_lock(GetStripe(page->page_id_).latch_);
+    if (page->is_dirty_ || page->pin_count_ > 0 || page->state_ == FrameState::WRITING) {
+      dirty_pages.emplace_back(page->page_id_, page->rec_lsn_);
+    }
+  }
+  return dirty_pages;
+}
+
+auto BufferPoolManagerInstance::LogIsBehind(lsn_t lsn) -> bool {
+  // Recovery changes pages with logging off, and logs them all the same.
+  return log_manager_ != nullptr && lsn > log_manager_->GetPersistentLSN() && lsn < log_manager_->GetNextLSN();
+}
+
+auto BufferPoolManagerInstance::FlushLogUpTo(lsn_t lsn) -> bool {
+  if (LogIsBehind(lsn)) {
+    return log_manager_->Flush(lsn);
+  }
+  return true;
+}
+
+void BufferPoolManagerInstance::PreloadPgsImp(std::vector<page_id_t> page_ids) {
+  std::lock_guard<std::mutex> lock(preload_latch_);
+  if (preload_stop_) {
+    return;
+  }
+  if (preload_thread_.joinable()) {
+    preload_thread_.join();
+  }
+  preload_thread_ = std::thread(&BufferPoolManagerInstance::PreloadLoop, this, std::move(page_ids));
+}
+
+void BufferPoolManagerInstance::PreloadLoop(std::vector<page_id_t> page_ids) {
+  // Only the first pages that fit into the free frames are worth reading. Pages past the end of the file were never
+  // written, e.g. because the list comes from a different database.
+  page_id_t num_pages = disk_manager_->GetNumPages();
+  size_t free_frames = free_frames_;
+  std::vector<page_id_t> wanted;
+  for (auto page_id : page_ids) {
+    if (wanted.size() >= free_frames) {
+      break;
+    }
+    if (page_id >= 0 && page_id < num_pages) {
+      wanted.push_back(page_id);
+    }
+  }
+  std::sort(wanted.begin(), wanted.end());
+  wanted.erase(std::unique(wanted.begin(), wanted.end()), wanted.end());
+
+  // Several runs are read at once; each keeps its frames write latched until its read is done.
+  struct PendingRun {
+    std::vector<Page *> pages_;
+    std::vector<char> buffer_;
+    std::future<bool> done_;
+  };
+  std::deque<PendingRun> pending;
+  auto finish_run = [&](PendingRun *run) {
+    run->done_.wait();
+    for (size_t k = 0; k < run->pages_.size(); ++k) {
+      Page *page = run->pages_[k];
+      if (page == nullptr) {
+        continue;
+      }
+      memcpy(page->data_, run->buffer_.data() + k * PAGE_SIZE, PAGE_SIZE);
+      page->state_ = FrameState::VALID;
+      page->WUnlatch();
+      stats_.Add(BufferPoolEvent::PRELOAD);
+      UnpinFrameImp(page, false);
+    }
+  };
+
+  size_t i = 0;
+  bool out_of_frames = false;
+  while (i < wanted.size() && !out_of_frames && !preload_stop_) {
+    size_t n = 1;
+    while (i + n < wanted.size() && n < PRELOAD_MAX_RUN_PAGES && wanted[i + n] == wanted[i] + static_cast<int>(n)) {
+      n++;
+    }
+    // Claim a free frame for every page of the run that is not resident yet; never evict anything for them.
+    std::vector<Page *> run;
+    {
+      std::unique_lock<std::mutex> lock(latch_, std::defer_lock);
+      LockLatch(&lock);
+      for (size_t k = 0; k < n; ++k) {
+        if (IsResident(wanted[i + k])) {
+          run.push_back(nullptr);
+          continue;
+        }
+        if (free_list_.empty()) {
+          out_of_frames = true;
+          break;
+        }
+        frame_id_t frame_id = free_list_.front();
+        free_list_.pop_front();
+        free_frames_--;
+        Page *page = &pages_[frame_id];
+        page->page_id_ = wanted[i + k];
+        page->is_dirty_ = false;
+        page->pin_count_ = 1;
+        page->state_ = FrameState::READING;
+        page->WLatch();
+        InstallPage(wanted[i + k], frame_id);
+        run.push_back(page);
+      }
+    }
+    while (!run.empty() && run.back() == nullptr) {
+      run.pop_back();
+    }
+    if (!run.empty()) {
+      if (pending.size() == PRELOAD_MAX_IN_FLIGHT) {
+        finish_run(&pending.front());
+        pending.pop_front();
+      }
+      PendingRun &pending_run = pending.emplace_back();
+      pending_run.pages_ = std::move(run);
+      pending_run.buffer_.resize(pending_run.pages_.size() * PAGE_SIZE);
+      pending_run.done_ =
+          disk_manager_->ReadPagesAsync(wanted[i], pending_run.buffer_.data(), pending_run.pages_.size());
+    }
+    i += n;
+  }
+  for (auto &pending_run : pending) {
+    finish_run(&pending_run);
+  }
+}
+
+auto BufferPoolManagerInstance::IsResident(page_id_t page_id) -> bool {
+  PageTableStripe &stripe = GetStripe(page_id);
+  std::lock_guard<std::mutex> stripe_lock(stripe.latch_);
+  return stripe.table_.count(page_id) > 0;
+}
+
+auto BufferPoolManagerInstance::GetPinnedFrameCount() const -> size_t {
+  size_t pinned = 0;
+  for (size_t i = 0; i < pool_size_; ++i) {
+    if (pages_[i].pin_count_ > 0) {
+      pinned++;
+    }
+  }
+  return pinned;
+}
+
+void BufferPoolManagerInstance::SetPageIdAllocation(page_id_t next_page_id, uint32_t num_instances) {
+  BUSTUB_ASSERT(num_instances > 0, "Page ids must be striped over at least one instance");
+  // AllocatePage() runs under latch_.
+  std::lock_guard<std::mutex> lock(latch_);
+  num_instances_ = num_instances;
+  next_page_id_ = next_page_id;
+  first_page_id_ = next_page_id;
+}
+
 auto BufferPoolManagerInstance::AllocatePage() -> page_id_t {
+  // Reuse a deallocated page of our own stripe before growing the file.
+  uint32_t stripes = num_instances_;
+  page_id_t free_page_id = disk_manager_->AllocateFreePage(first_page_id_, first_page_id_ % stripes, stripes);
+  if (free_page_id != INVALID_PAGE_ID) {
+    ValidatePageId(free_page_id);
+    return free_page_id;
+  }
   const page_id_t next_page_id = next_page_id_;
   next_page_id_ += num_instances_;
   ValidatePageId(next_page_id);
   return next_page_id;
 }
 
+void BufferPoolManagerInstance::DeallocatePage(page_id_t page_id) {
+  // Freeing an id that was never handed out would let AllocatePage() return it now and once more when next_page_id_
+  // gets there. Ids below the current stripe were handed out before the last resize, and are routed here since.
+  uint32_t stripes = num_instances_;
+  page_id_t stripe_start = first_page_id_ - first_page_id_ % static_cast<page_id_t>(stripes);
+  bool handed_out = page_id >= 0 && page_id < next_page_id_ &&
+                    (page_id < stripe_start || page_id % stripes == first_page_id_ % stripes);
+  if (handed_out) {
+    disk_manager_->DeallocatePage(page_id);
+  }
+}
+
 void BufferPoolManagerInstance::ValidatePageId(const page_id_t page_id) const {
-  assert(page_id % num_instances_ == instance_index_);  // allocated pages mod back to this BPI
+  assert(page_id % num_instances_ == next_page_id_ % num_instances_);  // allocated pages mod back to this BPI
 }
 
 }  // namespace bustub
@@ -0,0 +1,77 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// buffer_pool_stats.cpp
+//
+// Identification: src/buffer/buffer_pool_stats.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "buffer/buffer_pool_stats.h"
+
+namespace bustub {
+
+auto BufferPoolCounters::HitRatio() const -> double {
+  uint64_t fetches = fetch_hits_ + fetch_misses_;
+  return fetches == 0 ? 0 : static_cast<double>(fetch_hits_) / static_cast<double>(fetches);
+}
+
+auto BufferPoolCounters::operator+=(const BufferPoolCounters &that) -> BufferPoolCounters & {
+  fetch_hits_ += that.fetch_hits_;
+  fetch_misses_ += that.fetch_misses_;
+  new_pages_ += that.new_pages_;
+  evictions_ += that.evictions_;
+  sync_write_backs_ += that.sync_write_backs_;
+  cleaner_write_backs_ += that.cleaner_write_backs_;
+  flushes_ += that.flushes_;
+  no_free_frames_ += that.no_free_frames_;
+  preloaded_pages_ += that.preloaded_pages_;
+  for (size_t i = 0; i < LATCH_WAIT_BUCKETS; ++i) {
+    latch_wait_ns_[i] += that.latch_wait_ns_[i];
+  }
+  return *this;
+}
+
+void BufferPoolStats::RecordLatchWait(uint64_t wait_ns) {
+  // The bucket is the bit width of the wait, i.e. floor(log2(wait_ns)) + 1.
+  size_t bucket = 0;
+  while (wait_ns != 0 && bucket < LATCH_WAIT_BUCKETS - 1) {
+    wait_ns >>= 1;
+    bucket++;
+  }
+  LocalShard().latch_wait_ns_[bucket].fetch_add(1, std::memory_order_relaxed);
+}
+
+auto BufferPoolStats::Snapshot() const -> BufferPoolCounters {
+  std::array<uint64_t, static_cast<size_t>(BufferPoolEvent::NUM_EVENTS)> events{};
+  BufferPoolCounters counters;
+  for (const auto &shard : shards_) {
+    for (size_t i = 0; i < events.size(); ++i) {
+      events[i] += shard.events_[i].load(std::memory_order_relaxed);
+    }
+    for (size_t i = 0; i < LATCH_WAIT_BUCKETS; ++i) {
+      counters.latch_wait_ns_[i] += shard.latch_wait_ns_[i].load(std::memory_order_relaxed);
+    }
+  }
+  counters.fetch_hits_ = events[static_cast<size_t>(BufferPoolEvent::FETCH_HIT)];
+  counters.fetch_misses_ = events[static_cast<size_t>(BufferPoolEvent::FETCH_MISS)];
+  counters.new_pages_ = events[static_cast<size_t>(BufferPoolEvent::NEW_PAGE)];
+  counters.evictions_ = events[static_cast<size_t>(BufferPoolEvent::EVICTION)];
+  counters.sync_write_backs_ = events[static_cast<size_t>(BufferPoolEvent::SYNC_WRITE_BACK)];
+  counters.cleaner_write_backs_ = events[static_cast<size_t>(BufferPoolEvent::CLEANER_WRITE_BACK)];
+  counters.flushes_ = events[static_cast<size_t>(BufferPoolEvent::FLUSH)];
+  counters.no_free_frames_ = events[static_cast<size_t>(BufferPoolEvent::NO_FREE_FRAME)];
+  counters.preloaded_pages_ = events[static_cast<size_t>(BufferPoolEvent::PRELOAD)];
+  return counters;
+}
+
+auto BufferPoolStats::ShardIndex() -> size_t {
+  static std::atomic<size_t> next_shard{0};
+  thread_local size_t shard = next_shard.fetch_add(1, std::memory_order_relaxed) % NUM_SHARDS;
+  return shard;
+}
+
+}  // namespace bustub
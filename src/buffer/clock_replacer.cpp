@@ -12,18 +12,85 @@
 
 #include "buffer/clock_replacer.h"
 
+#include "common/macros.h"
+
 namespace bustub {
 
-ClockReplacer::ClockReplacer(size_t num_pages) {}
+ClockReplacer::ClockReplacer(size_t num_pages)
+    : num_frames_(num_pages), states_(new std::atomic<uint8_t>[num_pages]) {
+  for (size_t i = 0; i < num_frames_; ++i) {
+    states_[i].store(0, std::memory_order_relaxed);
+  }
+}
 
 ClockReplacer::~ClockReplacer() = default;
 
-auto ClockReplacer::Victim(frame_id_t *frame_id) -> bool { return false; }
+auto ClockReplacer::Victim(frame_id_t *frame_id) -> bool {
+  if (num_frames_ == 0) {
+    return false;
+  }
+  while (true) {
+    // Give up only after a full sweep in which no frame was evictable at all. Frames that were evictable but got their
+    // reference bit cleared are fair game on the next sweep.
+    bool saw_evictable = false;
+    for (size_t i = 0; i < num_frames_; ++i) {
+      size_t pos = hand_.fetch_add(1, std::memory_order_relaxed) % num_frames_;
+      uint8_t state = states_[pos].load(std::memory_order_acquire);
+      if ((state & EVICTABLE) == 0) {
+        continue;
+      }
+      saw_evictable = true;
+      if ((state & REFERENCED) != 0) {
+        // Second chance. If this fails the frame was pinned or unpinned meanwhile, which is fine either way.
+        states_[pos].compare_exchange_strong(state, EVICTABLE, std::memory_order_acq_rel);
+        continue;
+      }
+      if (states_[pos].compare_exchange_strong(state, 0, std::memory_order_acq_rel)) {
+        *frame_id = static_cast<frame_id_t>(pos);
+        return true;
+      }
+    }
+    if (!saw_evictable) {
+      return false;
+    }
+  }
+}
+
+void ClockReplacer::Pin(frame_id_t frame_id) {
+  BUSTUB_ASSERT(static_cast<size_t>(frame_id) < num_frames_, "frame id out of range");
+  states_[frame_id].store(0, std::memory_order_release);
+}
 
-void ClockReplacer::Pin(frame_id_t frame_id) {}
+void ClockReplacer::Unpin(frame_id_t frame_id) {
+  BUSTUB_ASSERT(static_cast<size_t>(frame_id) < num_frames_, "frame id out of range");
+  states_[frame_id].store(EVICTABLE | REFERENCED, std::memory_order_release);
+}
 
-void ClockReplacer::Unpin(frame_id_t frame_id) {}
+auto ClockReplacer::Size() -> size_t {
+  size_t size = 0;
+  for (size_t i = 0; i < num_frames_; ++i) {
+    if ((states_[i].load(std::memory_order_relaxed) & EVICTABLE) != 0) {
+      size++;
+    }
+  }
+  return size;
+}
 
-auto ClockReplacer::Size() -> size_t { return 0; }
+auto ClockReplacer::GetEvictionOrder() -> std::vector<frame_id_t> {
+  std::vector<frame_id_t> unreferenced;
+  std::vector<frame_id_t> referenced;
+  size_t hand = hand_.load(std::memory_order_relaxed);
+  for (size_t i = 0; i < num_frames_; ++i) {
+    size_t pos = (hand + i) % num_frames_;
+    uint8_t state = states_[pos].load(std::memory_order_relaxed);
+    if ((state & EVICTABLE) == 0) {
+      continue;
+    }
+    ((state & REFERENCED) != 0 ? referenced : unreferenced).push_back(static_cast<frame_id_t>(pos));
+  }
+  // The hand clears the reference bits on its first sweep and takes the referenced frames on its second.
+  unreferenced.insert(unreferenced.end(), referenced.begin(), referenced.end());
+  return unreferenced;
+}
 
 }  // namespace bustub
@@ -0,0 +1,53 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// frame_arena.cpp
+//
+// Identification: src/buffer/frame_arena.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "buffer/frame_arena.h"
+
+#include <sys/mman.h>
+
+#include "common/exception.h"
+
+namespace bustub {
+
+FrameArena::FrameArena(size_t num_frames, bool use_huge_pages) : size_(num_frames * PAGE_SIZE) {
+  // An empty mapping is an error, and a pool without frames is legal.
+  if (size_ == 0) {
+    size_ = PAGE_SIZE;
+  }
+  void *base = MAP_FAILED;
+#ifdef MAP_HUGETLB
+  if (use_huge_pages) {
+    size_t huge_size = (size_ + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+    base = mmap(nullptr, huge_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (base != MAP_FAILED) {
+      size_ = huge_size;
+      huge_pages_ = true;
+    }
+  }
+#endif
+  if (base == MAP_FAILED) {
+    base = mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (base == MAP_FAILED) {
+      throw Exception(ExceptionType::OUT_OF_MEMORY, "can't map the buffer pool frames");
+    }
+#ifdef MADV_HUGEPAGE
+    if (use_huge_pages) {
+      madvise(base, size_, MADV_HUGEPAGE);
+    }
+#endif
+  }
+  base_ = static_cast<char *>(base);
+}
+
+FrameArena::~FrameArena() { munmap(base_, size_); }
+
+}  // namespace bustub
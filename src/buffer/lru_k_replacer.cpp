@@ -0,0 +1,160 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// lru_k_replacer.cpp
+//
+// Identification: src/buffer/lru_k_replacer.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "buffer/lru_k_replacer.h"
+
+#include <algorithm>
+#include <utility>
+
+#include "common/macros.h"
+
+namespace bustub {
+
+LRUKReplacer::LRUKReplacer(size_t num_pages, size_t k, size_t correlated_period)
+    : k_(k), correlated_period_(correlated_period), frames_(num_pages), hist_(num_pages * k) {
+  BUSTUB_ASSERT(k > 0, "LRU-K needs at least one reference per frame");
+}
+
+LRUKReplacer::~LRUKReplacer() = default;
+
+auto LRUKReplacer::Victim(frame_id_t *frame_id) -> bool {
+  std::lock_guard<std::mutex> lock(latch_);
+  if (num_evictable_ == 0) {
+    return false;
+  }
+  ExpireCorrelated();
+  // Prefer frames outside their correlated reference period; fall back to the others only if there are none.
+  const OrderKey &key = !uncorrelated_.empty() ? *uncorrelated_.begin() : *correlated_.begin();
+  frame_id_t victim = std::get<2>(key);
+  EraseEvictable(victim);
+  frames_[victim] = FrameHistory{};
+  *frame_id = victim;
+  return true;
+}
+
+auto LRUKReplacer::GetEvictionOrder() -> std::vector<frame_id_t> {
+  std::lock_guard<std::mutex> lock(latch_);
+  ExpireCorrelated();
+  std::vector<frame_id_t> order;
+  order.reserve(num_evictable_);
+  for (const auto *frames : {&uncorrelated_, &correlated_}) {
+    for (const auto &key : *frames) {
+      order.push_back(std::get<2>(key));
+    }
+  }
+  return order;
+}
+
+auto LRUKReplacer::GetOrderKey(frame_id_t frame_id) -> OrderKey {
+  const FrameHistory &frame = frames_[frame_id];
+  bool finite = frame.num_refs_ >= k_;
+  // With fewer than K references the backward K-distance is infinite; break ties by the oldest first reference.
+  uint64_t time = finite ? Hist(frame_id, k_ - 1) : Hist(frame_id, frame.num_refs_ == 0 ? 0 : frame.num_refs_ - 1);
+  return {finite, time, frame_id};
+}
+
+void LRUKReplacer::InsertEvictable(frame_id_t frame_id) {
+  FrameHistory &frame = frames_[frame_id];
+  frame.evictable_ = true;
+  frame.correlated_ = current_time_ - frame.last_ < correlated_period_;
+  if (frame.correlated_) {
+    correlated_.insert(GetOrderKey(frame_id));
+    correlated_by_last_.emplace(frame.last_, frame_id);
+  } else {
+    uncorrelated_.insert(GetOrderKey(frame_id));
+  }
+  num_evictable_++;
+}
+
+void LRUKReplacer::EraseEvictable(frame_id_t frame_id) {
+  FrameHistory &frame = frames_[frame_id];
+  // The history has not changed since the frame was inserted, so neither has its key.
+  if (frame.correlated_) {
+    correlated_.erase(GetOrderKey(frame_id));
+    correlated_by_last_.erase({frame.last_, frame_id});
+  } else {
+    uncorrelated_.erase(GetOrderKey(frame_id));
+  }
+  frame.evictable_ = false;
+  frame.correlated_ = false;
+  num_evictable_--;
+}
+
+void LRUKReplacer::ExpireCorrelated() {
+  while (!correlated_by_last_.empty() && current_time_ - correlated_by_last_.begin()->first >= correlated_period_) {
+    frame_id_t frame_id = correlated_by_last_.begin()->second;
+    correlated_by_last_.erase(correlated_by_last_.begin());
+    OrderKey key = GetOrderKey(frame_id);
+    correlated_.erase(key);
+    uncorrelated_.insert(key);
+    frames_[frame_id].correlated_ = false;
+  }
+}
+
+void LRUKReplacer::Pin(frame_id_t frame_id) {
+  std::lock_guard<std::mutex> lock(latch_);
+  BUSTUB_ASSERT(static_cast<size_t>(frame_id) < frames_.size(), "frame id out of range");
+  if (frames_[frame_id].evictable_) {
+    EraseEvictable(frame_id);
+  }
+  RecordReference(frame_id);
+}
+
+void LRUKReplacer::Unpin(frame_id_t frame_id) {
+  std::lock_guard<std::mutex> lock(latch_);
+  BUSTUB_ASSERT(static_cast<size_t>(frame_id) < frames_.size(), "frame id out of range");
+  FrameHistory &frame = frames_[frame_id];
+  if (frame.evictable_) {
+    return;
+  }
+  // A frame that was never pinned through us still needs a place in the eviction order.
+  if (frame.num_refs_ == 0) {
+    RecordReference(frame_id);
+  }
+  InsertEvictable(frame_id);
+}
+
+void LRUKReplacer::Remove(frame_id_t frame_id) {
+  std::lock_guard<std::mutex> lock(latch_);
+  BUSTUB_ASSERT(static_cast<size_t>(frame_id) < frames_.size(), "frame id out of range");
+  if (frames_[frame_id].evictable_) {
+    EraseEvictable(frame_id);
+  }
+  frames_[frame_id] = FrameHistory{};
+}
+
+auto LRUKReplacer::Size() -> size_t {
+  std::lock_guard<std::mutex> lock(latch_);
+  return num_evictable_;
+}
+
+void LRUKReplacer::RecordReference(frame_id_t frame_id) {
+  uint64_t now = ++current_time_;
+  FrameHistory &frame = frames_[frame_id];
+  if (frame.num_refs_ > 0 && now - frame.last_ < correlated_period_) {
+    // Correlated reference: it belongs to the same burst as the previous one.
+    frame.last_ = now;
+    return;
+  }
+  // Uncorrelated reference. Shift the history, moving older references forward by the length of the burst that
+  // just ended so that a burst is not mistaken for a long gap between references.
+  uint64_t correlation = frame.num_refs_ > 0 ? frame.last_ - Hist(frame_id, 0) : 0;
+  size_t keep = std::min(frame.num_refs_, k_ - 1);
+  for (size_t i = keep; i > 0; --i) {
+    Hist(frame_id, i) = Hist(frame_id, i - 1) + correlation;
+  }
+  Hist(frame_id, 0) = now;
+  frame.last_ = now;
+  frame.num_refs_ = keep + 1;
+}
+
+}  // namespace bustub
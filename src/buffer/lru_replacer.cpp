@@ -12,52 +12,81 @@
 
 #include "buffer/lru_replacer.h"
 
+#include "common/macros.h"
+
 namespace bustub {
 
-LRUReplacer::LRUReplacer(size_t num_pages) : capasity_(num_pages) {}
+LRUReplacer::LRUReplacer(size_t num_pages) : nodes_(num_pages) {}
 
 LRUReplacer::~LRUReplacer() = default;
 
 auto LRUReplacer::Victim(frame_id_t *frame_id) -> bool {
-  lock_.lock();
-  if (Size() == 0) {
-    lock_.unlock();
+  std::lock_guard<std::mutex> lock(lock_);
+  if (tail_ == NIL) {
     return false;
   }
-  *frame_id = list_.back();
-  mp_.erase(*frame_id);
-  list_.pop_back();
-  lock_.unlock();
+  *frame_id = tail_;
+  Unlink(tail_);
   return true;
 }
 
 void LRUReplacer::Pin(frame_id_t frame_id) {
-  lock_.lock();
-  if (mp_.count(frame_id) == 0) {
-    lock_.unlock();
-    return;
+  std::lock_guard<std::mutex> lock(lock_);
+  BUSTUB_ASSERT(static_cast<size_t>(frame_id) < nodes_.size(), "frame id out of range");
+  if (nodes_[frame_id].evictable_) {
+    Unlink(frame_id);
   }
-  auto c = mp_.find(frame_id);
-  list_.erase(c->second);
-  mp_.erase(frame_id);
-  lock_.unlock();
 }
 
 void LRUReplacer::Unpin(frame_id_t frame_id) {
-  lock_.lock();
-  if (mp_.count(frame_id) > 0) {
-    lock_.unlock();
+  std::lock_guard<std::mutex> lock(lock_);
+  BUSTUB_ASSERT(static_cast<size_t>(frame_id) < nodes_.size(), "frame id out of range");
+  Node &node = nodes_[frame_id];
+  // Unpinning an evictable frame again does not make it any more recent.
+  if (node.evictable_) {
     return;
   }
-  if (Size() >= capasity_) {
-    mp_.erase(list_.back());
-    list_.pop_back();
+  node.evictable_ = true;
+  node.prev_ = NIL;
+  node.next_ = head_;
+  if (head_ != NIL) {
+    nodes_[head_].prev_ = frame_id;
+  } else {
+    tail_ = frame_id;
+  }
+  head_ = frame_id;
+  size_++;
+}
+
+auto LRUReplacer::Size() -> size_t {
+  std::lock_guard<std::mutex> lock(lock_);
+  return size_;
+}
+
+auto LRUReplacer::GetEvictionOrder() -> std::vector<frame_id_t> {
+  std::lock_guard<std::mutex> lock(lock_);
+  std::vector<frame_id_t> order;
+  order.reserve(size_);
+  for (frame_id_t frame_id = tail_; frame_id != NIL; frame_id = nodes_[frame_id].prev_) {
+    order.push_back(frame_id);
   }
-  list_.push_front(frame_id);
-  mp_[frame_id] = list_.begin();
-  lock_.unlock();
+  return order;
 }
 
-auto LRUReplacer::Size() -> size_t { return list_.size(); }
+void LRUReplacer::Unlink(frame_id_t frame_id) {
+  Node &node = nodes_[frame_id];
+  if (node.prev_ != NIL) {
+    nodes_[node.prev_].next_ = node.next_;
+  } else {
+    head_ = node.next_;
+  }
+  if (node.next_ != NIL) {
+    nodes_[node.next_].prev_ = node.prev_;
+  } else {
+    tail_ = node.prev_;
+  }
+  node = Node{};
+  size_--;
+}
 
 }  // namespace bustub
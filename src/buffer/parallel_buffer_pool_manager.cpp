@@ -11,22 +11,42 @@
 //===----------------------------------------------------------------------===//
 
 #include "buffer/parallel_buffer_pool_manager.h"
+
+#include <algorithm>
+#include <thread>  // NOLINT
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
 #include "common/logger.h"
 
 namespace bustub {
 
 ParallelBufferPoolManager::ParallelBufferPoolManager(size_t num_instances, size_t pool_size, DiskManager *disk_manager,
-                                                     LogManager *log_manager) {
+                                                     LogManager *log_manager, const BufferPoolOptions &options)
+    : instance_pool_size_(pool_size),
+      buffer_pool_size_(num_instances * pool_size),
+      disk_manager_(disk_manager),
+      log_manager_(log_manager),
+      options_(options),
+      warmup_file_(options.warmup_file_) {
+  options_.warmup_file_.clear();
   // Allocate and create individual BufferPoolManagerInstances
-  this->buffer_pool_size_ = num_instances * pool_size;
-  this->start_new_page_idx_ = 0;
   for (size_t i = 0; i < num_instances; ++i) {
-    this->bpms_.emplace_back(new BufferPoolManagerInstance(pool_size, num_instances, i, disk_manager, log_manager));
+    this->bpms_.emplace_back(
+        new BufferPoolManagerInstance(pool_size, num_instances, i, disk_manager, log_manager, options_));
+  }
+  epochs_.push_back({0, bpms_});
+  if (!warmup_file_.empty()) {
+    PreloadResidentPages(warmup_file_);
   }
 }
 
 // Update constructor to destruct all BufferPoolManagerInstances and deallocate any associated memory
 ParallelBufferPoolManager::~ParallelBufferPoolManager() {
+  if (!warmup_file_.empty()) {
+    DumpResidentPages(warmup_file_);
+  }
   // 必须挨个进行释放，否则就会内存泄漏，直接clear(),不能释放内存
   for (auto &c : bpms_) {
     delete c;
@@ -40,60 +60,277 @@ auto ParallelBufferPoolManager::GetPoolSize() -> size_t {
   return this->buffer_pool_size_;
 }
 
+auto ParallelBufferPoolManager::GetCounters() const -> BufferPoolCounters {
+  resize_latch_.RLock();
+  BufferPoolCounters total = removed_counters_;
+  for (auto *bpm : bpms_) {
+    total += bpm->GetCounters();
+  }
+  resize_latch_.RUnlock();
+  return total;
+}
+
+auto ParallelBufferPoolManager::GetNumInstances() const -> size_t {
+  resize_latch_.RLock();
+  size_t num_instances = bpms_.size();
+  resize_latch_.RUnlock();
+  return num_instances;
+}
+
+auto ParallelBufferPoolManager::Resize(size_t num_instances, std::chrono::milliseconds drain_timeout) -> bool {
+  BUSTUB_ASSERT(num_instances > 0, "A buffer pool needs at least one instance");
+  std::lock_guard<std::mutex> resize_lock(resize_mutex_);
+  if (num_instances > bpms_.size()) {
+    resize_latch_.WLock();
+    page_id_t next_page_id = GetNextPageId();
+    while (bpms_.size() < num_instances) {
+      bpms_.emplace_back(new BufferPoolManagerInstance(instance_pool_size_, num_instances, bpms_.size(), disk_manager_,
+                                                       log_manager_, options_));
+    }
+    StartEpoch(next_page_id);
+    buffer_pool_size_ = num_instances * instance_pool_size_;
+    resize_latch_.WUnlock();
+    return true;
+  }
+  auto deadline = std::chrono::steady_clock::now() + drain_timeout;
+  while (bpms_.size() > num_instances) {
+    if (!RemoveInstance(deadline)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+auto ParallelBufferPoolManager::RemoveInstance(std::chrono::steady_clock::time_point deadline) -> bool {
+  // Only Resize() changes bpms_, so it can be read here without the latch.
+  BufferPoolManagerInstance *bpm = bpms_.back();
+  while (true) {
+    // Write back most of the dirty pages while the instance is still in use, so that everybody else is only held up
+    // for the ones dirtied since.
+    bpm->FlushAllDirtyPages();
+    resize_latch_.WLock();
+    if (bpm->GetPinnedFrameCount() == 0) {
+      break;
+    }
+    resize_latch_.WUnlock();
+    if (std::chrono::steady_clock::now() >= deadline) {
+      return false;
+    }
+    std::this_thread::sleep_for(RESIZE_RETRY_INTERVAL);
+  }
+
+  // Nobody can pin, let alone dirty, the instance's pages any more. Its own prefetch thread may still read pages in,
+  // but those are clean. The flush waits for the write-backs of its cleaner and evictions, which may leave a page
+  // dirty again, so nothing dirty is left when deleting it, which waits for its background threads.
+  page_id_t next_page_id = GetNextPageId();
+  bpm->FlushAllDirtyPages();
+  removed_counters_ += bpm->GetCounters();
+  bpms_.pop_back();
+  delete bpm;
+  // Its share of the older page ids passes to the remaining instances, which read those pages back from disk.
+  for (auto &epoch : epochs_) {
+    for (size_t i = 0; i < epoch.bpms_.size(); ++i) {
+      if (epoch.bpms_[i] == bpm) {
+        epoch.bpms_[i] = bpms_[i % bpms_.size()];
+      }
+    }
+  }
+  StartEpoch(next_page_id);
+  buffer_pool_size_ = bpms_.size() * instance_pool_size_;
+  resize_latch_.WUnlock();
+  return true;
+}
+
+auto ParallelBufferPoolManager::GetNextPageId() const -> page_id_t {
+  page_id_t next_page_id = 0;
+  for (auto *bpm : epochs_.back().bpms_) {
+    next_page_id = std::max(next_page_id, bpm->GetNextPageId());
+  }
+  return next_page_id;
+}
+
+void ParallelBufferPoolManager::StartEpoch(page_id_t next_page_id) {
+  // Start at a multiple of the number of instances, so that page_id % bpms_.size() still picks the instance.
+  auto num_instances = static_cast<page_id_t>(bpms_.size());
+  page_id_t first_page_id = (next_page_id + num_instances - 1) / num_instances * num_instances;
+  for (page_id_t i = 0; i < num_instances; ++i) {
+    bpms_[i]->SetPageIdAllocation(first_page_id + i, num_instances);
+  }
+  if (first_page_id == epochs_.back().first_page_id_) {
+    epochs_.back().bpms_ = bpms_;
+  } else {
+    epochs_.push_back({first_page_id, bpms_});
+  }
+}
+
 auto ParallelBufferPoolManager::GetBufferPoolManager(page_id_t page_id) -> BufferPoolManager * {
   // Get BufferPoolManager responsible for handling given page id. You can use this method in your other methods.
-  return bpms_[page_id % bpms_.size()];
+  // Most accesses go to recent pages, so look from the newest epoch back.
+  size_t epoch = epochs_.size() - 1;
+  while (epoch > 0 && page_id < epochs_[epoch].first_page_id_) {
+    epoch--;
+  }
+  const auto &bpms = epochs_[epoch].bpms_;
+  return bpms[page_id % bpms.size()];
 }
 
 auto ParallelBufferPoolManager::FetchPgImp(page_id_t page_id) -> Page * {
   // Fetch page for page_id from responsible BufferPoolManagerInstance
-  return GetBufferPoolManager(page_id)->FetchPage(page_id);
+  return FetchPgWithStrategyImp(page_id, nullptr);
+}
+
+auto ParallelBufferPoolManager::FetchPgWithStrategyImp(page_id_t page_id, BufferAccessStrategy *strategy) -> Page * {
+  // Each instance keeps its own ring in the strategy.
+  resize_latch_.RLock();
+  Page *page = GetBufferPoolManager(page_id)->FetchPageWithStrategy(page_id, strategy);
+  resize_latch_.RUnlock();
+  return page;
 }
 
 auto ParallelBufferPoolManager::UnpinPgImp(page_id_t page_id, bool is_dirty) -> bool {
   // Unpin page_id from responsible BufferPoolManagerInstance
   // 必须通过父类调用子类中protected修饰的函数
   // LOG_DEBUG("%lu", page_id_to_instance_[page_id]);
-  return GetBufferPoolManager(page_id)->UnpinPage(page_id, is_dirty);
+  resize_latch_.RLock();
+  bool unpinned = GetBufferPoolManager(page_id)->UnpinPage(page_id, is_dirty);
+  resize_latch_.RUnlock();
+  return unpinned;
+}
+
+auto ParallelBufferPoolManager::UnpinFrameImp(Page *page, bool is_dirty) -> bool {
+  resize_latch_.RLock();
+  bool unpinned = GetBufferPoolManager(page->GetPageId())->UnpinPageFrame(page, is_dirty);
+  resize_latch_.RUnlock();
+  return unpinned;
 }
 
 auto ParallelBufferPoolManager::FlushPgImp(page_id_t page_id) -> bool {
   // Flush page_id from responsible BufferPoolManagerInstance
-  return GetBufferPoolManager(page_id)->FlushPage(page_id);
+  resize_latch_.RLock();
+  bool flushed = GetBufferPoolManager(page_id)->FlushPage(page_id);
+  resize_latch_.RUnlock();
+  return flushed;
 }
 
 auto ParallelBufferPoolManager::NewPgImp(page_id_t *page_id) -> Page * {
+  return NewPgWithStrategyImp(page_id, nullptr);
+}
+
+auto ParallelBufferPoolManager::NewPgWithStrategyImp(page_id_t *page_id, BufferAccessStrategy *strategy) -> Page * {
   // create new page. We will request page allocation in a round robin manner from the underlying
   // BufferPoolManagerInstances
   // 1.   From a starting index of the BPMIs, call NewPageImpl until either 1) success and return 2) looped around to
   // starting index and return nullptr
   // 2.   Bump the starting index (mod number of instances) to start search at a different BPMI each time this function
   // is called
-  std::lock_guard<std::mutex> lock(latch_);
+  // 起始位置原子递增，并发分配页时不再争用同一把锁
+  resize_latch_.RLock();
+  size_t num_instances = bpms_.size();
+  size_t start = start_new_page_idx_.fetch_add(1, std::memory_order_relaxed) % num_instances;
 
+  // First pass: only instances with free frames, which can create the page without evicting anything.
   Page *page = nullptr;
-  for (size_t i = 0; i < bpms_.size(); ++i) {
-    page = bpms_[start_new_page_idx_]->NewPage(page_id);
-    start_new_page_idx_ = (start_new_page_idx_ + 1) % bpms_.size();
-    if (page != nullptr) {
-      return page;
+  for (size_t i = 0; i < num_instances && page == nullptr; ++i) {
+    auto *bpm = bpms_[(start + i) % num_instances];
+    if (bpm->GetFreeFrameCount() > 0) {
+      page = bpm->NewPageWithStrategy(page_id, strategy);
     }
   }
-  return nullptr;
+  // Second pass: every instance, evicting if need be.
+  for (size_t i = 0; i < num_instances && page == nullptr; ++i) {
+    page = bpms_[(start + i) % num_instances]->NewPageWithStrategy(page_id, strategy);
+  }
+  resize_latch_.RUnlock();
+  return page;
 }
 
 auto ParallelBufferPoolManager::DeletePgImp(page_id_t page_id) -> bool {
   // Delete page_id from responsible BufferPoolManagerInstance
+  resize_latch_.RLock();
+  bool deleted = GetBufferPoolManager(page_id)->DeletePage(page_id);
+  resize_latch_.RUnlock();
+  return deleted;
+}
 
-  return GetBufferPoolManager(page_id)->DeletePage(page_id);
+void ParallelBufferPoolManager::PrefetchPgsImp(const std::vector<page_id_t> &page_ids,
+                                               std::shared_ptr<BufferAccessStrategy> strategy) {
+  resize_latch_.RLock();
+  std::unordered_map<BufferPoolManager *, std::vector<page_id_t>> instance_page_ids;
+  for (auto page_id : page_ids) {
+    if (page_id < 0) {
+      continue;
+    }
+    instance_page_ids[GetBufferPoolManager(page_id)].push_back(page_id);
+  }
+  for (auto &[bpm, ids] : instance_page_ids) {
+    bpm->PrefetchPages(ids, strategy);
+  }
+  resize_latch_.RUnlock();
+}
+
+auto ParallelBufferPoolManager::GetResidentPgsImp() -> std::vector<page_id_t> {
+  resize_latch_.RLock();
+  std::vector<std::vector<page_id_t>> instance_page_ids;
+  size_t longest = 0;
+  for (auto *bpm : bpms_) {
+    instance_page_ids.push_back(bpm->GetResidentPages());
+    longest = std::max(longest, instance_page_ids.back().size());
+  }
+  resize_latch_.RUnlock();
+  std::vector<page_id_t> page_ids;
+  for (size_t i = 0; i < longest; ++i) {
+    for (const auto &ids : instance_page_ids) {
+      if (i < ids.size()) {
+        page_ids.push_back(ids[i]);
+      }
+    }
+  }
+  return page_ids;
+}
+
+auto ParallelBufferPoolManager::GetDirtyPageTableImp() -> std::vector<std::pair<page_id_t, lsn_t>> {
+  resize_latch_.RLock();
+  std::vector<std::pair<page_id_t, lsn_t>> dirty_pages;
+  for (auto *bpm : bpms_) {
+    auto instance_dirty_pages = bpm->GetDirtyPageTable();
+    dirty_pages.insert(dirty_pages.end(), instance_dirty_pages.begin(), instance_dirty_pages.end());
+  }
+  resize_latch_.RUnlock();
+  return dirty_pages;
+}
+
+void ParallelBufferPoolManager::PreloadPgsImp(std::vector<page_id_t> page_ids) {
+  resize_latch_.RLock();
+  std::unordered_map<BufferPoolManager *, std::vector<page_id_t>> instance_page_ids;
+  for (auto page_id : page_ids) {
+    if (page_id >= 0) {
+      instance_page_ids[GetBufferPoolManager(page_id)].push_back(page_id);
+    }
+  }
+  for (auto &[bpm, ids] : instance_page_ids) {
+    bpm->PreloadPages(std::move(ids));
+  }
+  resize_latch_.RUnlock();
 }
 
 void ParallelBufferPoolManager::FlushAllPgsImp() {
   // flush all pages from all BufferPoolManagerInstances
-  // 这里必须采用删除的方式，因为bpms内部是指针，指针必须手动释放，只能在这个函数进行释放。
-  for (auto c : bpms_) {
-    delete c;
+  // 实例由析构函数释放，这里只刷脏页
+  FlushDirtyPgsImp();
+}
+
+auto ParallelBufferPoolManager::FlushDirtyPgsImp() -> FlushStats {
+  // Page ids are striped over the instances, so neighbouring pages live in different instances. Collecting them all
+  // first lets a run span instances.
+  resize_latch_.RLock();
+  std::vector<BufferPoolManagerInstance::DirtyPage> dirty;
+  for (auto *bpm : bpms_) {
+    bpm->CollectDirtyPages(&dirty);
   }
+  // Keep the latch, so that no instance is removed while its pages are written.
+  FlushStats stats = BufferPoolManagerInstance::WriteDirtyPages(std::move(dirty), bpms_.size());
+  resize_latch_.RUnlock();
+  return stats;
 }
 
 }  // namespace bustub
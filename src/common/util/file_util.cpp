@@ -0,0 +1,57 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// file_util.cpp
+//
+// Identification: src/common/util/file_util.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "common/util/file_util.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstdio>
+#include <filesystem>
+
+namespace bustub {
+
+auto FileUtil::ReplaceFile(const std::string &file_name, const char *data, size_t size) -> bool {
+  std::string tmp_name = file_name + ".tmp";
+  int fd = open(tmp_name.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0) {
+    return false;
+  }
+  size_t written = 0;
+  while (written < size) {
+    ssize_t rc = pwrite(fd, data + written, size - written, written);
+    if (rc < 0 && errno == EINTR) {
+      continue;
+    }
+    if (rc < 0) {
+      break;
+    }
+    written += rc;
+  }
+  bool ok = written == size && fdatasync(fd) == 0;
+  close(fd);
+  return ok && rename(tmp_name.c_str(), file_name.c_str()) == 0 && SyncDirectory(file_name);
+}
+
+auto FileUtil::SyncDirectory(const std::string &file_name) -> bool {
+  std::filesystem::path path(file_name);
+  std::string dir = path.has_parent_path() ? path.parent_path().string() : std::string(".");
+  int fd = open(dir.c_str(), O_RDONLY | O_DIRECTORY);
+  if (fd < 0) {
+    return false;
+  }
+  bool ok = fsync(fd) == 0;
+  close(fd);
+  return ok;
+}
+
+}  // namespace bustub
@@ -16,6 +16,7 @@
 #include <unordered_set>
 
 #include "catalog/catalog.h"
+#include "common/exception.h"
 #include "storage/table/table_heap.h"
 
 namespace bustub {
@@ -31,6 +32,17 @@ auto TransactionManager::Begin(Transaction *txn, IsolationLevel isolation_level)
   if (txn == nullptr) {
     txn = new Transaction(next_txn_id_++, isolation_level);
   }
+  // Registered before its BEGIN record is appended, so that a checkpoint either sees the transaction or starts after
+  // that record.
+  {
+    std::lock_guard<std::mutex> lock(active_latch_);
+    active_txns_[txn->GetTransactionId()] = {txn, log_manager_ != nullptr ? log_manager_->GetNextLSN() : INVALID_LSN};
+  }
+  if (enable_logging && log_manager_ != nullptr) {
+    LogRecord log_record(txn->GetTransactionId(), txn->GetPrevLSN(), LogRecordType::BEGIN);
+    txn->SetPrevLSN(log_manager_->AppendLogRecord(&log_record));
+  }
+
   txn_map_mutex.lock();
   txn_map[txn->GetTransactionId()] = txn;
   txn_map_mutex.unlock();
@@ -53,10 +65,24 @@ void TransactionManager::Commit(Transaction *txn) {
   }
   write_set->clear();
 
+  // The transaction is committed once its COMMIT record is on disk. It waits for that with its locks held; the
+  // commits that come in meanwhile share the same log write.
+  bool durable = true;
+  if (enable_logging && log_manager_ != nullptr) {
+    LogRecord log_record(txn->GetTransactionId(), txn->GetPrevLSN(), LogRecordType::COMMIT);
+    lsn_t lsn = log_manager_->AppendLogRecord(&log_record);
+    txn->SetPrevLSN(lsn);
+    durable = log_manager_->Flush(lsn);
+  }
+  UnregisterTransaction(txn);
+
   // Release all the locks.
   ReleaseLocks(txn);
   // Release the global transaction latch.
   global_txn_latch_.RUnlock();
+  if (!durable) {
+    throw Exception("the COMMIT record could not be written to the log");
+  }
 }
 
 void TransactionManager::Abort(Transaction *txn) {
@@ -103,12 +129,37 @@ void TransactionManager::Abort(Transaction *txn) {
   table_write_set->clear();
   index_write_set->clear();
 
+  // Recovery undoes an aborted transaction anyway, so the ABORT record need not wait for the disk.
+  if (enable_logging && log_manager_ != nullptr) {
+    LogRecord log_record(txn->GetTransactionId(), txn->GetPrevLSN(), LogRecordType::ABORT);
+    txn->SetPrevLSN(log_manager_->AppendLogRecord(&log_record));
+  }
+  UnregisterTransaction(txn);
+
   // Release all the locks.
   ReleaseLocks(txn);
   // Release the global transaction latch.
   global_txn_latch_.RUnlock();
 }
 
+auto TransactionManager::GetActiveTransactionTable(lsn_t *first_lsn) -> std::vector<std::pair<txn_id_t, lsn_t>> {
+  std::vector<std::pair<txn_id_t, lsn_t>> active_txns;
+  *first_lsn = INVALID_LSN;
+  std::lock_guard<std::mutex> lock(active_latch_);
+  for (const auto &[txn_id, entry] : active_txns_) {
+    active_txns.emplace_back(txn_id, entry.first->GetPrevLSN());
+    if (*first_lsn == INVALID_LSN || entry.second < *first_lsn) {
+      *first_lsn = entry.second;
+    }
+  }
+  return active_txns;
+}
+
+void TransactionManager::UnregisterTransaction(Transaction *txn) {
+  std::lock_guard<std::mutex> lock(active_latch_);
+  active_txns_.erase(txn->GetTransactionId());
+}
+
 void TransactionManager::BlockAllTransactions() { global_txn_latch_.WLock(); }
 // resume恢复
 void TransactionManager::ResumeTransactions() { global_txn_latch_.WUnlock(); }
@@ -31,11 +31,11 @@ void InsertExecutor::Init() {
   table_heap_ = table_info_->table_.get();
 }
 
-void InsertExecutor::InsertIntoDataAndIndex(Tuple *tuple) {
+void InsertExecutor::InsertIntoDataAndIndex(Tuple *tuple, BufferAccessStrategy *strategy) {
   // 插入数据,插入数据的时候，rid初始是没有数据的，只有插入成功的时候，才会生成！！！
   // RID rid = tuple.GetRid();
   RID rid;
-  if (!table_heap_->InsertTuple(*tuple, &rid, GetExecutorContext()->GetTransaction())) {
+  if (!table_heap_->InsertTuple(*tuple, &rid, GetExecutorContext()->GetTransaction(), strategy)) {
     throw Exception(ExceptionType::OUT_OF_MEMORY, "没有足够的内存插入");
   }
   LockManager *lock_manager = exec_ctx_->GetLockManager();
@@ -92,8 +92,10 @@ auto InsertExecutor::Next([[maybe_unused]] Tuple *tuple, RID *rid) -> bool {
     throw Exception(ExceptionType::UNKNOWN_TYPE, "insert:executor_child_error");
     return false;
   }
+  // INSERT ... SELECT may add a lot of pages; fill them through a ring instead of the whole buffer pool.
+  BufferAccessStrategy strategy(BufferAccessStrategyType::BULKWRITE);
   for (auto &c : arr) {
-    InsertIntoDataAndIndex(&c);
+    InsertIntoDataAndIndex(&c, &strategy);
   }
   // delete table_heap_;
   return false;
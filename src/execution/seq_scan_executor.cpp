@@ -12,6 +12,8 @@
 
 #include "execution/executors/seq_scan_executor.h"
 
+#include <memory>
+
 namespace bustub {
 // 有参构造对象作为成员变量必须要再初始化列表中赋值, 可以虚拟构造一个，重新赋值。父类的成员变量子类也是可以使用的。
 SeqScanExecutor::SeqScanExecutor(ExecutorContext *exec_ctx, const SeqScanPlanNode *plan)
@@ -21,7 +23,9 @@ void SeqScanExecutor::Init() {
   // table_info有操作对象和操作模式
   TableInfo *table_info = exec_ctx_->GetCatalog()->GetTable(plan_->GetTableOid());
   this->table_heap_ = table_info->table_.get();
-  iterator_ = table_heap_->Begin(exec_ctx_->GetTransaction());
+  // Scan through a small ring of frames, so that a large table does not flush everybody else's pages out of the pool.
+  iterator_ = table_heap_->Begin(exec_ctx_->GetTransaction(),
+                                 std::make_shared<BufferAccessStrategy>(BufferAccessStrategyType::BULKREAD));
 }
 // RID作为一条记录的identifier
 auto SeqScanExecutor::Next(Tuple *tuple, RID *rid) -> bool {
@@ -0,0 +1,103 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// buffer_access_strategy.h
+//
+// Identification: src/include/buffer/buffer_access_strategy.h
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <cstddef>
+#include <mutex>  // NOLINT
+#include <unordered_map>
+#include <vector>
+
+#include "common/config.h"
+
+namespace bustub {
+
+/** Access patterns that get their own small ring of frames instead of competing for the whole buffer pool. */
+enum class BufferAccessStrategyType {
+  /** A large sequential read, e.g. a sequential scan. */
+  BULKREAD,
+  /** A large sequential write, e.g. INSERT ... SELECT. */
+  BULKWRITE,
+};
+
+/** A frame handed to a strategy, and the page it was loaded with. */
+struct RingSlot {
+  frame_id_t frame_id_{-1};
+  page_id_t page_id_{INVALID_PAGE_ID};
+};
+
+/**
+ * BufferAccessStrategy lets a bulk operation recycle a small private ring of frames. When a page it asks for is not
+ * resident, the buffer pool reuses the frame the operation loaded a full ring ago, provided nobody else has pinned or
+ * taken it since, rather than evicting somebody else's page. Pages that are already resident are simply pinned as
+ * usual, so a scan of a table that fits in the pool still hits its cached pages.
+ *
+ * A strategy belongs to one operation. It keeps one ring per BufferPoolManagerInstance, so the same strategy can be
+ * used with a ParallelBufferPoolManager, and instances may use their rings from different threads; each ring must only
+ * be used by one thread at a time.
+ */
+class BufferAccessStrategy {
+ public:
+  /** Ring size of BULKREAD, in pages. */
+  static constexpr size_t BULKREAD_RING_SIZE = 64;
+  /** Ring size of BULKWRITE, in pages. Larger, so that its dirty pages can be written back lazily. */
+  static constexpr size_t BULKWRITE_RING_SIZE = 4096;
+  /** Largest share of a buffer pool a ring may occupy, as a divisor of the pool size. */
+  static constexpr size_t RING_POOL_FRACTION = 8;
+
+  explicit BufferAccessStrategy(BufferAccessStrategyType type);
+
+  /** @return the access pattern this strategy was created for */
+  auto GetType() const -> BufferAccessStrategyType { return type_; }
+
+  /** @return the number of frames the operation may recycle, summed over all buffer pool instances */
+  auto GetRingSize() const -> size_t { return ring_size_; }
+
+  /**
+   * @param pool_size number of frames of the buffer pool, or of one of its instances
+   * @param num_instances how many instances the ring is split across
+   * @return how many frames the ring actually gets in a buffer pool of that size. Never less than two, since a scan
+   * fetches the next page before unpinning the current one.
+   */
+  auto GetRingFrames(size_t pool_size, size_t num_instances = 1) const -> size_t;
+
+  /**
+   * Advance the ring of a buffer pool instance and return its current slot. The instance reuses the slot's frame if
+   * it still holds the slot's page, and records the frame it ends up using in the slot.
+   * @param instance_index index of the buffer pool instance
+   * @param ring_frames size of that instance's ring, only used the first time the instance asks
+   * @return the slot to reuse or fill
+   */
+  auto NextSlot(uint32_t instance_index, size_t ring_frames) -> RingSlot *;
+
+  /** @return the page a bulk insert last added a tuple to, or INVALID_PAGE_ID */
+  auto GetLastPageId() const -> page_id_t { return last_page_id_; }
+
+  /** Remember the page a bulk insert added a tuple to, so that the next insert starts looking for space there. */
+  void SetLastPageId(page_id_t page_id) { last_page_id_ = page_id; }
+
+ private:
+  struct Ring {
+    std::vector<RingSlot> slots_;
+    size_t next_{0};
+  };
+
+  const BufferAccessStrategyType type_;
+  const size_t ring_size_;
+  /** Protects the map of rings_, not the rings themselves. */
+  std::mutex latch_;
+  /** Rings by buffer pool instance index. Slot pointers stay valid when other instances add their rings. */
+  std::unordered_map<uint32_t, Ring> rings_;
+  page_id_t last_page_id_{INVALID_PAGE_ID};
+};
+
+}  // namespace bustub
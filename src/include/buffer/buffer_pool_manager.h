@@ -12,17 +12,34 @@
 
 #pragma once
 
+#include <cstdint>
 #include <list>
+#include <memory>
 #include <mutex>  // NOLINT
+#include <string>
 #include <unordered_map>
+#include <utility>
+#include <vector>
 
+#include "buffer/buffer_access_strategy.h"
 #include "buffer/lru_replacer.h"
 #include "recovery/log_manager.h"
 #include "storage/disk/disk_manager.h"
 #include "storage/page/page.h"
+#include "storage/page/page_guard.h"
 
 namespace bustub {
 
+/** What a FlushAllDirtyPages() call wrote. */
+struct FlushStats {
+  /** Dirty pages written back. */
+  uint64_t pages_written_{0};
+  /** Bytes written back. */
+  uint64_t bytes_written_{0};
+  /** Write requests issued to the disk manager; a run of pages with consecutive ids takes one. */
+  uint64_t writes_{0};
+};
+
 /**
  * BufferPoolManager reads disk pages to and from its internal buffer pool.
  */
@@ -84,6 +101,127 @@ class BufferPoolManager {
     GradingCallback(callback, CallbackType::AFTER, INVALID_PAGE_ID);
   }
 
+  /**
+   * Write every dirty page back to disk, e.g. for a checkpoint. Clean pages are skipped, and pages with consecutive
+   * ids are written together in one request.
+   * @return how much was written
+   */
+  auto FlushAllDirtyPages() -> FlushStats { return FlushDirtyPgsImp(); }
+
+  /**
+   * Fetch a page on behalf of a bulk operation. A miss recycles a frame of the strategy's ring instead of evicting
+   * other pages. Pages fetched this way are unpinned with UnpinPage() as usual.
+   * @param page_id id of page to be fetched
+   * @param strategy the operation's access strategy, nullptr behaves like FetchPage()
+   * @return the requested page
+   */
+  auto FetchPageWithStrategy(page_id_t page_id, BufferAccessStrategy *strategy) -> Page * {
+    return FetchPgWithStrategyImp(page_id, strategy);
+  }
+
+  /**
+   * Create a page on behalf of a bulk operation, taking its frame from the strategy's ring when possible.
+   * @param[out] page_id id of created page
+   * @param strategy the operation's access strategy, nullptr behaves like NewPage()
+   * @return nullptr if no new pages could be created, otherwise pointer to new page
+   */
+  auto NewPageWithStrategy(page_id_t *page_id, BufferAccessStrategy *strategy) -> Page * {
+    return NewPgWithStrategyImp(page_id, strategy);
+  }
+
+  /**
+   * Ask for pages to be read into the buffer pool in the background, e.g. ahead of a sequential scan. The pages are
+   * not pinned; a later FetchPage() either finds them resident or waits for the read that is in flight. Requests for
+   * pages past the end of the database file are ignored, and so are requests that cannot be queued right away.
+   * @param page_ids ids of the pages to read, in the order they will be needed
+   * @param strategy access strategy whose ring the pages are read into, nullptr to read them into the pool
+   */
+  void PrefetchPages(const std::vector<page_id_t> &page_ids, std::shared_ptr<BufferAccessStrategy> strategy = nullptr) {
+    PrefetchPgsImp(page_ids, std::move(strategy));
+  }
+
+  /** @return the ids of the resident pages, the hottest first: pinned pages, then the others by recency of use */
+  auto GetResidentPages() -> std::vector<page_id_t> { return GetResidentPgsImp(); }
+
+  /**
+   * The dirty page table of a fuzzy checkpoint: every page that may differ from its copy on disk, with its recovery
+   * LSN. Redo of a page can start at its recovery LSN; pages that are not listed need no redo of older records.
+   * @return (page id, recovery LSN) of the pages that are dirty, pinned or being written
+   */
+  auto GetDirtyPageTable() -> std::vector<std::pair<page_id_t, lsn_t>> { return GetDirtyPageTableImp(); }
+
+  /**
+   * Read pages into the free frames of the buffer pool in the background, e.g. to warm it up after a restart. As many
+   * of the first pages as fit are read, sorted by page id so that consecutive pages take one request. Pages that are
+   * already resident are skipped and nothing is evicted, so this can run alongside normal traffic.
+   * @param page_ids ids of the pages to read, the most important first
+   */
+  void PreloadPages(std::vector<page_id_t> page_ids) { PreloadPgsImp(std::move(page_ids)); }
+
+  /**
+   * Write GetResidentPages() to a file, for PreloadResidentPages() to read after a restart.
+   * @param file_name the file to write
+   * @return false if the file could not be written
+   */
+  auto DumpResidentPages(const std::string &file_name) -> bool;
+
+  /**
+   * Start to PreloadPages() the pages listed in a file written by DumpResidentPages().
+   * @param file_name the file to read
+   * @return false if the file could not be read
+   */
+  auto PreloadResidentPages(const std::string &file_name) -> bool;
+
+  /**
+   * Fetch a page and wrap it in a guard that unpins it when it goes out of scope. The page is not latched.
+   * @param page_id id of page to be fetched
+   * @param strategy access strategy of a bulk operation, may be nullptr
+   * @return a guard for the page, invalid if the page could not be fetched
+   */
+  auto FetchPageBasic(page_id_t page_id, BufferAccessStrategy *strategy = nullptr) -> BasicPageGuard {
+    return {this, FetchPgWithStrategyImp(page_id, strategy)};
+  }
+
+  /**
+   * Fetch a page and read-latch it. The guard releases the latch and unpins the page when it goes out of scope.
+   * @param page_id id of page to be fetched
+   * @param strategy access strategy of a bulk operation, may be nullptr
+   * @return a guard for the page, invalid if the page could not be fetched
+   */
+  auto FetchPageRead(page_id_t page_id, BufferAccessStrategy *strategy = nullptr) -> ReadPageGuard {
+    return {this, FetchPgWithStrategyImp(page_id, strategy)};
+  }
+
+  /**
+   * Fetch a page and write-latch it. The guard releases the latch and unpins the page when it goes out of scope,
+   * marking it dirty if it was modified through the guard.
+   * @param page_id id of page to be fetched
+   * @param strategy access strategy of a bulk operation, may be nullptr
+   * @return a guard for the page, invalid if the page could not be fetched
+   */
+  auto FetchPageWrite(page_id_t page_id, BufferAccessStrategy *strategy = nullptr) -> WritePageGuard {
+    return {this, FetchPgWithStrategyImp(page_id, strategy)};
+  }
+
+  /**
+   * Create a page and wrap it in a guard. The new page is unlatched; use UpgradeWrite() to latch it.
+   * @param[out] page_id id of created page
+   * @param strategy access strategy of a bulk operation, may be nullptr
+   * @return a guard for the page, invalid if no new page could be created
+   */
+  auto NewPageGuarded(page_id_t *page_id, BufferAccessStrategy *strategy = nullptr) -> BasicPageGuard {
+    return {this, NewPgWithStrategyImp(page_id, strategy)};
+  }
+
+  /**
+   * Unpin a page the caller holds a pin on. Unlike UnpinPage() this starts from the frame, so the page table need
+   * not be searched. Used by the page guards.
+   * @param page the pinned page
+   * @param is_dirty true if the page should be marked as dirty, false otherwise
+   * @return false if the page pin count is <= 0 before this call, true otherwise
+   */
+  auto UnpinPageFrame(Page *page, bool is_dirty) -> bool { return UnpinFrameImp(page, is_dirty); }
+
   /** @return size of the buffer pool */
   virtual auto GetPoolSize() -> size_t = 0;
 
@@ -108,6 +246,18 @@ class BufferPoolManager {
    */
   virtual auto FetchPgImp(page_id_t page_id) -> Page * = 0;
 
+  /**
+   * Fetch the requested page, recycling the strategy's ring on a miss. Buffer pools without ring support ignore the
+   * strategy.
+   * @param page_id id of page to be fetched
+   * @param strategy access strategy of the caller, may be nullptr
+   * @return the requested page
+   */
+  virtual auto FetchPgWithStrategyImp(page_id_t page_id, __attribute__((unused)) BufferAccessStrategy *strategy)
+      -> Page * {
+    return FetchPgImp(page_id);
+  }
+
   /**
    * Unpin the target page from the buffer pool.
    * @param page_id id of page to be unpinned
@@ -116,6 +266,14 @@ class BufferPoolManager {
    */
   virtual auto UnpinPgImp(page_id_t page_id, bool is_dirty) -> bool = 0;
 
+  /**
+   * Unpin a page given its frame. Buffer pools that cannot find the frame's state directly look the page up.
+   * @param page the pinned page
+   * @param is_dirty true if the page should be marked as dirty, false otherwise
+   * @return false if the page pin count is <= 0 before this call, true otherwise
+   */
+  virtual auto UnpinFrameImp(Page *page, bool is_dirty) -> bool { return UnpinPgImp(page->GetPageId(), is_dirty); }
+
   /**
    * Flushes the target page to disk.
    * @param page_id id of page to be flushed, cannot be INVALID_PAGE_ID
@@ -130,6 +288,18 @@ class BufferPoolManager {
    */
   virtual auto NewPgImp(page_id_t *page_id) -> Page * = 0;
 
+  /**
+   * Creates a new page, taking its frame from the strategy's ring when possible. Buffer pools without ring support
+   * ignore the strategy.
+   * @param[out] page_id id of created page
+   * @param strategy access strategy of the caller, may be nullptr
+   * @return nullptr if no new pages could be created, otherwise pointer to new page
+   */
+  virtual auto NewPgWithStrategyImp(page_id_t *page_id, __attribute__((unused)) BufferAccessStrategy *strategy)
+      -> Page * {
+    return NewPgImp(page_id);
+  }
+
   /**
    * Deletes a page from the buffer pool.
    * @param page_id id of page to be deleted
@@ -141,5 +311,41 @@ class BufferPoolManager {
    * Flushes all the pages in the buffer pool to disk.
    */
   virtual void FlushAllPgsImp() = 0;
+
+  /**
+   * Flushes the dirty pages in the buffer pool to disk. Buffer pools that do not implement it flush all pages and
+   * report nothing.
+   * @return how much was written
+   */
+  virtual auto FlushDirtyPgsImp() -> FlushStats {
+    FlushAllPgsImp();
+    return {};
+  }
+
+  /**
+   * Read pages in the background. Buffer pools without a prefetcher ignore the request.
+   * @param page_ids ids of the pages to read
+   * @param strategy access strategy whose ring the pages are read into, may be nullptr
+   */
+  virtual void PrefetchPgsImp(__attribute__((unused)) const std::vector<page_id_t> &page_ids,
+                              __attribute__((unused)) std::shared_ptr<BufferAccessStrategy> strategy) {}
+
+  /**
+   * List the resident pages. Buffer pools that do not implement it report none.
+   * @return the ids of the resident pages, the hottest first
+   */
+  virtual auto GetResidentPgsImp() -> std::vector<page_id_t> { return {}; }
+
+  /**
+   * List the pages that may differ from disk. Buffer pools that do not track recovery LSNs report none.
+   * @return (page id, recovery LSN) of those pages
+   */
+  virtual auto GetDirtyPageTableImp() -> std::vector<std::pair<page_id_t, lsn_t>> { return {}; }
+
+  /**
+   * Read pages into free frames in the background. Buffer pools without a preloader ignore the request.
+   * @param page_ids ids of the pages to read, the most important first
+   */
+  virtual void PreloadPgsImp(__attribute__((unused)) std::vector<page_id_t> page_ids) {}
 };
 }  // namespace bustub
@@ -12,12 +12,24 @@
 
 #pragma once
 
+#include <array>
+#include <chrono>  // NOLINT
+#include <condition_variable>  // NOLINT
+#include <deque>
+#include <future>  // NOLINT
 #include <list>
+#include <memory>
 // nolint如果有警告跳过，告诉计算机我确认这里没问题
-#include <mutex>  // NOLINT
+#include <mutex>   // NOLINT
+#include <thread>  // NOLINT
 #include <unordered_map>
+#include <utility>
+#include <vector>
 
 #include "buffer/buffer_pool_manager.h"
+#include "buffer/buffer_pool_options.h"
+#include "buffer/frame_arena.h"
+#include "buffer/buffer_pool_stats.h"
 #include "buffer/lru_replacer.h"
 #include "recovery/log_manager.h"
 #include "storage/disk/disk_manager.h"
@@ -35,8 +47,10 @@ class BufferPoolManagerInstance : public BufferPoolManager {
    * @param pool_size the size of the buffer pool
    * @param disk_manager the disk manager
    * @param log_manager the log manager (for testing only: nullptr = disable logging)
+   * @param options replacement policy and other settings of the buffer pool
    */
-  BufferPoolManagerInstance(size_t pool_size, DiskManager *disk_manager, LogManager *log_manager = nullptr);
+  BufferPoolManagerInstance(size_t pool_size, DiskManager *disk_manager, LogManager *log_manager = nullptr,
+                            const BufferPoolOptions &options = BufferPoolOptions());
   /**
    * Creates a new BufferPoolManagerInstance.
    * @param pool_size the size of the buffer pool
@@ -44,9 +58,11 @@ class BufferPoolManagerInstance : public BufferPoolManager {
    * @param instance_index index of this BPI in the parallel BPM
    * @param disk_manager the disk manager
    * @param log_manager the log manager (for testing only: nullptr = disable logging)
+   * @param options replacement policy and other settings of the buffer pool
    */
   BufferPoolManagerInstance(size_t pool_size, uint32_t num_instances, uint32_t instance_index,
-                            DiskManager *disk_manager, LogManager *log_manager = nullptr);
+                            DiskManager *disk_manager, LogManager *log_manager = nullptr,
+                            const BufferPoolOptions &options = BufferPoolOptions());
 
   /**
    * Destroys an existing BufferPoolManagerInstance.
@@ -59,6 +75,64 @@ class BufferPoolManagerInstance : public BufferPoolManager {
   /** @return pointer to all the pages in the buffer pool */
   auto GetPages() -> Page * { return pages_; }
 
+  /**
+   * @return how many frames are on the free list. Read without taking latch_, so it may already be stale; good enough
+   * to steer new pages towards instances that need not evict for them.
+   */
+  auto GetFreeFrameCount() const -> size_t { return free_frames_.load(std::memory_order_relaxed); }
+
+  /** @return how many frames are pinned right now; may be stale by the time it returns */
+  auto GetPinnedFrameCount() const -> size_t;
+
+  /** @return the page id the next new page will get */
+  auto GetNextPageId() const -> page_id_t { return next_page_id_; }
+
+  /**
+   * Hand out page ids next_page_id, next_page_id + num_instances, ... from now on, and reuse deallocated ones of that
+   * stripe. ParallelBufferPoolManager calls this when it adds or removes instances.
+   * @param next_page_id the page id of the next new page
+   * @param num_instances how many instances the page ids are striped over
+   */
+  void SetPageIdAllocation(page_id_t next_page_id, uint32_t num_instances);
+
+  /** @return a snapshot of this instance's counters; cheap enough to poll, but not free */
+  auto GetCounters() const -> BufferPoolCounters { return stats_.Snapshot(); }
+
+  /** Longest run of consecutive pages WriteDirtyPages() writes in one request. */
+  static constexpr size_t FLUSH_MAX_RUN_PAGES = 32;
+  /** Most runs each WriteDirtyPages() thread keeps in flight at once. */
+  static constexpr size_t FLUSH_MAX_IN_FLIGHT = 8;
+  /** Longest run of consecutive pages PreloadPages() reads in one request. */
+  static constexpr size_t PRELOAD_MAX_RUN_PAGES = 32;
+  /** Most runs PreloadPages() keeps in flight at once. */
+  static constexpr size_t PRELOAD_MAX_IN_FLIGHT = 8;
+
+  /** A dirty page found by CollectDirtyPages(), and the instance that holds it. */
+  struct DirtyPage {
+    page_id_t page_id_;
+    frame_id_t frame_id_;
+    BufferPoolManagerInstance *owner_;
+  };
+
+  /**
+   * Append the pages of this instance that are dirty right now, or being written back, to dirty, for
+   * WriteDirtyPages().
+   * @param[out] dirty the list to append to
+   */
+  void CollectDirtyPages(std::vector<DirtyPage> *dirty);
+
+  /**
+   * Write back dirty pages, possibly of several instances sharing a disk manager. The pages are sorted by id and
+   * every run of consecutive ids is written with one request. Pages that were cleaned, evicted or deleted since they
+   * were collected are skipped. A page that somebody else was writing back is waited for, and written if that left it
+   * dirty, so every page that was dirty when it was collected is on disk afterwards unless a write failed. The disk
+   * manager is synced once at the end.
+   * @param dirty pages from CollectDirtyPages()
+   * @param num_threads how many threads to spread the runs over
+   * @return how much was written
+   */
+  static auto WriteDirtyPages(std::vector<DirtyPage> dirty, size_t num_threads) -> FlushStats;
+
  protected:
   /**
    * Fetch the requested page from the buffer pool.
@@ -67,6 +141,15 @@ class BufferPoolManagerInstance : public BufferPoolManager {
    */
   auto FetchPgImp(page_id_t page_id) -> Page * override;
 
+  /**
+   * Fetch the requested page. On a miss, the frame the strategy used a full ring ago is recycled if nobody else has
+   * taken it since.
+   * @param page_id id of page to be fetched
+   * @param strategy access strategy of the caller, may be nullptr
+   * @return the requested page
+   */
+  auto FetchPgWithStrategyImp(page_id_t page_id, BufferAccessStrategy *strategy) -> Page * override;
+
   /**
    * Unpin the target page from the buffer pool.
    * @param page_id id of page to be unpinned
@@ -75,6 +158,14 @@ class BufferPoolManagerInstance : public BufferPoolManager {
    */
   auto UnpinPgImp(page_id_t page_id, bool is_dirty) -> bool override;
 
+  /**
+   * Unpin a page given its frame, which is found by pointer arithmetic instead of a page table lookup.
+   * @param page the pinned page, one of this instance's frames
+   * @param is_dirty true if the page should be marked as dirty, false otherwise
+   * @return false if the page pin count is <= 0 before this call, true otherwise
+   */
+  auto UnpinFrameImp(Page *page, bool is_dirty) -> bool override;
+
   /**
    * Flushes the target page to disk.
    * @param page_id id of page to be flushed, cannot be INVALID_PAGE_ID
@@ -89,6 +180,14 @@ class BufferPoolManagerInstance : public BufferPoolManager {
    */
   auto NewPgImp(page_id_t *page_id) -> Page * override;
 
+  /**
+   * Creates a new page, recycling a frame of the strategy's ring when possible.
+   * @param[out] page_id id of created page
+   * @param strategy access strategy of the caller, may be nullptr
+   * @return nullptr if no new pages could be created, otherwise pointer to new page
+   */
+  auto NewPgWithStrategyImp(page_id_t *page_id, BufferAccessStrategy *strategy) -> Page * override;
+
   /**
    * Deletes a page from the buffer pool.
    * @param page_id id of page to be deleted
@@ -101,6 +200,38 @@ class BufferPoolManagerInstance : public BufferPoolManager {
    */
   void FlushAllPgsImp() override;
 
+  /**
+   * Flushes the dirty pages in the buffer pool to disk, coalescing runs of consecutive pages.
+   * @return how much was written
+   */
+  auto FlushDirtyPgsImp() -> FlushStats override;
+
+  /**
+   * Queue pages for the prefetch thread, starting it on first use. Requests beyond PREFETCH_QUEUE_DEPTH are dropped.
+   * @param page_ids ids of the pages to read
+   * @param strategy access strategy whose ring the pages are read into, may be nullptr
+   */
+  void PrefetchPgsImp(const std::vector<page_id_t> &page_ids, std::shared_ptr<BufferAccessStrategy> strategy) override;
+
+  /**
+   * List the resident pages: the pinned ones, then the evictable ones in reverse eviction order.
+   * @return the ids of the resident pages, the hottest first
+   */
+  auto GetResidentPgsImp() -> std::vector<page_id_t> override;
+
+  /**
+   * List the frames that may differ from disk: dirty ones, pinned ones, whose changes may not be marked yet, and
+   * ones being written.
+   * @return (page id, recovery LSN) of those pages
+   */
+  auto GetDirtyPageTableImp() -> std::vector<std::pair<page_id_t, lsn_t>> override;
+
+  /**
+   * Hand the pages to a new preload thread, after waiting for the previous one to finish.
+   * @param page_ids ids of the pages to read, the most important first
+   */
+  void PreloadPgsImp(std::vector<page_id_t> page_ids) override;
+
   /**
    * Allocate a page on disk.∂
    * @return the id of the allocated page
@@ -108,12 +239,11 @@ class BufferPoolManagerInstance : public BufferPoolManager {
   auto AllocatePage() -> page_id_t;
 
   /**
-   * Deallocate a page on disk.
+   * Deallocate a page on disk, so that AllocatePage() can hand it out again. Ids this instance has not handed out
+   * are ignored.
    * @param page_id id of the page to deallocate
    */
-  void DeallocatePage(__attribute__((unused)) page_id_t page_id) {
-    //
-  }
+  void DeallocatePage(page_id_t page_id);
 
   /**
    * Validate that the page_id being used is accessible to this BPI. This can be used in all of the functions to
@@ -122,28 +252,296 @@ class BufferPoolManagerInstance : public BufferPoolManager {
    */
   void ValidatePageId(page_id_t page_id) const;
 
+  /** Number of independently latched stripes in the page table, must be a power of two. */
+  static constexpr size_t PAGE_TABLE_STRIPES = 64;
+  /** Most pins and unpins a page table stripe queues before passing them on to the replacer. */
+  static constexpr size_t REPLACER_BATCH_SIZE = 32;
+
+  /** A pin or unpin the replacer has not been told about yet. */
+  struct ReplacerEvent {
+    /** When it happened, so that the queues of all stripes can be merged in order. */
+    int64_t time_;
+    frame_id_t frame_id_;
+    bool unpin_;
+  };
+
+  /**
+   * One stripe of the page table. Looking up a page and changing its pin count happen under the latch of the stripe
+   * the page hashes to, so cache hits on different pages never serialize on latch_. The replacer, whose latch all
+   * pages share, hears about pins and unpins in batches of REPLACER_BATCH_SIZE per stripe, and about all of them
+   * before it picks a victim. It may still offer a frame that was pinned again meanwhile, which EvictFrame() rejects.
+   * Padded to a cache line so that neighbouring stripes do not false-share.
+   */
+  struct alignas(64) PageTableStripe {
+    std::mutex latch_;
+    std::unordered_map<page_id_t, frame_id_t> table_;
+    /** Pins and unpins of this stripe's pages not passed on to the replacer yet, oldest first. */
+    std::array<ReplacerEvent, REPLACER_BATCH_SIZE> pending_;
+    size_t num_pending_{0};
+  };
+
+  /** @return the page table stripe responsible for page_id */
+  auto GetStripe(page_id_t page_id) -> PageTableStripe &;
+
+  /** Queue a pin or unpin for the replacer, passing the queue on once it is full. Caller holds the stripe latch. */
+  void QueueReplacerEvent(PageTableStripe *stripe, frame_id_t frame_id, bool unpin);
+
+  /** Pass the stripe's queued pins and unpins on to the replacer. Caller holds the stripe latch. */
+  void DrainReplacerEvents(PageTableStripe *stripe);
+
+  /**
+   * Pass the queued pins and unpins of all stripes on to the replacer, in the order they happened. Caller holds latch_.
+   */
+  void DrainAllReplacerEvents();
+
+  /** Tell the replacer about one pin or unpin, and whether the frame is pinned now. */
+  void ApplyReplacerEvent(const ReplacerEvent &event);
+
+  /**
+   * Pin page_id if it is resident. Only the page's stripe latch is taken. The page may still be READING; call
+   * WaitForLoad() once no latches are held before touching its content.
+   * @param page_id id of the page to pin
+   * @return the pinned page, or nullptr if the page is not in the buffer pool
+   */
+  auto PinResidentPage(page_id_t page_id) -> Page *;
+
+  /** Block until a pinned page that is being read from disk is VALID. Waits on that frame only. */
+  void WaitForLoad(Page *page);
+
+  /**
+   * Pin a page, claiming a frame and starting to read the page into it on a miss. The read completes asynchronously;
+   * call WaitForLoad() before touching the content.
+   * @param page_id id of the page
+   * @param strategy access strategy whose ring the page is read into, may be nullptr
+   * @param prefetch true to not keep the pin: a hit is unpinned right away, a miss once its read is done
+   * @return the page, or nullptr if every frame is pinned
+   */
+  auto PinPage(page_id_t page_id, BufferAccessStrategy *strategy, bool prefetch) -> Page *;
+
+  /**
+   * Start reading a page into a frame that was installed READING with its write latch held. The completion makes the
+   * frame VALID and releases the latch.
+   */
+  void LoadPage(page_id_t page_id, Page *page, bool prefetch);
+
+  /** @return the next slot of the strategy's ring for this instance, or nullptr if there is no strategy */
+  auto NextRingSlot(BufferAccessStrategy *strategy) -> RingSlot *;
+
+  /**
+   * Find a frame to hold a new page. The frame of the given ring slot is reused if it still holds the slot's page and
+   * is unpinned; otherwise the free list is preferred over the replacer. A victim is removed from the page table; if
+   * it is dirty, latch_ is released while it is written back and reacquired afterwards, so callers must re-validate
+   * anything they looked up before calling this. While frames are being written back, it waits for them rather than
+   * give up.
+   * @param[out] frame_id the acquired frame
+   * @param lock the caller's lock on latch_
+   * @param slot ring slot of the caller's access strategy, may be nullptr
+   * @return false if every frame is pinned
+   */
+  auto AcquireFrame(frame_id_t *frame_id, std::unique_lock<std::mutex> *lock, RingSlot *slot = nullptr) -> bool;
+
+  /** Longest wait of AcquireFrame() for a write-back before it looks for a victim again. */
+  static constexpr std::chrono::milliseconds WRITE_BACK_WAIT{1};
+
+  /** @return true if some frame is WRITING; its page may become evictable when that is done */
+  auto IsWritingBack() const -> bool;
+
+  /**
+   * Try to take an unpinned frame away from the page it holds, writing the page back first if it is dirty. latch_ is
+   * released during the write.
+   * @param frame_id the frame to evict
+   * @param lock the caller's lock on latch_
+   * @return true if the frame is now unused and out of the page table and the replacer
+   */
+  auto EvictFrame(frame_id_t frame_id, std::unique_lock<std::mutex> *lock) -> bool;
+
+  /** Body of the background cleaner thread: run CleanPages() every cleaner_interval_, or sooner when woken up. */
+  void CleanerLoop();
+
+  /** @return the LSN the next log record will get, the recovery LSN of a page that is clean now */
+  auto NextLSN() -> lsn_t { return log_manager_ != nullptr ? log_manager_->GetNextLSN() : INVALID_LSN; }
+
+  /**
+   * @return true if the log records up to lsn may not be on disk yet. A page with an LSN the log manager has not
+   * handed out, e.g. from an earlier log before recovery continues its LSNs, has none to wait for.
+   */
+  auto LogIsBehind(lsn_t lsn) -> bool;
+
+  /**
+   * WAL: wait until the log records up to lsn are on disk before a page with that LSN is written.
+   * @return false if they cannot get there, because a log write failed; the page must not be written then
+   */
+  auto FlushLogUpTo(lsn_t lsn) -> bool;
+
+  /** Wake the background cleaner up early, e.g. because an eviction had to write synchronously. */
+  void WakeCleaner();
+
+  /**
+   * One round of the background cleaner. If fewer than cleaner_clean_fraction_ of the frames are free or hold a clean
+   * unpinned page, write dirty unpinned pages back in page id order until they are.
+   */
+  void CleanPages();
+
+  /**
+   * Start writing back a page on behalf of the cleaner, if it is still resident in frame_id, unpinned and dirty. The
+   * frame is WRITING and read latched until EndCleanPage(), so it is not evicted or changed. While logging is enabled,
+   * pages whose log records are not yet persistent are skipped.
+   * @param[out] done completes with the outcome of the write
+   * @return true if the write was started
+   */
+  auto BeginCleanPage(page_id_t page_id, frame_id_t frame_id, std::future<bool> *done) -> bool;
+
+  /**
+   * Finish a write that BeginCleanPage() started.
+   * @param written outcome of the write; a page that was not written is dirty again
+   * @return written
+   */
+  auto EndCleanPage(page_id_t page_id, frame_id_t frame_id, bool written) -> bool;
+
+  /** Most writes the cleaner keeps in flight at once. */
+  static constexpr size_t CLEANER_MAX_IN_FLIGHT = 16;
+
+  /** Most pages that may wait to be prefetched. Read-ahead that far behind the scan would be useless anyway. */
+  static constexpr size_t PREFETCH_QUEUE_DEPTH = 64;
+  /** Most reads the prefetch thread keeps in flight at once. */
+  static constexpr size_t PREFETCH_MAX_IN_FLIGHT = 16;
+
+  /** A page queued for the prefetch thread, and the strategy to read it with. */
+  struct PrefetchRequest {
+    page_id_t page_id_;
+    std::shared_ptr<BufferAccessStrategy> strategy_;
+  };
+
+  /**
+   * Copy a dirty page into buffer for writing back, and mark it clean. The frame stays WRITING, and so cannot be
+   * evicted, until EndFlushPage(); it may be pinned and read meanwhile.
+   * @return false if the frame no longer holds the page, is busy, or is clean
+   */
+  auto BeginFlushPage(const DirtyPage &dirty, char *buffer) -> bool;
+
+  /**
+   * Finish writing back a page that BeginFlushPage() accepted.
+   * @param written outcome of the write; a page that was not written is dirty again
+   */
+  void EndFlushPage(const DirtyPage &dirty, bool written);
+
+  /**
+   * Wait until nobody is writing back the frame of a collected page any more.
+   * @return true if the frame still holds the page and the page is dirty
+   */
+  auto WaitForWriteBack(const DirtyPage &dirty) -> bool;
+
+  /**
+   * Write back pages sorted by id, every run of consecutive ids with one request, on up to num_threads threads.
+   * @param[out] written set to 1 for each page whose write was attempted, 0 for one that was skipped
+   */
+  static auto WriteSortedPages(const std::vector<DirtyPage> &dirty, size_t num_threads, std::vector<char> *written)
+      -> FlushStats;
+
+  /** Write back the runs [begin, end) of dirty with index first, first + stride, ... and mark them in written. */
+  static auto WriteRuns(const std::vector<DirtyPage> &dirty, const std::vector<std::pair<size_t, size_t>> &runs,
+                        size_t first, size_t stride, std::vector<char> *written) -> FlushStats;
+
+  /** Lock latch_ through a deferred lock, recording in stats_ how long that took. */
+  void LockLatch(std::unique_lock<std::mutex> *lock);
+
+  /**
+   * Body of the prefetch thread: start reading the queued pages, up to PREFETCH_MAX_IN_FLIGHT at once. Each page stays
+   * pinned until its read is done.
+   */
+  void PrefetchLoop();
+
+  /**
+   * Body of the preload thread: read as many of the pages as there are free frames, in runs of consecutive page ids.
+   * Frames are claimed the way a fetch claims them before the read, so a concurrent fetch of the page waits for it.
+   */
+  void PreloadLoop(std::vector<page_id_t> page_ids);
+
+  /** @return true if page_id is in the page table */
+  auto IsResident(page_id_t page_id) -> bool;
+
+  /**
+   * Publish a frame whose metadata has already been filled in under page_id, making it visible to cache hits.
+   * Caller must hold latch_.
+   */
+  void InstallPage(page_id_t page_id, frame_id_t frame_id);
+
   /** Number of pages in the buffer pool. */
   const size_t pool_size_;
-  /** How many instances are in the parallel BPM (if present, otherwise just 1 BPI) */
-  const uint32_t num_instances_ = 1;
+  /** How many instances are in the parallel BPM (if present, otherwise just 1 BPI). Changes when it is resized. */
+  std::atomic<uint32_t> num_instances_ = 1;
   /** Index of this BPI in the parallel BPM (if present, otherwise just 0) */
   const uint32_t instance_index_ = 0;
-  /** Each BPI maintains its own counter for page_ids to hand out, must ensure they mod back to its instance_index_ */
+  /**
+   * Each BPI maintains its own counter for page_ids to hand out, must ensure they mod back to the same residue modulo
+   * num_instances_. That is instance_index_ until the parallel BPM is resized.
+   */
   std::atomic<page_id_t> next_page_id_ = instance_index_;
+  /**
+   * First page id of the current stripe. Deallocated pages below it were handed out before the last resize and may
+   * be routed to another instance, so AllocatePage() does not reuse them.
+   */
+  page_id_t first_page_id_ = instance_index_;
 
-  /** Array of buffer pool pages. */
+  /** Settings this instance was created with. */
+  const BufferPoolOptions options_;
+  /** Data of the frames. */
+  FrameArena arena_;
+  /** Array of buffer pool pages, i.e. the frame descriptors; their data is in arena_. */
   Page *pages_;
   /** Pointer to the disk manager. */
   DiskManager *disk_manager_ __attribute__((__unused__));
   /** Pointer to the log manager. */
   LogManager *log_manager_ __attribute__((__unused__));
-  /** Page table for keeping track of buffer pool pages. */
-  std::unordered_map<page_id_t, frame_id_t> page_table_;
+  /** Page table for keeping track of buffer pool pages, striped by page id. */
+  std::array<PageTableStripe, PAGE_TABLE_STRIPES> page_table_;
   /** Replacer to find unpinned pages for replacement. */
   Replacer *replacer_;
   /** List of free pages. */
   std::list<frame_id_t> free_list_;
-  /** This latch protects shared data structures. We recommend updating this comment to describe what it protects. */
+  /** Size of free_list_, changed under latch_ but readable without it. */
+  std::atomic<size_t> free_frames_{0};
+  /**
+   * This latch protects free_list_ and serializes changes to which page a frame holds (loading, evicting, creating and
+   * deleting pages). Cache hits and unpins never take it; they only take the stripe latch of their page. It is never
+   * held across disk I/O: reads happen with the frame READING and victim write-back with the frame WRITING.
+   * Lock order is latch_, then a stripe latch, then the replacer's internal latch.
+   */
   std::mutex latch_;
+  /**
+   * Notified when a write-back ends, for AcquireFrame() waiting on latch_. Those ending it do not hold latch_, so a
+   * wakeup can be missed; the wait is bounded by WRITE_BACK_WAIT.
+   */
+  std::condition_variable write_back_cv_;
+
+  /** Counters returned by GetCounters(). */
+  BufferPoolStats stats_;
+
+  /** Background cleaner, only started if options_.enable_cleaner_ is set. */
+  std::thread cleaner_thread_;
+  /** Protects cleaner_stop_ and cleaner_wakeup_. Never held while taking any other latch. */
+  std::mutex cleaner_latch_;
+  std::condition_variable cleaner_cv_;
+  bool cleaner_stop_{false};
+  bool cleaner_wakeup_{false};
+
+  /** Reads pages ahead of sequential scans, started by the first PrefetchPages() call. */
+  std::thread prefetch_thread_;
+  /**
+   * Protects prefetch_thread_, prefetch_queue_, prefetch_stop_ and prefetch_in_flight_. Never held while taking any
+   * other latch.
+   */
+  std::mutex prefetch_latch_;
+  std::condition_variable prefetch_cv_;
+  std::deque<PrefetchRequest> prefetch_queue_;
+  bool prefetch_stop_{false};
+  /** Prefetch reads started and not completed yet. */
+  size_t prefetch_in_flight_{0};
+
+  /** Reads the pages handed to PreloadPages(). */
+  std::thread preload_thread_;
+  /** Protects preload_thread_. Never held while taking any other latch. */
+  std::mutex preload_latch_;
+  std::atomic<bool> preload_stop_{false};
 };
 }  // namespace bustub
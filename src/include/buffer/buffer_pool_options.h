@@ -0,0 +1,49 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// buffer_pool_options.h
+//
+// Identification: src/include/buffer/buffer_pool_options.h
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <chrono>  // NOLINT
+#include <cstddef>
+#include <string>
+
+#include "buffer/replacer.h"
+
+namespace bustub {
+
+/**
+ * Construction-time settings of a buffer pool. A ParallelBufferPoolManager hands the same options to every
+ * BufferPoolManagerInstance it creates. The defaults give a plain LRU buffer pool.
+ */
+struct BufferPoolOptions {
+  /** Replacement policy of each buffer pool instance. */
+  ReplacerType replacer_type_{ReplacerType::LRU};
+  /** K of the LRU-K replacer: how many past references decide which frame to evict. */
+  size_t lru_k_{2};
+  /** LRU-K only: references to a frame fewer than this many buffer pool accesses apart count as one reference. */
+  size_t lru_k_correlated_period_{0};
+  /** Run a background thread per instance that writes dirty pages back before they are chosen as victims. */
+  bool enable_cleaner_{false};
+  /** Fraction of the pool the cleaner tries to keep free or clean and evictable. */
+  double cleaner_clean_fraction_{0.25};
+  /** How long the cleaner sleeps between rounds when nobody wakes it up. */
+  std::chrono::milliseconds cleaner_interval_{10};
+  /** Back the frames of each instance with huge pages, if the OS has any to give. */
+  bool use_huge_pages_{false};
+  /**
+   * If set, the buffer pool preloads the pages listed in this file when it is created, and lists its resident pages
+   * there when it is destroyed, so that a restart does not begin with a cold cache. See DumpResidentPages().
+   */
+  std::string warmup_file_;
+};
+
+}  // namespace bustub
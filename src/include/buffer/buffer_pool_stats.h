@@ -0,0 +1,108 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// buffer_pool_stats.h
+//
+// Identification: src/include/buffer/buffer_pool_stats.h
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace bustub {
+
+/** Number of buckets of the latch wait histogram. */
+static constexpr size_t LATCH_WAIT_BUCKETS = 32;
+
+/** The events a buffer pool counts. */
+enum class BufferPoolEvent : size_t {
+  FETCH_HIT,
+  FETCH_MISS,
+  NEW_PAGE,
+  EVICTION,
+  SYNC_WRITE_BACK,
+  CLEANER_WRITE_BACK,
+  FLUSH,
+  NO_FREE_FRAME,
+  PRELOAD,
+  NUM_EVENTS,
+};
+
+/** A snapshot of a buffer pool's counters. */
+struct BufferPoolCounters {
+  /** Fetches that found the page resident. */
+  uint64_t fetch_hits_{0};
+  /** Fetches that read the page from disk. */
+  uint64_t fetch_misses_{0};
+  /** Pages created. */
+  uint64_t new_pages_{0};
+  /** Pages evicted to make room for another page. */
+  uint64_t evictions_{0};
+  /** Evictions that had to write a dirty victim back before the frame could be reused. */
+  uint64_t sync_write_backs_{0};
+  /** Dirty pages written back by the background cleaner. */
+  uint64_t cleaner_write_backs_{0};
+  /** Pages written by FlushPage() and FlushAllPages(). */
+  uint64_t flushes_{0};
+  /** Fetches and new pages that returned nullptr because every frame was pinned. */
+  uint64_t no_free_frames_{0};
+  /** Pages read in by PreloadPages(). */
+  uint64_t preloaded_pages_{0};
+  /**
+   * How long taking latch_ took. Bucket 0 counts acquisitions that did not have to wait at all, bucket i > 0 waits of
+   * [2^(i-1), 2^i) nanoseconds, and the last bucket everything longer.
+   */
+  std::array<uint64_t, LATCH_WAIT_BUCKETS> latch_wait_ns_{};
+
+  /** @return the share of fetches that were hits, 0 if there were none */
+  auto HitRatio() const -> double;
+
+  /** Add the counters of another buffer pool, e.g. another instance of a parallel buffer pool. */
+  auto operator+=(const BufferPoolCounters &that) -> BufferPoolCounters &;
+};
+
+/**
+ * BufferPoolStats counts buffer pool events cheaply enough to stay enabled all the time. Each thread increments its
+ * own shard with relaxed atomics on a cache line no other thread is likely to write, and Snapshot() adds the shards up.
+ * A snapshot taken while events are counted is not atomic as a whole, but every counter in it is exact.
+ */
+class BufferPoolStats {
+ public:
+  /** Number of shards; threads beyond this share shards. */
+  static constexpr size_t NUM_SHARDS = 16;
+
+  /** Count n occurrences of event. */
+  void Add(BufferPoolEvent event, uint64_t n = 1) {
+    LocalShard().events_[static_cast<size_t>(event)].fetch_add(n, std::memory_order_relaxed);
+  }
+
+  /** Record how long taking latch_ took; 0 for an acquisition that did not wait. */
+  void RecordLatchWait(uint64_t wait_ns);
+
+  /** @return the sum of all shards */
+  auto Snapshot() const -> BufferPoolCounters;
+
+ private:
+  struct alignas(64) Shard {
+    std::array<std::atomic<uint64_t>, static_cast<size_t>(BufferPoolEvent::NUM_EVENTS)> events_{};
+    std::array<std::atomic<uint64_t>, LATCH_WAIT_BUCKETS> latch_wait_ns_{};
+  };
+
+  /** @return the shard of the calling thread */
+  auto LocalShard() -> Shard & { return shards_[ShardIndex()]; }
+
+  /** @return the shard index of the calling thread, assigned round robin on its first event */
+  static auto ShardIndex() -> size_t;
+
+  std::array<Shard, NUM_SHARDS> shards_;
+};
+
+}  // namespace bustub
@@ -12,9 +12,8 @@
 
 #pragma once
 
-#include <list>
-#include <mutex>  // NOLINT
-#include <vector>
+#include <atomic>
+#include <memory>
 
 #include "buffer/replacer.h"
 #include "common/config.h"
@@ -23,6 +22,12 @@ namespace bustub {
 
 /**
  * ClockReplacer implements the clock replacement policy, which approximates the Least Recently Used policy.
+ *
+ * The replacer is latch-free. Each frame has one atomic byte holding an evictable bit and a reference bit, so Pin()
+ * and Unpin() are a single atomic store and never contend with each other. Only Victim() does real work: it advances
+ * a shared clock hand, clearing reference bits, until it claims an evictable frame whose reference bit is already
+ * clear with a compare-and-swap. Concurrent Victim() calls each advance the hand by themselves and never claim the
+ * same frame.
  */
 class ClockReplacer : public Replacer {
  public:
@@ -43,10 +48,26 @@ class ClockReplacer : public Replacer {
 
   void Unpin(frame_id_t frame_id) override;
 
+  /** @return the number of evictable frames. Walks every frame, so keep it off hot paths. */
   auto Size() -> size_t override;
 
+  /**
+   * @return the evictable frames in clock order from the hand, unreferenced ones first. Only an estimate while other
+   * threads use the replacer.
+   */
+  auto GetEvictionOrder() -> std::vector<frame_id_t> override;
+
  private:
-  // TODO(student): implement me!
+  /** The frame may be victimized. */
+  static constexpr uint8_t EVICTABLE = 1;
+  /** The frame was used since the clock hand last passed it. */
+  static constexpr uint8_t REFERENCED = 2;
+
+  const size_t num_frames_;
+  /** EVICTABLE and REFERENCED bits of each frame. */
+  std::unique_ptr<std::atomic<uint8_t>[]> states_;
+  /** Position of the clock hand, taken modulo num_frames_. */
+  std::atomic<size_t> hand_{0};
 };
 
 }  // namespace bustub
@@ -0,0 +1,59 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// frame_arena.h
+//
+// Identification: src/include/buffer/frame_arena.h
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <cstddef>
+
+#include "common/config.h"
+#include "common/macros.h"
+
+namespace bustub {
+
+/**
+ * FrameArena holds the data of all frames of a buffer pool back to back, in one zeroed region mapped straight from
+ * the OS. Every frame therefore starts on an OS page boundary, as direct I/O requires. The frame metadata lives in
+ * the Page descriptors, apart from the data.
+ *
+ * With huge pages, the arena first asks for explicit huge pages and falls back to regular pages with transparent huge
+ * pages requested, which the kernel may or may not grant.
+ */
+class FrameArena {
+ public:
+  /** Size of the huge pages the arena is rounded up to when it asks for them. */
+  static constexpr size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+
+  /**
+   * Map the arena. Throws an OUT_OF_MEMORY Exception if that fails.
+   * @param num_frames number of frames
+   * @param use_huge_pages back the arena with huge pages if possible
+   */
+  FrameArena(size_t num_frames, bool use_huge_pages);
+
+  ~FrameArena();
+
+  DISALLOW_COPY_AND_MOVE(FrameArena);
+
+  /** @return the data of a frame, PAGE_SIZE bytes */
+  auto GetFrameData(frame_id_t frame_id) const -> char * { return base_ + static_cast<size_t>(frame_id) * PAGE_SIZE; }
+
+  /** @return true if the arena got explicit huge pages */
+  auto HasHugePages() const -> bool { return huge_pages_; }
+
+ private:
+  char *base_{nullptr};
+  /** Size of the mapping, possibly rounded up. */
+  size_t size_{0};
+  bool huge_pages_{false};
+};
+
+}  // namespace bustub
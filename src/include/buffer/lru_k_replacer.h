@@ -0,0 +1,126 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// lru_k_replacer.h
+//
+// Identification: src/include/buffer/lru_k_replacer.h
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <mutex>  // NOLINT
+#include <set>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "buffer/replacer.h"
+#include "common/config.h"
+
+namespace bustub {
+
+/**
+ * LRUKReplacer implements the LRU-K replacement policy (O'Neil, O'Neil and Weikum, SIGMOD '93).
+ *
+ * The victim is the evictable frame whose K-th most recent reference lies furthest in the past (its backward
+ * K-distance). Frames referenced fewer than K times have an infinite backward K-distance and are evicted first, oldest
+ * first reference first, so a page touched once by a large scan goes before a page the workload keeps coming back to.
+ *
+ * Time is measured in references: every Pin() is one tick. References to a frame that follow its previous reference
+ * within the correlated reference period are folded into it, and frames referenced within that period are only
+ * evicted when nothing else is.
+ *
+ * A frame's history does not change while it is evictable, so the evictable frames are kept in sets ordered by their
+ * victim keys, and Victim() is O(log n). Frames still within their correlated reference period wait in sets of their
+ * own until time moves past it.
+ */
+class LRUKReplacer : public Replacer {
+ public:
+  /**
+   * Create a new LRUKReplacer.
+   * @param num_pages the maximum number of pages the LRUKReplacer will be required to store
+   * @param k number of past references that determine a frame's backward distance
+   * @param correlated_period references to a frame less than this many ticks apart count as a single reference
+   */
+  LRUKReplacer(size_t num_pages, size_t k, size_t correlated_period = 0);
+
+  /**
+   * Destroys the LRUKReplacer.
+   */
+  ~LRUKReplacer() override;
+
+  auto Victim(frame_id_t *frame_id) -> bool override;
+
+  /** Pins a frame and records a reference to it. */
+  void Pin(frame_id_t frame_id) override;
+
+  void Unpin(frame_id_t frame_id) override;
+
+  /** Forgets the frame and its reference history. */
+  void Remove(frame_id_t frame_id) override;
+
+  auto Size() -> size_t override;
+
+  auto GetEvictionOrder() -> std::vector<frame_id_t> override;
+
+ private:
+  /** Reference history of one frame. */
+  struct FrameHistory {
+    /** Number of uncorrelated references recorded, capped at K. */
+    size_t num_refs_{0};
+    /** Time of the most recent reference, correlated or not. */
+    uint64_t last_{0};
+    /** True if the frame may be victimized. */
+    bool evictable_{false};
+    /** True if the evictable frame is in correlated_ rather than uncorrelated_. */
+    bool correlated_{false};
+  };
+
+  /**
+   * What decides how early a frame is victimized among the frames that are within their correlated reference period
+   * or not like it: whether it has K references, i.e. a finite backward K-distance (frames without are first), then the
+   * K-th most recent reference, or the oldest one if there are fewer, then the frame id.
+   */
+  using OrderKey = std::tuple<bool, uint64_t, frame_id_t>;
+
+  /** @return the order key of frame_id. Caller must hold latch_. */
+  auto GetOrderKey(frame_id_t frame_id) -> OrderKey;
+
+  /** Add an unpinned frame to the eviction order. Caller must hold latch_. */
+  void InsertEvictable(frame_id_t frame_id);
+
+  /** Take an evictable frame out of the eviction order. Caller must hold latch_. */
+  void EraseEvictable(frame_id_t frame_id);
+
+  /** Move the frames whose correlated reference period has passed to uncorrelated_. Caller must hold latch_. */
+  void ExpireCorrelated();
+
+  /** Record a reference to frame_id at the current time. Caller must hold latch_. */
+  void RecordReference(frame_id_t frame_id);
+
+  /** @return the i-th most recent uncorrelated reference time of frame_id, 0 being the latest */
+  inline auto Hist(frame_id_t frame_id, size_t i) -> uint64_t & { return hist_[frame_id * k_ + i]; }
+
+  const size_t k_;
+  const size_t correlated_period_;
+  /** Logical clock, advanced on every reference. */
+  uint64_t current_time_{0};
+  /** Number of evictable frames. */
+  size_t num_evictable_{0};
+  std::vector<FrameHistory> frames_;
+  /** K reference times per frame, most recent first, stored flat. */
+  std::vector<uint64_t> hist_;
+  /** Evictable frames outside their correlated reference period, the next victim first. */
+  std::set<OrderKey> uncorrelated_;
+  /** Evictable frames within their correlated reference period, in victim order for when there are no others. */
+  std::set<OrderKey> correlated_;
+  /** The frames in correlated_ by their most recent reference, i.e. by when their period ends. */
+  std::set<std::pair<uint64_t, frame_id_t>> correlated_by_last_;
+  std::mutex latch_;
+};
+
+}  // namespace bustub
@@ -12,9 +12,7 @@
 
 #pragma once
 
-#include <list>
 #include <mutex>  // NOLINT
-#include <unordered_map>
 #include <vector>
 
 #include "buffer/replacer.h"
@@ -24,6 +22,9 @@ namespace bustub {
 
 /**
  * LRUReplacer implements the Least Recently Used replacement policy.
+ *
+ * Frame ids are dense, so the LRU list is intrusive: each frame's links live in a flat array indexed by frame id.
+ * Pin, Unpin and Victim are O(1), and nothing is allocated after construction.
  */
 class LRUReplacer : public Replacer {
  public:
@@ -46,10 +47,31 @@ class LRUReplacer : public Replacer {
 
   auto Size() -> size_t override;
 
+  auto GetEvictionOrder() -> std::vector<frame_id_t> override;
+
  private:
-  std::unordered_map<frame_id_t, std::list<frame_id_t>::iterator> mp_;
-  std::list<frame_id_t> list_;
-  size_t capasity_;
+  /** Link that ends the list. */
+  static constexpr frame_id_t NIL = -1;
+
+  /** A frame's place in the list. */
+  struct Node {
+    /** Neighbour towards the most recently unpinned end. */
+    frame_id_t prev_{NIL};
+    /** Neighbour towards the least recently unpinned end. */
+    frame_id_t next_{NIL};
+    /** True if the frame is in the list, i.e. evictable. */
+    bool evictable_{false};
+  };
+
+  /** Take an evictable frame out of the list. Caller must hold lock_. */
+  void Unlink(frame_id_t frame_id);
+
+  std::vector<Node> nodes_;
+  /** The most recently unpinned frame, NIL if the list is empty. */
+  frame_id_t head_{NIL};
+  /** The least recently unpinned frame, i.e. the next victim. */
+  frame_id_t tail_{NIL};
+  size_t size_{0};
   std::mutex lock_;
 };
 
@@ -12,8 +12,13 @@
 
 #pragma once
 
+#include <atomic>
+#include <chrono>  // NOLINT
+#include <string>
+
 #include "buffer/buffer_pool_manager.h"
 #include "buffer/buffer_pool_manager_instance.h"
+#include "common/rwlatch.h"
 #include "iostream"
 #include "recovery/log_manager.h"
 #include "storage/disk/disk_manager.h"
@@ -22,17 +27,29 @@
 #include "vector"
 namespace bustub {
 
+/**
+ * ParallelBufferPoolManager stripes page ids over several BufferPoolManagerInstances, and can add or remove instances
+ * while it is in use. Every instance hands out the page ids that stripe back to it, so each resize starts a new epoch:
+ * page ids from the epoch's first page id on are striped over the instances of that epoch. Older page ids keep their
+ * instances, except that those of a removed instance pass to the remaining ones.
+ */
 class ParallelBufferPoolManager : public BufferPoolManager {
  public:
+  /** How long Resize() waits between attempts to remove an instance whose pages are still pinned. */
+  static constexpr std::chrono::milliseconds RESIZE_RETRY_INTERVAL{1};
+  /** How long Resize() waits by default for the pages of an instance it removes to be unpinned. */
+  static constexpr std::chrono::milliseconds RESIZE_DRAIN_TIMEOUT{1000};
+
   /**
    * Creates a new ParallelBufferPoolManager.
    * @param num_instances the number of individual BufferPoolManagerInstances to store
    * @param pool_size the pool size of each BufferPoolManagerInstance
    * @param disk_manager the disk manager
    * @param log_manager the log manager (for testing only: nullptr = disable logging)
+   * @param options replacement policy and other settings, applied to every BufferPoolManagerInstance
    */
   ParallelBufferPoolManager(size_t num_instances, size_t pool_size, DiskManager *disk_manager,
-                            LogManager *log_manager = nullptr);
+                            LogManager *log_manager = nullptr, const BufferPoolOptions &options = BufferPoolOptions());
 
   /**
    * Destroys an existing ParallelBufferPoolManager.
@@ -42,10 +59,27 @@ class ParallelBufferPoolManager : public BufferPoolManager {
   /** @return size of the buffer pool */
   auto GetPoolSize() -> size_t override;
 
+  /** @return the counters of all BufferPoolManagerInstances added up, including those that were removed */
+  auto GetCounters() const -> BufferPoolCounters;
+
+  /** @return the number of BufferPoolManagerInstances */
+  auto GetNumInstances() const -> size_t;
+
+  /**
+   * Grow or shrink the buffer pool to num_instances instances, each of the size the pool was created with, without
+   * stopping it. Growing adds empty instances and keeps every cached page where it is. Shrinking removes the newest
+   * instances one at a time: each is flushed, then dropped once none of its pages is pinned. Its pages are read back
+   * into the remaining instances on their next fetch.
+   * @param num_instances the number of instances to end up with, at least 1
+   * @param drain_timeout how long to wait for the pages of each removed instance to be unpinned
+   * @return false if an instance could not be removed in time; the instances removed before it stay removed
+   */
+  auto Resize(size_t num_instances, std::chrono::milliseconds drain_timeout = RESIZE_DRAIN_TIMEOUT) -> bool;
+
  protected:
   /**
    * @param page_id id of page
-   * @return pointer to the BufferPoolManager responsible for handling given page id
+   * @return pointer to the BufferPoolManager responsible for handling given page id. Caller must hold resize_latch_.
    */
   auto GetBufferPoolManager(page_id_t page_id) -> BufferPoolManager *;
 
@@ -56,6 +90,14 @@ class ParallelBufferPoolManager : public BufferPoolManager {
    */
   auto FetchPgImp(page_id_t page_id) -> Page * override;
 
+  /**
+   * Fetch the requested page from the responsible BufferPoolManagerInstance, using the strategy's ring on a miss.
+   * @param page_id id of page to be fetched
+   * @param strategy access strategy of the caller, may be nullptr
+   * @return the requested page
+   */
+  auto FetchPgWithStrategyImp(page_id_t page_id, BufferAccessStrategy *strategy) -> Page * override;
+
   /**
    * Unpin the target page from the buffer pool.
    * @param page_id id of page to be unpinned
@@ -64,6 +106,14 @@ class ParallelBufferPoolManager : public BufferPoolManager {
    */
   auto UnpinPgImp(page_id_t page_id, bool is_dirty) -> bool override;
 
+  /**
+   * Unpin a page given its frame, in the instance that owns it.
+   * @param page the pinned page
+   * @param is_dirty true if the page should be marked as dirty, false otherwise
+   * @return false if the page pin count is <= 0 before this call, true otherwise
+   */
+  auto UnpinFrameImp(Page *page, bool is_dirty) -> bool override;
+
   /**
    * Flushes the target page to disk.
    * @param page_id id of page to be flushed, cannot be INVALID_PAGE_ID
@@ -78,6 +128,15 @@ class ParallelBufferPoolManager : public BufferPoolManager {
    */
   auto NewPgImp(page_id_t *page_id) -> Page * override;
 
+  /**
+   * Creates a new page in a round robin manner, preferring instances that still have free frames over ones that would
+   * have to evict. Uses the strategy's ring of the chosen instance.
+   * @param[out] page_id id of created page
+   * @param strategy access strategy of the caller, may be nullptr
+   * @return nullptr if no new pages could be created, otherwise pointer to new page
+   */
+  auto NewPgWithStrategyImp(page_id_t *page_id, BufferAccessStrategy *strategy) -> Page * override;
+
   /**
    * Deletes a page from the buffer pool.
    * @param page_id id of page to be deleted
@@ -90,11 +149,87 @@ class ParallelBufferPoolManager : public BufferPoolManager {
    */
   void FlushAllPgsImp() override;
 
+  /**
+   * Flushes the dirty pages of all BufferPoolManagerInstances. Runs of consecutive pages are coalesced across
+   * instances and written by one thread per instance.
+   * @return how much was written
+   */
+  auto FlushDirtyPgsImp() -> FlushStats override;
+
+  /**
+   * Hand each page to the prefetch thread of its BufferPoolManagerInstance.
+   * @param page_ids ids of the pages to read
+   * @param strategy access strategy whose rings the pages are read into, may be nullptr
+   */
+  void PrefetchPgsImp(const std::vector<page_id_t> &page_ids, std::shared_ptr<BufferAccessStrategy> strategy) override;
+
+  /**
+   * Interleave the resident pages of all BufferPoolManagerInstances, so that the hottest pages of each come first.
+   * @return the ids of the resident pages, the hottest first
+   */
+  auto GetResidentPgsImp() -> std::vector<page_id_t> override;
+
+  /**
+   * Concatenate the dirty page tables of all BufferPoolManagerInstances.
+   * @return (page id, recovery LSN) of the pages that may differ from disk
+   */
+  auto GetDirtyPageTableImp() -> std::vector<std::pair<page_id_t, lsn_t>> override;
+
+  /**
+   * Hand each page to the preloader of its BufferPoolManagerInstance, so that the instances read in parallel.
+   * @param page_ids ids of the pages to read, the most important first
+   */
+  void PreloadPgsImp(std::vector<page_id_t> page_ids) override;
+
  private:
+  /** The instances that page ids from first_page_id_ on are striped over. */
+  struct RoutingEpoch {
+    /** A multiple of the number of instances, so the epoch's page ids stripe like page_id % bpms_.size(). */
+    page_id_t first_page_id_;
+    std::vector<BufferPoolManagerInstance *> bpms_;
+  };
+
+  /**
+   * Stripe the page ids that have not been handed out yet over bpms_, starting a new epoch unless none was handed out
+   * in the current one. Caller must hold resize_latch_ for writing.
+   * @param next_page_id a page id no instance has handed out yet, nor any after it
+   */
+  void StartEpoch(page_id_t next_page_id);
+
+  /**
+   * Flush the newest instance and remove it once none of its pages is pinned.
+   * @param deadline when to give up waiting for its pages to be unpinned
+   * @return false if the deadline passed first
+   */
+  auto RemoveInstance(std::chrono::steady_clock::time_point deadline) -> bool;
+
+  /** @return the largest page id an instance will hand out next. Caller must hold resize_latch_. */
+  auto GetNextPageId() const -> page_id_t;
+
+  /** Current instances, which new pages are created in. bpms_[i] has instance index i. */
   std::vector<BufferPoolManagerInstance *> bpms_;
-  std::mutex latch_;
+  /** Oldest first. The last epoch is striped over bpms_. */
+  std::vector<RoutingEpoch> epochs_;
+  /**
+   * Taken for reading by every operation that picks an instance, and for writing to change bpms_ and epochs_. Readers
+   * only hold it for the duration of a call, never while a page is pinned.
+   */
+  mutable BigReaderLatch resize_latch_;
+  /** Serializes Resize() calls, so the latch need not be held while waiting for an instance to drain. */
+  std::mutex resize_mutex_;
+  /** Counters of the instances that were removed. */
+  BufferPoolCounters removed_counters_;
 
-  size_t buffer_pool_size_;
-  size_t start_new_page_idx_;
+  /** Pool size of each instance. */
+  const size_t instance_pool_size_;
+  std::atomic<size_t> buffer_pool_size_;
+  DiskManager *disk_manager_;
+  LogManager *log_manager_;
+  /** Options of each instance. The instances leave warming up to the pool as a whole. */
+  BufferPoolOptions options_;
+  /** options.warmup_file_ of the pool. */
+  const std::string warmup_file_;
+  /** Where the next NewPage() starts looking. Only ever incremented, and taken modulo the number of instances. */
+  std::atomic<size_t> start_new_page_idx_{0};
 };
 }  // namespace bustub
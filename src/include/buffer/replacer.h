@@ -12,10 +12,22 @@
 
 #pragma once
 
+#include <vector>
+
 #include "common/config.h"
 
 namespace bustub {
 
+/** Replacement policies a buffer pool can be configured with. */
+enum class ReplacerType {
+  /** Evict the least recently unpinned frame. */
+  LRU,
+  /** Evict the frame with the largest backward K-distance, see LRUKReplacer. */
+  LRU_K,
+  /** Latch-free second-chance clock, see ClockReplacer. */
+  CLOCK,
+};
+
 /**
  * Replacer is an abstract class that tracks page usage.
  */
@@ -43,8 +55,21 @@ class Replacer {
    */
   virtual void Unpin(frame_id_t frame_id) = 0;
 
+  /**
+   * Forgets a frame because the page it held is gone, e.g. deleted or evicted by the caller. Unlike Pin(), this is
+   * not a use of the frame, so replacers that keep a reference history drop it.
+   * @param frame_id the id of the frame to remove
+   */
+  virtual void Remove(frame_id_t frame_id) { Pin(frame_id); }
+
   /** @return the number of elements in the replacer that can be victimized */
   virtual auto Size() -> size_t = 0;
+
+  /**
+   * @return the frames that can be victimized, in the order the replacer would pick them right now, the next victim
+   * first. Does not count as a use of any frame.
+   */
+  virtual auto GetEvictionOrder() -> std::vector<frame_id_t> = 0;
 };
 
 }  // namespace bustub
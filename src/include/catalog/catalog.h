@@ -218,7 +218,8 @@ class Catalog {
     // Populate the index with all tuples in table heap
     auto *table_meta = GetTable(table_name);
     auto *heap = table_meta->table_.get();
-    for (auto tuple = heap->Begin(txn); tuple != heap->End(); ++tuple) {
+    auto strategy = std::make_shared<BufferAccessStrategy>(BufferAccessStrategyType::BULKREAD);
+    for (auto tuple = heap->Begin(txn, strategy); tuple != heap->End(); ++tuple) {
       index->InsertEntry(tuple->KeyFromTuple(schema, key_schema, key_attrs), tuple->GetRid(), txn);
     }
 
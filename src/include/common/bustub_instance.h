@@ -17,6 +17,7 @@
 #include "concurrency/lock_manager.h"
 #include "recovery/checkpoint_manager.h"
 #include "recovery/log_manager.h"
+#include "recovery/log_recovery.h"
 #include "storage/disk/disk_manager.h"
 
 namespace bustub {
@@ -54,6 +55,16 @@ class BustubInstance {
     delete disk_manager_;
   }
 
+  /**
+   * Redo and undo what the log of the database holds, and have new log records continue its LSNs. Call it before
+   * logging is turned on.
+   */
+  void Recover() {
+    LogRecovery log_recovery(disk_manager_, buffer_pool_manager_, log_manager_);
+    log_recovery.Redo();
+    log_recovery.Undo();
+  }
+
   DiskManager *disk_manager_;
   BufferPoolManager *buffer_pool_manager_;
   LockManager *lock_manager_;
@@ -12,9 +12,13 @@
 
 #pragma once
 
+#include <array>
+#include <atomic>
 #include <climits>
 #include <condition_variable>  // NOLINT
-#include <mutex>               // NOLINT
+#include <cstddef>
+#include <mutex>         // NOLINT
+#include <shared_mutex>  // NOLINT
 
 #include "common/macros.h"
 
@@ -93,4 +97,60 @@ class ReaderWriterLatch {
   bool writer_entered_{false};
 };
 
+/**
+ * Reader-writer latch for data that is read all the time and written almost never. Every reader only touches the
+ * shard of its own thread, so readers on different cores do not bounce a cache line between them; a writer has to
+ * take every shard instead. Not reentrant.
+ */
+class BigReaderLatch {
+ public:
+  /** Number of shards; threads beyond this share shards. */
+  static constexpr size_t NUM_SHARDS = 16;
+
+  BigReaderLatch() = default;
+  DISALLOW_COPY(BigReaderLatch);
+
+  /**
+   * Acquire a write latch.
+   */
+  void WLock() {
+    for (auto &shard : shards_) {
+      shard.latch_.lock();
+    }
+  }
+
+  /**
+   * Release a write latch.
+   */
+  void WUnlock() {
+    for (auto &shard : shards_) {
+      shard.latch_.unlock();
+    }
+  }
+
+  /**
+   * Acquire a read latch.
+   */
+  void RLock() { shards_[ShardIndex()].latch_.lock_shared(); }
+
+  /**
+   * Release a read latch. Must be called by the thread that acquired it.
+   */
+  void RUnlock() { shards_[ShardIndex()].latch_.unlock_shared(); }
+
+ private:
+  struct alignas(64) Shard {
+    std::shared_mutex latch_;
+  };
+
+  /** @return the shard of the calling thread, assigned round robin the first time it asks */
+  static auto ShardIndex() -> size_t {
+    static std::atomic<size_t> next_shard{0};
+    thread_local size_t shard = next_shard.fetch_add(1, std::memory_order_relaxed) % NUM_SHARDS;
+    return shard;
+  }
+
+  std::array<Shard, NUM_SHARDS> shards_;
+};
+
 }  // namespace bustub
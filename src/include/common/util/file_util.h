@@ -0,0 +1,37 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// file_util.h
+//
+// Identification: src/include/common/util/file_util.h
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+namespace bustub {
+
+/**
+ * FileUtil has the steps that make small metadata files durable, shared by everything that keeps one next to the
+ * database file.
+ */
+class FileUtil {
+ public:
+  /**
+   * Replace the contents of a file: write them to <file_name>.tmp, sync it, rename it over the file and sync the
+   * directory. After a crash the file holds either the old or the new contents, and once this returns true, the new.
+   * @return false on an I/O error
+   */
+  static auto ReplaceFile(const std::string &file_name, const char *data, size_t size) -> bool;
+
+  /** Sync the directory a file is in, so that creating, renaming or removing the file survives a crash. */
+  static auto SyncDirectory(const std::string &file_name) -> bool;
+};
+
+}  // namespace bustub
@@ -264,8 +264,8 @@ class Transaction {
   std::shared_ptr<std::deque<TableWriteRecord>> table_write_set_;
   /** The undo set of indexes. 撤销的索引操作*/
   std::shared_ptr<std::deque<IndexWriteRecord>> index_write_set_;
-  /** The LSN of the last record written by the transaction. */
-  lsn_t prev_lsn_;
+  /** The LSN of the last record written by the transaction. Checkpoints read it from their own thread. */
+  std::atomic<lsn_t> prev_lsn_;
 
   /** Concurrent index: the pages that were latched during index operation.索引操作的时候，被锁村的页 */
   std::shared_ptr<std::deque<Page *>> page_set_;
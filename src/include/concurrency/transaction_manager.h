@@ -13,9 +13,12 @@
 #pragma once
 
 #include <atomic>
+#include <mutex>  // NOLINT
 #include <shared_mutex>
 #include <unordered_map>
 #include <unordered_set>
+#include <utility>
+#include <vector>
 
 #include "common/config.h"
 #include "concurrency/lock_manager.h"
@@ -49,6 +52,7 @@ class TransactionManager {
   /**
    * Commits a transaction.
    * @param txn the transaction to commit
+   * @throw Exception if its COMMIT record could not be written to the log; it is finished, but not durable
    */
   void Commit(Transaction *txn);
 
@@ -80,6 +84,13 @@ class TransactionManager {
     return res;
   }
 
+  /**
+   * The active transaction table of a fuzzy checkpoint, taken without stopping anybody.
+   * @param[out] first_lsn no log record of the listed transactions is older; INVALID_LSN if none is active
+   * @return (txn id, LSN of its last log record) of the transactions that have not committed or aborted yet
+   */
+  auto GetActiveTransactionTable(lsn_t *first_lsn) -> std::vector<std::pair<txn_id_t, lsn_t>>;
+
   /** Prevents all transactions from performing operations, used for checkpointing. */
   void BlockAllTransactions();
 
@@ -104,13 +115,24 @@ class TransactionManager {
     }
   }
 
+  /** Drop a transaction from the active transaction table once its COMMIT or ABORT record is appended. */
+  void UnregisterTransaction(Transaction *txn);
+
   std::atomic<txn_id_t> next_txn_id_{0};
   // 表示该变量可能不使用，编译器忽略，不要产生警告信息。
   LockManager *lock_manager_ __attribute__((__unused__));
-  LogManager *log_manager_ __attribute__((__unused__));
+  LogManager *log_manager_;
 
   /** The global transaction latch is used for checkpointing. */
   ReaderWriterLatch global_txn_latch_;
+
+  /** Guards active_txns_. */
+  std::mutex active_latch_;
+  /**
+   * The transactions between Begin() and the end of Commit() or Abort(), each with the next LSN when it began, which
+   * its BEGIN record cannot be older than.
+   */
+  std::unordered_map<txn_id_t, std::pair<Transaction *, lsn_t>> active_txns_;
 };
 
 }  // namespace bustub
@@ -21,6 +21,7 @@
 #include "container/hash/hash_function.h"
 #include "storage/page/hash_table_bucket_page.h"
 #include "storage/page/hash_table_directory_page.h"
+#include "storage/page/page_guard.h"
 
 namespace bustub {
 
@@ -122,21 +123,12 @@ class ExtendibleHashTable {
   inline auto KeyToPageId(KeyType key, HashTableDirectoryPage *dir_page) -> uint32_t;
 
   /**
-   * Fetches the directory page from the buffer pool manager.
+   * Fetches the directory page from the buffer pool manager, creating the directory and its first bucket on first
+   * use. The page is pinned but not latched; the table latch protects the directory.
    *
-   * @return a pointer to the directory page
+   * @return a guard for the directory page
    */
-  auto FetchDirectoryPage() -> HashTableDirectoryPage *;
-
-  /**
-   * Fetches the a bucket page from the buffer pool manager using the bucket's page_id.
-   *
-   * @param bucket_page_id the page_id to fetch
-   * @return a pointer to a bucket page
-   */
-  auto FetchPage(page_id_t bucket_page_id) -> Page *;
-
-  auto FetchBucketPage(Page *page) -> HASH_TABLE_BUCKET_TYPE *;
+  auto FetchDirectoryPage() -> BasicPageGuard;
 
   /**
    * Performs insertion with an optional bucket splitting.
@@ -57,7 +57,12 @@ class InsertExecutor : public AbstractExecutor {
   /** @return The output schema for the insert */
   auto GetOutputSchema() -> const Schema * override { return plan_->OutputSchema(); };
   // 非const的
-  void InsertIntoDataAndIndex(Tuple *tuple);
+  /**
+   * Insert a tuple into the table and all of its indexes.
+   * @param tuple the tuple to insert
+   * @param strategy access strategy of a bulk insert, or nullptr
+   */
+  void InsertIntoDataAndIndex(Tuple *tuple, BufferAccessStrategy *strategy = nullptr);
 
  private:
   /** The insert plan node to be executed*/
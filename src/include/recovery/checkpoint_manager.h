@@ -12,6 +12,8 @@
 
 #pragma once
 
+#include <thread>  // NOLINT
+
 #include "buffer/buffer_pool_manager.h"
 #include "concurrency/transaction_manager.h"
 #include "recovery/log_manager.h"
@@ -19,7 +21,15 @@
 namespace bustub {
 
 /**
- * CheckpointManager creates consistent checkpoints by blocking all other transactions temporarily.
+ * CheckpointManager takes fuzzy checkpoints (ARIES): transactions keep running while one is taken.
+ *
+ * BeginCheckpoint() logs BEGIN_CHECKPOINT, collects the active transaction table and the dirty page table, and logs
+ * them in END_CHECKPOINT, together with where recovery has to start reading the log: at the oldest recovery LSN of a
+ * dirty page, or earlier if an active transaction began before that. Once END_CHECKPOINT is on disk the master record
+ * points at the checkpoint, and the dirty pages are written in the background, so that the next checkpoint can start
+ * later in the log. EndCheckpoint() waits for that write.
+ *
+ * Checkpoints are taken by one thread at a time.
  */
 class CheckpointManager {
  public:
@@ -29,15 +39,17 @@ class CheckpointManager {
         log_manager_(log_manager),
         buffer_pool_manager_(buffer_pool_manager) {}
 
-  ~CheckpointManager() = default;
+  ~CheckpointManager() { EndCheckpoint(); }
 
   void BeginCheckpoint();
   void EndCheckpoint();
 
  private:
-  TransactionManager *transaction_manager_ __attribute__((__unused__));
-  LogManager *log_manager_ __attribute__((__unused__));
-  BufferPoolManager *buffer_pool_manager_ __attribute__((__unused__));
+  TransactionManager *transaction_manager_;
+  LogManager *log_manager_;
+  BufferPoolManager *buffer_pool_manager_;
+  /** Writes the dirty pages of the last checkpoint. */
+  std::thread flush_thread_;
 };
 
 }  // namespace bustub
@@ -13,9 +13,14 @@
 #pragma once
 
 #include <algorithm>
+#include <array>
+#include <atomic>
 #include <condition_variable>  // NOLINT
+#include <deque>
 #include <future>              // NOLINT
 #include <mutex>               // NOLINT
+#include <thread>              // NOLINT
+#include <utility>
 
 #include "recovery/log_record.h"
 #include "storage/disk/disk_manager.h"
@@ -25,6 +30,13 @@ namespace bustub {
 /**
  * LogManager maintains a separate thread that is awakened whenever the log buffer is full or whenever a timeout
  * happens. When the thread is awakened, the log buffer's content is written into the disk log file.
+ *
+ * Appenders do not take a latch. A record reserves its room in the active buffer, and its LSN, with a single
+ * fetch-add on reservation_, then is copied in while other appenders copy theirs, and is counted as filled. To write
+ * a buffer, the flusher seals it, waits until the sealed prefix is filled, points the appenders at the other buffer
+ * and writes the batch with a single DiskManager::WriteLog, which syncs once for all of its records. A committing
+ * transaction waits in Flush() until persistent_lsn_ covers its COMMIT record, so all the commits that arrive during
+ * one write share the next one (group commit).
  */
 class LogManager {
  public:
@@ -32,9 +44,16 @@ class LogManager {
       : next_lsn_(0), persistent_lsn_(INVALID_LSN), disk_manager_(disk_manager) {
     log_buffer_ = new char[LOG_BUFFER_SIZE];
     flush_buffer_ = new char[LOG_BUFFER_SIZE];
+    buffers_[0].data_ = log_buffer_;
+    buffers_[1].data_ = flush_buffer_;
+    buffers_[0].file_offset_ = disk_manager_ != nullptr ? disk_manager_->GetLogFileSize() : 0;
+    written_buffers_.emplace_back(0, buffers_[0].file_offset_);
   }
 
   ~LogManager() {
+    if (flush_thread_ != nullptr) {
+      StopFlushThread();
+    }
     delete[] log_buffer_;
     delete[] flush_buffer_;
     log_buffer_ = nullptr;
@@ -46,13 +65,67 @@ class LogManager {
 
   auto AppendLogRecord(LogRecord *log_record) -> lsn_t;
 
+  /**
+   * Block until the log records up to and including lsn are on disk. Without a flush thread, the caller writes the
+   * log buffer itself.
+   * @param lsn the last log record that has to be persistent
+   * @return false if a log write failed before the record got out; it will never be persistent then
+   */
+  auto Flush(lsn_t lsn) -> bool;
+
+  /**
+   * Continue the LSNs of the log on disk, e.g. after recovery: the next record gets lsn, and the records before it
+   * count as persistent. Only before the first record is appended.
+   *
+   * GetLogOffset() knows where the old log has oldest_lsn from then on. Pages changed meanwhile, e.g. by redo, got
+   * recovery LSNs below lsn; they may miss changes from oldest_lsn on, and older ones map to its offset.
+   * @param lsn one past the newest LSN in the log
+   * @param oldest_lsn LSN of the oldest record in the log that a page may be missing, e.g. where redo started
+   * @param oldest_offset where that record starts in the log
+   */
+  void SetNextLSN(lsn_t lsn, lsn_t oldest_lsn, int64_t oldest_offset);
+
   inline auto GetNextLSN() -> lsn_t { return next_lsn_; }
   inline auto GetPersistentLSN() -> lsn_t { return persistent_lsn_; }
   inline void SetPersistentLSN(lsn_t lsn) { persistent_lsn_ = lsn; }
-  inline auto GetLogBuffer() -> char * { return log_buffer_; }
+  auto GetLogBuffer() -> char *;
+  inline auto GetDiskManager() -> DiskManager * { return disk_manager_; }
+
+  /**
+   * Where to start reading the log to see the record with the given LSN: the offset in the log file of the buffer
+   * that holds it, which starts with a record. Only LSNs handed out by this LogManager, or given to SetNextLSN(), and
+   * not trimmed are known; older ones map to the oldest known buffer.
+   * @param lsn LSN of a record that is, or will be, in the log
+   * @return a record boundary at or before the record
+   */
+  auto GetLogOffset(lsn_t lsn) -> int64_t;
+
+  /**
+   * Forget the offsets of the buffers before the one that holds lsn, e.g. once a checkpoint no longer needs them.
+   * @param lsn the oldest LSN GetLogOffset() will still be asked about
+   */
+  void TrimLogOffsets(lsn_t lsn);
 
  private:
-  // TODO(students): you may add your own member variables
+  /** One of the two log buffers, and how far the generation of records that fills it has got. */
+  struct LogBuffer {
+    char *data_{nullptr};
+    /** LSN of the first record in the buffer. */
+    lsn_t base_lsn_{0};
+    /** Where the buffer goes in the log file. */
+    int64_t file_offset_{0};
+    /** Bytes whose copy is complete; the buffer can be written once they reach the sealed size. */
+    std::atomic<int64_t> filled_{0};
+    /** Record count and size of the buffer when an appender sealed it by overflowing it, -1 while it is open. */
+    std::atomic<int64_t> sealed_{-1};
+  };
+
+  /** Serialize a record into the room reserved for it. */
+  static void SerializeLogRecord(LogRecord *log_record, char *pos);
+  /** Wait until a record of the given size may fit, after it did not fit into the buffer of generation gen. */
+  void WaitForRoom(uint32_t gen, int32_t size);
+  /** Seal the active buffer, switch the appenders over to the other one and write out the sealed records. */
+  void FlushBuffer();
 
   /** The atomic counter which records the next log sequence number. */
   std::atomic<lsn_t> next_lsn_;
@@ -61,14 +134,42 @@ class LogManager {
 
   char *log_buffer_;
   char *flush_buffer_;
-
+  std::array<LogBuffer, 2> buffers_;
+  /**
+   * Generation (8 bits), record count (16 bits) and used bytes (40 bits) of the active buffer, which is
+   * buffers_[generation % 2]. Appenders add their record to the count and their size to the bytes; a size past
+   * LOG_BUFFER_SIZE means the buffer is sealed.
+   */
+  std::atomic<uint64_t> reservation_{0};
+
+  /**
+   * (base LSN, file offset) of the buffers from the oldest one GetLogOffset() may be asked about to the active one;
+   * guarded by flush_latch_.
+   */
+  std::deque<std::pair<lsn_t, int64_t>> written_buffers_;
+
+  /** Guards the flush thread state and the condition variables. */
   std::mutex latch_;
-
-  std::thread *flush_thread_ __attribute__((__unused__));
-
+  /** FlushBuffer() runs one at a time. */
+  std::mutex flush_latch_;
+
+  std::thread *flush_thread_{nullptr};
+  /** Cleared to stop the flush thread. */
+  bool running_{false};
+  /** Somebody waits for the active buffer to be written. */
+  bool flush_requested_{false};
+  /**
+   * A log write failed. The log on disk ends before the records of that write, so the later ones are not written
+   * either, and persistent_lsn_ stays where it was.
+   */
+  bool write_failed_{false};
+
+  /** Wakes up the flush thread. */
   std::condition_variable cv_;
+  /** Signals a switch of buffers to appenders waiting for room, and a finished write to committers. */
+  std::condition_variable flushed_cv_;
 
-  DiskManager *disk_manager_ __attribute__((__unused__));
+  DiskManager *disk_manager_;
 };
 
 }  // namespace bustub
@@ -14,6 +14,8 @@
 
 #include <cassert>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include "common/config.h"
 #include "storage/table/tuple.h"
@@ -32,6 +34,12 @@ enum class LogRecordType {
   ABORT,
   /** Creating a new page in the table heap. */
   NEWPAGE,
+  /** Start of a fuzzy checkpoint; the master record points here. */
+  BEGIN_CHECKPOINT,
+  /** End of a fuzzy checkpoint, with the tables it collected after BEGIN_CHECKPOINT. */
+  END_CHECKPOINT,
+  /** Compensation log record: a change recovery made to undo another record. */
+  CLR,
 };
 
 /**
@@ -57,6 +65,14 @@ enum class LogRecordType {
  *--------------------------
  * | HEADER | prev_page_id |
  *--------------------------
+ * For end checkpoint type log record (begin checkpoint is just the header)
+ *----------------------------------------------------------------------------------------------------------
+ * | HEADER | scan_offset | redo_offset | txn_count | (txn_id, last_lsn)... | page_count | (page_id, rec_lsn)... |
+ *----------------------------------------------------------------------------------------------------------
+ * For compensation log record, the compensating change is an INSERT, delete or UPDATE record body
+ *---------------------------------------------------------------------------
+ * | HEADER | undo_next_lsn | compensating LogType | body of that type of record |
+ *---------------------------------------------------------------------------
  */
 class LogRecord {
   friend class LogManager;
@@ -110,6 +126,33 @@ class LogRecord {
     size_ = HEADER_SIZE + sizeof(page_id_t) * 2;
   }
 
+  // constructor for END_CHECKPOINT type
+  LogRecord(int64_t scan_offset, int64_t redo_offset, std::vector<std::pair<txn_id_t, lsn_t>> active_txns,
+            std::vector<std::pair<page_id_t, lsn_t>> dirty_pages)
+      : log_record_type_(LogRecordType::END_CHECKPOINT),
+        scan_offset_(scan_offset),
+        redo_offset_(redo_offset),
+        active_txns_(std::move(active_txns)),
+        dirty_pages_(std::move(dirty_pages)) {
+    // calculate log record size, header size + both offsets + both tables with their lengths
+    size_ = HEADER_SIZE + 2 * sizeof(int64_t) + 2 * sizeof(int32_t) +
+            active_txns_.size() * (sizeof(txn_id_t) + sizeof(lsn_t)) +
+            dirty_pages_.size() * (sizeof(page_id_t) + sizeof(lsn_t));
+  }
+
+  // constructor for CLR type: the change that undoes a record, as a record of its own type, and the next record of
+  // the transaction to undo
+  LogRecord(txn_id_t txn_id, lsn_t prev_lsn, lsn_t undo_next_lsn, const LogRecord &change) : LogRecord(change) {
+    assert(change.log_record_type_ >= LogRecordType::INSERT && change.log_record_type_ <= LogRecordType::UPDATE);
+    lsn_ = INVALID_LSN;
+    txn_id_ = txn_id;
+    prev_lsn_ = prev_lsn;
+    log_record_type_ = LogRecordType::CLR;
+    undo_next_lsn_ = undo_next_lsn;
+    compensating_type_ = change.log_record_type_;
+    size_ = change.size_ + sizeof(lsn_t) + sizeof(LogRecordType);
+  }
+
   ~LogRecord() = default;
 
   inline auto GetDeleteTuple() -> Tuple & { return delete_tuple_; }
@@ -128,6 +171,18 @@ class LogRecord {
 
   inline auto GetNewPageRecord() -> page_id_t { return prev_page_id_; }
 
+  inline auto GetScanOffset() -> int64_t { return scan_offset_; }
+
+  inline auto GetRedoOffset() -> int64_t { return redo_offset_; }
+
+  inline auto GetActiveTxns() -> std::vector<std::pair<txn_id_t, lsn_t>> & { return active_txns_; }
+
+  inline auto GetDirtyPages() -> std::vector<std::pair<page_id_t, lsn_t>> & { return dirty_pages_; }
+
+  inline auto GetUndoNextLSN() -> lsn_t { return undo_next_lsn_; }
+
+  inline auto GetCompensatingType() -> LogRecordType { return compensating_type_; }
+
   inline auto GetSize() -> int32_t { return size_; }
 
   inline auto GetLSN() -> lsn_t { return lsn_; }
@@ -176,6 +231,18 @@ class LogRecord {
   // case4: for new page operation
   page_id_t prev_page_id_{INVALID_PAGE_ID};
   page_id_t page_id_{INVALID_PAGE_ID};
+
+  // case5: for end checkpoint, where recovery starts reading the log and where it starts to redo, the active
+  // transactions with their last LSN, and the dirty pages with their recovery LSN
+  int64_t scan_offset_{0};
+  int64_t redo_offset_{0};
+  std::vector<std::pair<txn_id_t, lsn_t>> active_txns_;
+  std::vector<std::pair<page_id_t, lsn_t>> dirty_pages_;
+
+  // case6: for compensation log record, the next record to undo and the type of the change; the change itself is in
+  // the fields of its type
+  lsn_t undo_next_lsn_{INVALID_LSN};
+  LogRecordType compensating_type_{LogRecordType::INVALID};
   static const int HEADER_SIZE = 20;
 };  // namespace bustub
 
@@ -13,23 +13,64 @@
 #pragma once
 
 #include <algorithm>
+#include <condition_variable>  // NOLINT
+#include <deque>
+#include <exception>
+#include <memory>
 #include <mutex>  // NOLINT
 #include <unordered_map>
+#include <vector>
 
 #include "buffer/buffer_pool_manager.h"
 #include "concurrency/lock_manager.h"
+#include "recovery/log_manager.h"
 #include "recovery/log_record.h"
+#include "storage/page/table_page.h"
 
 namespace bustub {
 
+/** Redo workers LogRecovery uses by default. */
+static constexpr size_t LOG_RECOVERY_REDO_THREADS = 4;
+
 /**
  * Read log file from disk, redo and undo.
+ *
+ * Redo is parallel by page: one reader goes through the log in large sequential reads, builds the active transaction
+ * table and the LSN map, and deals each record out to the worker that owns its page (page id modulo the number of
+ * workers). Every worker applies the records of its pages in LSN order and skips those that the page already
+ * reflects. If the master record points at a checkpoint, reading starts where the checkpoint says, and records
+ * before it are only redone on pages of its dirty page table. Undo rolls back the transactions that were still
+ * active, newest record first. The log manager, if there is one, continues the LSNs of the log after Redo().
+ *
+ * With a log manager, undo is logged like ARIES does it: each change it makes goes into a compensation log record
+ * (CLR) first, which redo repeats like any other change, and which points at the next record of its transaction to
+ * undo. A crash during undo thus neither undoes a record twice nor loses an undo, and a transaction that is rolled
+ * back completely gets an ABORT record. Without a log manager, undo is not logged.
+ *
+ * A record that cannot be read or applied, or a page without a frame to recover it in, makes Redo() or Undo() throw
+ * an Exception: the database cannot be recovered past it.
  */
 class LogRecovery {
  public:
-  LogRecovery(DiskManager *disk_manager, BufferPoolManager *buffer_pool_manager)
-      : disk_manager_(disk_manager), buffer_pool_manager_(buffer_pool_manager), offset_(0) {
-    log_buffer_ = new char[LOG_BUFFER_SIZE];
+  /** Bytes the reader reads at a time; at least as big as a log record can be. */
+  static constexpr int REDO_READ_SIZE = 1 << 20;
+  /** Batches a redo worker may have waiting before the reader waits for it. */
+  static constexpr size_t REDO_MAX_QUEUED_BATCHES = 8;
+
+  /**
+   * @param disk_manager the disk manager with the log
+   * @param buffer_pool_manager the buffer pool the pages are recovered into; it needs more frames than redo workers
+   * @param log_manager the log manager that appends to the log after recovery, if any
+   * @param num_redo_threads number of redo workers
+   */
+  LogRecovery(DiskManager *disk_manager, BufferPoolManager *buffer_pool_manager, LogManager *log_manager = nullptr,
+              size_t num_redo_threads = LOG_RECOVERY_REDO_THREADS)
+      : disk_manager_(disk_manager),
+        buffer_pool_manager_(buffer_pool_manager),
+        log_manager_(log_manager),
+        num_redo_threads_(std::max<size_t>(num_redo_threads, 1)),
+        offset_(0) {
+    log_buffer_ = new char[REDO_READ_SIZE];
   }
 
   ~LogRecovery() {
@@ -37,20 +78,78 @@ class LogRecovery {
     log_buffer_ = nullptr;
   }
 
+  /** @throw Exception if the log cannot be redone */
   void Redo();
+  /** @throw Exception if the unfinished transactions cannot be rolled back */
   void Undo();
-  auto DeserializeLogRecord(const char *data, LogRecord *log_record) -> bool;
+  /**
+   * @param data the serialized record
+   * @param size bytes available at data
+   * @param[out] log_record the record
+   * @return false if no complete record starts at data
+   */
+  auto DeserializeLogRecord(const char *data, int64_t size, LogRecord *log_record) -> bool;
 
  private:
-  DiskManager *disk_manager_ __attribute__((__unused__));
-  BufferPoolManager *buffer_pool_manager_ __attribute__((__unused__));
+  /** A record for a redo worker, and which of its pages it is for; NEWPAGE records touch two pages. */
+  struct RedoItem {
+    page_id_t page_id_;
+    LogRecord record_;
+  };
+  /** The records of one redo worker, in batches in LSN order. */
+  struct RedoQueue {
+    std::mutex latch_;
+    std::condition_variable cv_;
+    std::deque<std::vector<RedoItem>> batches_;
+    bool done_{false};
+    /** Why the worker stopped applying records; it still takes the batches, so the reader does not wait for it. */
+    std::exception_ptr error_;
+  };
+
+  void RedoLoop(RedoQueue *queue);
+  /** Apply a record to a page, unless the page LSN says it is there already. */
+  void RedoRecord(const RedoItem &item);
+  /** Roll back a record of a transaction that did not finish, logging the change in a CLR. */
+  void UndoRecord(LogRecord *log_record);
+  /** Read the record with the given LSN, which has to be in lsn_mapping_. */
+  void ReadRecord(lsn_t lsn, LogRecord *log_record);
+  /** @return the page a change to a tuple, or a CLR, is on; INVALID_PAGE_ID for other records */
+  static auto ChangedPage(const LogRecord &log_record) -> page_id_t;
+  /** Make the change to a tuple that a record, or a CLR, describes. */
+  static void ApplyChange(TablePage *table_page, const LogRecord &log_record);
+  /**
+   * Find the checkpoint the master record points at, and take its tables and offsets.
+   * @param offset where the master record says the checkpoint starts
+   * @return false if the log holds no complete checkpoint from there on
+   */
+  auto ReadCheckpoint(int64_t offset) -> bool;
+  /** @return false if the dirty page table of the checkpoint shows that the page on disk has the record already */
+  auto NeedsRedo(page_id_t page_id, lsn_t lsn, int64_t offset) -> bool;
+
+  DiskManager *disk_manager_;
+  BufferPoolManager *buffer_pool_manager_;
+  LogManager *log_manager_;
+  size_t num_redo_threads_;
 
   /** Maintain active transactions and its corresponding latest lsn. */
   std::unordered_map<txn_id_t, lsn_t> active_txn_;
   /** Mapping the log sequence number to log file offset for undos. */
-  std::unordered_map<lsn_t, int> lsn_mapping_;
+  std::unordered_map<lsn_t, int64_t> lsn_mapping_;
 
-  int offset_ __attribute__((__unused__));
+  /** Where the next record starts in the log file. */
+  int64_t offset_;
+  /** One past the newest LSN read from the log. */
+  lsn_t next_lsn_{0};
+  /** The oldest record Redo() read, and where it starts; pages may miss changes from it on. */
+  lsn_t first_lsn_{INVALID_LSN};
+  int64_t first_offset_{0};
+  /** Offset of the BEGIN_CHECKPOINT record recovery starts from, -1 without a checkpoint. */
+  int64_t checkpoint_offset_{-1};
+  /** Where the checkpoint says to start reading the log, and where to start redoing. */
+  int64_t scan_offset_{0};
+  int64_t redo_offset_{0};
+  /** The dirty page table of the checkpoint: the pages that may miss changes, with their recovery LSN. */
+  std::unordered_map<page_id_t, lsn_t> dirty_pages_;
   char *log_buffer_;
 };
 
@@ -0,0 +1,187 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// async_io.h
+//
+// Identification: src/include/storage/disk/async_io.h
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <sys/types.h>
+#include <sys/uio.h>
+
+#include <chrono>  // NOLINT
+#include <condition_variable>  // NOLINT
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>  // NOLINT
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "common/macros.h"
+
+struct io_uring_sqe;
+struct io_uring_cqe;
+
+namespace bustub {
+
+/** One positional read or write handed to an AsyncIO backend. */
+struct AsyncIORequest {
+  bool is_write_;
+  int fd_;
+  /** The buffer; a write only reads from it. */
+  char *data_;
+  size_t size_;
+  off_t offset_;
+  /**
+   * Runs once the whole request is done, on a thread of the backend, with true on success. A read reaching past the
+   * end of the file succeeds and zero-fills the rest. The callback must not block, as no other request of the backend
+   * completes meanwhile.
+   */
+  std::function<void(bool)> callback_;
+  /** Bytes transferred so far; a transfer may come back short and is then continued. */
+  size_t done_{0};
+  /** Scratch space for backends that take an iovec. */
+  struct iovec iov_ {};
+};
+
+/**
+ * AsyncIO keeps many reads and writes in flight at once. Submit() only queues a request, its callback reports the
+ * completion. Use MakeAsyncIO() to get the best backend the system offers.
+ */
+class AsyncIO {
+ public:
+  virtual ~AsyncIO() = default;
+
+  /**
+   * Start a request. Blocks only while the backend already has as many requests in flight as it takes.
+   * @param request the request, owned by the backend until its callback has run
+   */
+  virtual void Submit(std::unique_ptr<AsyncIORequest> request) = 0;
+
+  /** @return true if the requests are executed by io_uring */
+  virtual auto IsIoUring() const -> bool = 0;
+
+ protected:
+  /**
+   * Account for one transfer of a request and run its callback if it is done.
+   * @param request the request
+   * @param result bytes transferred, or a negative errno
+   * @return true if the request is done, false if the rest of it must be submitted again
+   */
+  static auto Advance(AsyncIORequest *request, ssize_t result) -> bool;
+};
+
+/**
+ * AsyncIO backed by an io_uring instance. Submissions go straight into the submission ring, a completion thread reaps
+ * the completion ring and runs the callbacks.
+ */
+class IoUringIO : public AsyncIO {
+ public:
+  /**
+   * Set up the rings. Check IsOpen() afterwards: the kernel may not offer io_uring or may forbid it.
+   * @param queue_depth the most requests in flight at once
+   */
+  explicit IoUringIO(size_t queue_depth);
+
+  ~IoUringIO() override;
+
+  DISALLOW_COPY_AND_MOVE(IoUringIO);
+
+  /** @return true if the rings were set up */
+  auto IsOpen() const -> bool { return ring_fd_ >= 0; }
+
+  void Submit(std::unique_ptr<AsyncIORequest> request) override;
+
+  auto IsIoUring() const -> bool override { return true; }
+
+ private:
+  /** Shortest and longest wait before io_uring_enter() is retried after EAGAIN or EBUSY. */
+  static constexpr std::chrono::microseconds MIN_SUBMIT_BACKOFF{10};
+  static constexpr std::chrono::microseconds MAX_SUBMIT_BACKOFF{1000};
+
+  /** Put the (rest of the) request into the submission ring; needs sq_latch_. Flush() hands it to the kernel. */
+  void Push(AsyncIORequest *request);
+  /**
+   * Hand the entries pushed so far to the kernel. Releases the latch while backing off.
+   * @param lock the held sq_latch_
+   * @param from_reaper true on the completion thread, which must not wait for itself to reap the completion ring
+   * @return false if io_uring_enter() failed for good and the entries were completed with failure
+   */
+  auto Flush(std::unique_lock<std::mutex> *lock, bool from_reaper) -> bool;
+  /** Take the entries the kernel did not accept back out of the ring and fail their requests. */
+  void FailUnsubmitted(std::unique_lock<std::mutex> *lock, int error);
+  void CompletionLoop();
+
+  int ring_fd_{-1};
+  void *sq_ring_{nullptr};
+  void *cq_ring_{nullptr};
+  size_t sq_ring_size_{0};
+  size_t cq_ring_size_{0};
+  io_uring_sqe *sqes_{nullptr};
+  size_t sqes_size_{0};
+  unsigned *sq_tail_{nullptr};
+  unsigned *sq_mask_{nullptr};
+  unsigned *sq_array_{nullptr};
+  unsigned *cq_head_{nullptr};
+  unsigned *cq_tail_{nullptr};
+  unsigned *cq_mask_{nullptr};
+  io_uring_cqe *cqes_{nullptr};
+
+  /** Number of entries of the submission ring; in_flight_ never exceeds it, so the rings never overflow. */
+  size_t depth_{0};
+  std::mutex sq_latch_;
+  std::condition_variable slot_cv_;
+  size_t in_flight_{0};
+  /** Entries in the submission ring the kernel has not consumed yet. */
+  unsigned unsubmitted_{0};
+  /** Set once io_uring_enter() failed with an error that retrying does not cure. */
+  bool ring_failed_{false};
+  std::thread completion_thread_;
+};
+
+/** AsyncIO for systems without io_uring: a few threads executing the requests with blocking pread/pwrite. */
+class ThreadPoolIO : public AsyncIO {
+ public:
+  /**
+   * Start the threads.
+   * @param num_threads number of threads, so the most requests in flight at once
+   */
+  explicit ThreadPoolIO(size_t num_threads);
+
+  ~ThreadPoolIO() override;
+
+  DISALLOW_COPY_AND_MOVE(ThreadPoolIO);
+
+  void Submit(std::unique_ptr<AsyncIORequest> request) override;
+
+  auto IsIoUring() const -> bool override { return false; }
+
+ private:
+  void WorkerLoop();
+
+  std::mutex latch_;
+  std::condition_variable cv_;
+  std::deque<std::unique_ptr<AsyncIORequest>> queue_;
+  bool stop_{false};
+  std::vector<std::thread> workers_;
+};
+
+/** Threads of the ThreadPoolIO fallback. */
+static constexpr size_t ASYNC_IO_FALLBACK_THREADS = 4;
+
+/**
+ * Create an io_uring backend, or a thread pool if io_uring is not available.
+ * @param queue_depth the most requests in flight at once with io_uring
+ * @param use_io_uring false to always take the thread pool
+ */
+auto MakeAsyncIO(size_t queue_depth, bool use_io_uring = true) -> std::unique_ptr<AsyncIO>;
+
+}  // namespace bustub
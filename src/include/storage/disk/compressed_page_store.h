@@ -0,0 +1,122 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// compressed_page_store.h
+//
+// Identification: src/include/storage/disk/compressed_page_store.h
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <mutex>  // NOLINT
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "common/config.h"
+#include "common/macros.h"
+
+namespace bustub {
+
+/**
+ * CompressedPageStore keeps every page of a database file compressed with Lz4Codec, in an extent of whole sectors
+ * somewhere in the file. A page location map, kept in a file of its own, tells where the extent of each page is.
+ *
+ * Pages are never overwritten in place: a write goes to a fresh extent and the map is pointed at it. The old extent
+ * becomes free for reuse only once Sync() has made the map durable, so the map on disk always points at intact
+ * pages. Free extents are not stored, they are the gaps between the extents the map refers to.
+ */
+class CompressedPageStore {
+ public:
+  /** Unit of allocation in the db file. */
+  static constexpr size_t SECTOR_SIZE = 512;
+  /** Sectors of an uncompressed page; a page that does not compress below that is stored as it is. */
+  static constexpr size_t SECTORS_PER_PAGE = PAGE_SIZE / SECTOR_SIZE;
+
+  /**
+   * Open the store and read its page location map.
+   * @param db_fd descriptor of the db file, which stays owned by the caller
+   * @param map_file_name the page location map
+   */
+  CompressedPageStore(int db_fd, const std::string &map_file_name);
+
+  ~CompressedPageStore();
+
+  DISALLOW_COPY_AND_MOVE(CompressedPageStore);
+
+  /**
+   * Read and decompress a page. A page that was never written reads as zeroes.
+   * @param page_id id of the page
+   * @param[out] page_data output buffer of PAGE_SIZE bytes
+   * @return bytes read from the db file
+   */
+  auto ReadPage(page_id_t page_id, char *page_data) -> size_t;
+
+  /**
+   * Compress a page and write it to a new extent.
+   * @param page_id id of the page
+   * @param page_data raw page data
+   * @return bytes written to the db file, sector padding included
+   */
+  auto WritePage(page_id_t page_id, const char *page_data) -> size_t;
+
+  /**
+   * Forget a page; its extent becomes free with the next Sync().
+   * @param page_id id of the page
+   */
+  void DeallocatePage(page_id_t page_id);
+
+  /** Make the written pages and the map durable, then free the extents the map no longer refers to. */
+  void Sync();
+
+  /** @return one more than the highest page id that was ever written */
+  auto GetNumPages() -> page_id_t;
+
+ private:
+  /** Where a page is: its extent starts at sector_, size_ bytes of it are used. size_ == 0 if there is no page. */
+  struct PageLocation {
+    uint64_t sector_;
+    uint32_t size_;
+    uint32_t reserved_;
+  };
+  /** Map entries per SECTOR_SIZE block of the map file; the map is written back block by block. */
+  static constexpr size_t LOCATIONS_PER_BLOCK = SECTOR_SIZE / sizeof(PageLocation);
+
+  static auto SectorsOf(uint32_t size) -> size_t { return (size + SECTOR_SIZE - 1) / SECTOR_SIZE; }
+
+  /** Find an extent of the given number of sectors, needs latch_. */
+  auto AllocateExtent(size_t sectors) -> uint64_t;
+  /** Return an extent to the free space, merging it with its free neighbours; needs latch_. */
+  void FreeExtent(uint64_t sector, size_t sectors);
+  /** Point the map at a new location and retire the old extent, needs latch_. */
+  void SetLocation(page_id_t page_id, PageLocation location);
+
+  int db_fd_;
+  int map_fd_{-1};
+
+  std::mutex latch_;
+  std::vector<PageLocation> locations_;
+  /** Blocks of the map file that differ from the map in memory. */
+  std::set<size_t> dirty_blocks_;
+  /** Free extents, (sector, sectors). Neighbouring ones are always merged. */
+  std::map<uint64_t, size_t> free_by_sector_;
+  /** The same extents as (sectors, sector), for finding the best fit. */
+  std::set<std::pair<size_t, uint64_t>> free_by_size_;
+  /** Extents that the map on disk may still point at; (sector, sectors). */
+  std::vector<std::pair<uint64_t, size_t>> retired_extents_;
+  /** First sector past the last extent. */
+  uint64_t end_sector_{0};
+
+  /** Sync() runs one at a time. */
+  std::mutex sync_latch_;
+};
+
+}  // namespace bustub
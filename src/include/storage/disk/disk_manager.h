@@ -13,28 +13,52 @@
 #pragma once
 
 #include <atomic>
-#include <fstream>
+#include <cstdint>
+#include <functional>
 #include <future>  // NOLINT
-#include <mutex>   // NOLINT
+#include <memory>
+#include <mutex>  // NOLINT
 #include <string>
 
 #include "common/config.h"
+#include "storage/disk/async_io.h"
+#include "storage/disk/compressed_page_store.h"
+#include "storage/disk/free_page_map.h"
+#include "storage/disk/log_segments.h"
 
 namespace bustub {
 
+/** Construction-time settings of a DiskManager. */
+struct DiskManagerOptions {
+  /**
+   * Store every page compressed, see CompressedPageStore. Only takes effect for a new, empty db file: an existing
+   * file keeps the format it was created with. Asynchronous requests are executed right away on the calling thread
+   * in this mode.
+   */
+  bool compress_pages_{false};
+  /** Size of the segment files of a new log. An existing log keeps the size it was created with. */
+  int64_t log_segment_size_{LogSegments::DEFAULT_SEGMENT_SIZE};
+};
+
 /**
  * DiskManager takes care of the allocation and deallocation of pages within a database. It performs the reading and
  * writing of pages to and from disk, providing a logical file layer within the context of a database management system.
+ * Page reads and writes may be issued from several threads at once, and the asynchronous variants keep many of them in
+ * flight without a thread per request.
  */
 class DiskManager {
  public:
+  /** Most asynchronous page requests in flight at once with io_uring. */
+  static constexpr size_t ASYNC_IO_QUEUE_DEPTH = 64;
+
   /**
    * Creates a new disk manager that writes to the specified database file.
    * @param db_file the file name of the database file to write to
+   * @param options settings of the disk manager
    */
-  explicit DiskManager(const std::string &db_file);
+  explicit DiskManager(const std::string &db_file, const DiskManagerOptions &options = {});
 
-  ~DiskManager() = default;
+  ~DiskManager();
 
   /**
    * Shut down the disk manager and close all the file resources.
@@ -42,12 +66,21 @@ class DiskManager {
   void ShutDown();
 
   /**
-   * Write a page to the database file.
+   * Write a page to the database file. The page is durable only after the next Sync().
    * @param page_id id of the page
    * @param page_data raw page data
    */
   void WritePage(page_id_t page_id, const char *page_data);
 
+  /**
+   * Write a run of pages with consecutive ids to the database file in one request.
+   * @param page_id id of the first page
+   * @param pages_data raw data of the pages, one after the other
+   * @param num_pages number of pages in the run
+   * @return false on an I/O error
+   */
+  auto WritePages(page_id_t page_id, const char *pages_data, size_t num_pages) -> bool;
+
   /**
    * Read a page from the database file.
    * @param page_id id of the page
@@ -56,20 +89,115 @@ class DiskManager {
   void ReadPage(page_id_t page_id, char *page_data);
 
   /**
-   * Flush the entire log buffer into disk.
+   * Read a run of pages with consecutive ids from the database file in one request. Pages past the end of the file
+   * read as zeroes.
+   * @param page_id id of the first page
+   * @param[out] pages_data output buffer for the pages, one after the other
+   * @param num_pages number of pages in the run
+   */
+  void ReadPages(page_id_t page_id, char *pages_data, size_t num_pages);
+
+  /**
+   * Start reading a run of pages with consecutive ids, like ReadPages().
+   * @param page_id id of the first page
+   * @param[out] pages_data output buffer, which must stay valid until the callback has run
+   * @param num_pages number of pages in the run
+   * @param callback runs on an I/O thread when the read is done, with true on success; it must not block
+   */
+  void ReadPagesAsync(page_id_t page_id, char *pages_data, size_t num_pages, std::function<void(bool)> callback);
+
+  /**
+   * Start writing a run of pages with consecutive ids, like WritePages().
+   * @param page_id id of the first page
+   * @param pages_data raw data of the pages, which must stay valid until the callback has run
+   * @param num_pages number of pages in the run
+   * @param callback runs on an I/O thread when the write is done, with true on success; it must not block
+   */
+  void WritePagesAsync(page_id_t page_id, const char *pages_data, size_t num_pages,
+                       std::function<void(bool)> callback);
+
+  /** ReadPagesAsync() with a future instead of a callback. */
+  auto ReadPagesAsync(page_id_t page_id, char *pages_data, size_t num_pages) -> std::future<bool>;
+
+  /** WritePagesAsync() with a future instead of a callback. */
+  auto WritePagesAsync(page_id_t page_id, const char *pages_data, size_t num_pages) -> std::future<bool>;
+
+  /** @return true if asynchronous requests are executed by io_uring rather than by a thread pool */
+  auto UsesIoUring() -> bool { return GetAsyncIO()->IsIoUring(); }
+
+  /**
+   * Record that a page is no longer used, so that AllocateFreePage() can hand it out again.
+   * @param page_id id of the page
+   */
+  void DeallocatePage(page_id_t page_id) {
+    free_page_map_.Free(page_id);
+    if (compressed_store_ != nullptr) {
+      compressed_store_->DeallocatePage(page_id);
+    }
+  }
+
+  /**
+   * Take a deallocated page back into use. Page ids are striped over the buffer pool instances, so every instance
+   * only asks for the pages of its own stripe.
+   * @param min_page_id lowest id to consider
+   * @param residue the stripe, page_id % modulus == residue
+   * @param modulus number of stripes
+   * @return the id of the page, or INVALID_PAGE_ID if the stripe has no deallocated page
+   */
+  auto AllocateFreePage(page_id_t min_page_id, uint32_t residue, uint32_t modulus) -> page_id_t {
+    return free_page_map_.Take(min_page_id, residue, modulus);
+  }
+
+  /** @return the number of deallocated pages that were not taken back yet */
+  auto GetNumFreePages() const -> size_t { return free_page_map_.GetNumFree(); }
+
+  /**
+   * Wait until every page written so far, and the free page map, has reached stable storage. Page writes only reach
+   * the OS; callers that need them to survive a crash call this once after a batch of writes.
+   */
+  void Sync();
+
+  /**
+   * Flush the entire log buffer into disk. The records are durable when this returns; there is one sync per call,
+   * however many records the buffer holds.
    * @param log_data raw log data
    * @param size size of log entry
+   * @return false on an I/O error; the records may then be missing, partly or completely
    */
-  void WriteLog(char *log_data, int size);
+  auto WriteLog(char *log_data, int size) -> bool;
 
   /**
-   * Read a log entry from the log file.
+   * Read a log entry from the log. Offsets count from the start of the log as if it were one file, whichever segment
+   * they are in.
    * @param[out] log_data output buffer
    * @param size size of the log entry
-   * @param offset offset of the log entry in the file
-   * @return true if the read was successful, false otherwise
+   * @param offset offset of the log entry in the log
+   * @return true if the read was successful, false if offset is past the end of the log or was truncated away
+   */
+  auto ReadLog(char *log_data, int size, int64_t offset) -> bool;
+
+  /** @return the size of the log, which is where the next WriteLog lands */
+  auto GetLogFileSize() const -> int64_t { return log_segments_ != nullptr ? log_segments_->GetEnd() : 0; }
+
+  /** @return the oldest offset that is still in the log; the segments before it were truncated */
+  auto GetLogStartOffset() const -> int64_t { return log_segments_ != nullptr ? log_segments_->GetStart() : 0; }
+
+  /**
+   * Drop the log segments that end before an offset, recycling them for the log to come.
+   * @param offset the oldest offset that recovery may still read, e.g. where the last checkpoint starts reading
+   */
+  void TruncateLog(int64_t offset);
+
+  /**
+   * Durably point the master record at the last complete checkpoint. The old master record stays in place until the
+   * new one is on disk.
+   * @param offset offset in the log file at or before the checkpoint's BEGIN_CHECKPOINT record
+   * @return false on an I/O error; the old master record is then still in place
    */
-  auto ReadLog(char *log_data, int size, int offset) -> bool;
+  auto WriteMasterRecord(int64_t offset) -> bool;
+
+  /** @return the offset the master record points at, or -1 if no checkpoint has been taken */
+  auto ReadMasterRecord() -> int64_t;
 
   /** @return the number of disk flushes */
   auto GetNumFlushes() const -> int;
@@ -80,6 +208,18 @@ class DiskManager {
   /** @return the number of disk writes */
   auto GetNumWrites() const -> int;
 
+  /** @return the number of pages in the database file; page ids from there on have never been written */
+  auto GetNumPages() -> page_id_t;
+
+  /** @return true if the pages are stored compressed */
+  auto IsCompressed() const -> bool { return compressed_store_ != nullptr; }
+
+  /** @return bytes written to the db file by page writes; less than pages * PAGE_SIZE if they are compressed */
+  auto GetNumBytesWritten() const -> uint64_t { return bytes_written_; }
+
+  /** @return bytes read from the db file by page reads */
+  auto GetNumBytesRead() const -> uint64_t { return bytes_read_; }
+
   /**
    * Sets the future which is used to check for non-blocking flushes.
    * @param f the non-blocking flush check
@@ -90,19 +230,38 @@ class DiskManager {
   inline auto HasFlushLogFuture() -> bool { return flush_log_f_ != nullptr; }
 
  private:
-  auto GetFileSize(const std::string &file_name) -> int;
-  // stream to write log file
-  std::fstream log_io_;
+  static auto GetFileSize(const std::string &file_name) -> int64_t;
+  /** Raise the cached size of the db file to end, if it is smaller. */
+  void GrowDbFileSize(int64_t end);
+  /** @return the asynchronous I/O backend, set up on first use */
+  auto GetAsyncIO() -> AsyncIO *;
+  void SubmitPages(bool is_write, page_id_t page_id, char *pages_data, size_t num_pages,
+                   std::function<void(bool)> callback);
+  // the log, in segment files next to its control file <db>.log; WriteLog appends to the end and syncs
+  std::unique_ptr<LogSegments> log_segments_;
   std::string log_name_;
-  // stream to write db file
-  std::fstream db_io_;
+  // descriptor of the db file, read and written with pread/pwrite from any number of threads at once
+  std::atomic<int> db_fd_{-1};
+  // Sizes of the files, kept up to date by the writes instead of asking the file system on every request. Only
+  // this DiskManager writes the files.
+  std::atomic<int64_t> db_file_size_{0};
   std::string file_name_;
-  int num_flushes_;
-  int num_writes_;
-  bool flush_log_;
+  // deallocated pages, kept in a file next to the db file
+  FreePageMap free_page_map_;
+  std::string free_page_map_name_;
+  // set if the pages are stored compressed, with the page location map in its own file
+  std::unique_ptr<CompressedPageStore> compressed_store_;
+  std::string page_map_name_;
+  // where the last checkpoint is in the log
+  std::string master_record_name_;
+  std::atomic<int> num_flushes_;
+  std::atomic<int> num_writes_;
+  std::atomic<uint64_t> bytes_written_{0};
+  std::atomic<uint64_t> bytes_read_{0};
+  std::atomic<bool> flush_log_;
   std::future<void> *flush_log_f_;
-  // With multiple buffer pool instances, need to protect file access
-  std::mutex db_io_latch_;
+  std::once_flag async_io_once_;
+  std::unique_ptr<AsyncIO> async_io_;
 };
 
 }  // namespace bustub
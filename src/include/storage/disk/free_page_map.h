@@ -0,0 +1,93 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// free_page_map.h
+//
+// Identification: src/include/storage/disk/free_page_map.h
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>  // NOLINT
+#include <string>
+#include <vector>
+
+#include "common/config.h"
+
+namespace bustub {
+
+/**
+ * FreePageMap is a bitmap of the page ids that were deallocated and may be handed out again, one bit per page. It is
+ * kept in a file of its own next to the database file, as a plain array of 64-bit words.
+ */
+class FreePageMap {
+ public:
+  /**
+   * Mark a page as free. Freeing a free page has no effect.
+   * @param page_id id of the page
+   */
+  void Free(page_id_t page_id);
+
+  /**
+   * Take the lowest free page whose id lies in a stripe, so that buffer pool instances that stripe page ids over
+   * themselves each get back their own pages.
+   * @param min_page_id lowest id to consider
+   * @param residue the stripe, page_id % modulus == residue
+   * @param modulus number of stripes
+   * @return the id of the page, which is no longer free, or INVALID_PAGE_ID if the stripe has no free page
+   */
+  auto Take(page_id_t min_page_id, uint32_t residue, uint32_t modulus) -> page_id_t;
+
+  /** @return true if the page is free */
+  auto IsFree(page_id_t page_id) const -> bool;
+
+  /** @return the number of free pages */
+  auto GetNumFree() const -> size_t;
+
+  /**
+   * Replace the map with the one stored in a file. A missing file is an empty map.
+   * @param file_name the file
+   */
+  void Load(const std::string &file_name);
+
+  /**
+   * Store the map in a file and sync it, if it changed since it was last loaded or stored. The file is replaced
+   * atomically, so it always holds one complete map. The map is copied under the latch and written without it, so
+   * Free() and Take() do not wait for the disk.
+   * @param file_name the file
+   */
+  void Store(const std::string &file_name);
+
+ private:
+  static constexpr size_t BITS_PER_WORD = 64;
+
+  /** Where Take() starts looking for a stripe: no page of the stripe is free in the words before word_. */
+  struct StripeHint {
+    uint32_t residue_;
+    uint32_t modulus_;
+    size_t word_;
+  };
+
+  /** @return the hint of a stripe, starting one at the first word if there is none yet; needs latch_ */
+  auto GetHint(uint32_t residue, uint32_t modulus) -> size_t &;
+
+  /** Guards everything but the file. */
+  mutable std::mutex latch_;
+  /** Serializes Store(). Taken before latch_. */
+  std::mutex store_latch_;
+  std::vector<uint64_t> words_;
+  size_t num_free_{0};
+  /** One per stripe Take() was asked for; there are as few as there are buffer pool instances. */
+  std::vector<StripeHint> hints_;
+  /** Counts changes to words_; the map is dirty while it differs from the version in the file. */
+  uint64_t version_{0};
+  uint64_t stored_version_{0};
+};
+
+}  // namespace bustub
@@ -0,0 +1,126 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// log_segments.h
+//
+// Identification: src/include/storage/disk/log_segments.h
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>  // NOLINT
+#include <string>
+
+namespace bustub {
+
+/**
+ * LogSegments stores the log in segment files of a fixed size, <name>.000000, <name>.000001, ... Offsets into the
+ * log keep growing across segments: segment n holds the log from n * segment size on. The control file <name> holds
+ * the segment size and where the log starts.
+ *
+ * Truncate() drops the segments that lie completely before an offset, e.g. before the last checkpoint, so the log
+ * takes a bounded amount of space and recovery reads only what it needs. Dropped segments are kept as spares for the
+ * segments to come, up to MAX_SPARE_SEGMENTS of them, blocks and stale contents included. Every segment file is
+ * allocated to its full size when it is started, so appends neither allocate blocks nor grow the file.
+ *
+ * The file size therefore says nothing about where the log ends. Each segment file starts with two headers, each in
+ * a block of its own, that take turns recording how far the log in the segment goes and a checksum of it. The end of
+ * the log is at the newest header that is for this segment and whose checksum matches; a torn append leaves the
+ * previous header intact, and the headers of a spare are for the segment it used to be.
+ *
+ * Appends come from one thread at a time. Reads and Truncate() may run alongside them.
+ */
+class LogSegments {
+ public:
+  /** Segment size of a new log unless DiskManagerOptions say otherwise. */
+  static constexpr int64_t DEFAULT_SEGMENT_SIZE = 16 << 20;
+  /** Most dropped segments kept for reuse. */
+  static constexpr size_t MAX_SPARE_SEGMENTS = 2;
+  /** Bytes at the start of a segment file taken by its two headers. */
+  static constexpr int64_t SEGMENT_HEADER_SIZE = 8192;
+
+  /**
+   * Open a log, or start an empty one if there is no control file. Segments of an earlier log of the same name
+   * without a control file are removed.
+   * @param file_name name of the control file
+   * @param segment_size segment size of a new log; an existing log keeps its own
+   * @throw Exception if the control file cannot be written
+   */
+  LogSegments(std::string file_name, int64_t segment_size);
+
+  ~LogSegments() { Close(); }
+
+  /**
+   * Append to the end of the log, record the new end in the segment header and sync. A write that crosses into the
+   * next segment is synced segment by segment, so no segment ever holds data past a hole in the one before.
+   * @return false on an I/O error; the log then ends before the data
+   */
+  auto Append(const char *data, int size) -> bool;
+
+  /**
+   * Read from the log; the part past its end reads as zeroes.
+   * @return false if offset is past the end of the log or before its start
+   */
+  auto Read(char *data, int size, int64_t offset) -> bool;
+
+  /**
+   * Drop the segments that end at or before offset. The segment being appended to is always kept. The control file
+   * is written while appends go on.
+   * @param offset the oldest offset that will be read again
+   */
+  void Truncate(int64_t offset);
+
+  /** Close the segment being appended to; the next Append() opens it again. */
+  void Close();
+
+  /** @return offset of the first byte still in the log, at the start of a segment */
+  auto GetStart() const -> int64_t { return start_; }
+  /** @return offset where the next Append() lands */
+  auto GetEnd() const -> int64_t { return end_; }
+  auto GetSegmentSize() const -> int64_t { return segment_size_; }
+  /** @return the name of the file of a segment */
+  auto GetSegmentName(int64_t segment) const -> std::string;
+
+ private:
+  /** Where the log in a segment ends, and the header that says so. */
+  struct SegmentEnd {
+    int64_t size_{0};
+    int64_t sequence_{0};
+    uint32_t checksum_{0};
+  };
+
+  /** Write the control file and sync it, replacing the old one atomically. */
+  auto StoreControl(int64_t start) -> bool;
+  /** Open the segment for appending, creating it or reusing a spare; allocates its whole file. */
+  auto OpenForAppend(int64_t segment) -> bool;
+  /** Find the newest header of the segment file that is for the segment and whose checksum matches its data. */
+  auto ReadSegmentEnd(int fd, int64_t segment) -> SegmentEnd;
+  /** Write the header after the one the segment being appended to has, recording its log up to size. */
+  auto WriteSegmentHeader(int64_t size, uint32_t checksum) -> bool;
+  /** Remove every segment file of this log, or only those before a segment. */
+  void RemoveSegments(int64_t before_segment);
+
+  std::string file_name_;
+  int64_t segment_size_;
+  std::atomic<int64_t> start_{0};
+  std::atomic<int64_t> end_{0};
+
+  /** Guards the segment files: appending to a new one and dropping old ones. */
+  std::mutex latch_;
+  /** One Truncate() at a time; it writes the control file without holding latch_. */
+  std::mutex truncate_latch_;
+  /** The segment being appended to, its newest header and the checksum of its log. */
+  int append_fd_{-1};
+  int64_t append_segment_{-1};
+  int64_t append_sequence_{0};
+  uint32_t append_checksum_{0};
+};
+
+}  // namespace bustub
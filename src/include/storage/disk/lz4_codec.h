@@ -0,0 +1,48 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// lz4_codec.h
+//
+// Identification: src/include/storage/disk/lz4_codec.h
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace bustub {
+
+/**
+ * A small compressor for the LZ4 block format: one greedy pass with a hash table of earlier positions, no entropy
+ * coding. It trades ratio for speed, which is what page I/O needs. Its output can be read by any LZ4 block decoder
+ * and it reads any LZ4 block.
+ */
+class Lz4Codec {
+ public:
+  /**
+   * Compress a block.
+   * @param src the input
+   * @param size size of the input
+   * @param[out] dst output buffer
+   * @param capacity size of the output buffer
+   * @return size of the compressed block, or 0 if it does not fit into capacity bytes
+   */
+  static auto Compress(const char *src, size_t size, char *dst, size_t capacity) -> size_t;
+
+  /**
+   * Decompress a block.
+   * @param src the compressed block
+   * @param size size of the compressed block
+   * @param[out] dst output buffer
+   * @param capacity size of the output buffer
+   * @return size of the decompressed data, or -1 if the block is malformed or does not fit into capacity bytes
+   */
+  static auto Decompress(const char *src, size_t size, char *dst, size_t capacity) -> int64_t;
+};
+
+}  // namespace bustub
@@ -12,26 +12,50 @@
 
 #pragma once
 
+#include <atomic>
 #include <cstring>
 #include <iostream>
+#include <memory>
 
 #include "common/config.h"
 #include "common/rwlatch.h"
 
 namespace bustub {
 
+/** I/O state of the frame holding a page. Only the buffer pool manager changes it. */
+enum class FrameState : uint8_t {
+  /** The frame holds the page's current content. */
+  VALID,
+  /** The page is being read from disk into the frame; its content is not usable yet. */
+  READING,
+  /** The page is being written back to disk before eviction; its content is still readable. */
+  WRITING,
+};
+
+/** Size of a cache line, which the frame descriptors of a buffer pool are padded to. */
+static constexpr size_t CACHE_LINE_SIZE = 64;
+
 /**
  * Page is the basic unit of storage within the database system. Page provides a wrapper for actual data pages being
  * held in main memory. Page also contains book-keeping information that is used by the buffer pool manager, e.g.
  * pin count, dirty flag, page id, etc.
+ *
+ * In a buffer pool, a Page is the descriptor of a frame and its data lives in the pool's FrameArena. Descriptors are
+ * aligned to whole cache lines, so pinning or latching one frame does not invalidate its neighbours in other cores.
  */
-class Page {
+class alignas(CACHE_LINE_SIZE) Page {
   // There is book-keeping information inside the page that should only be relevant to the buffer pool manager.
   friend class BufferPoolManagerInstance;
 
  public:
-  /** Constructor. Zeros out the page data. */
-  Page() { ResetMemory(); }
+  /** Constructor for a page outside a buffer pool, which owns its data. Zeros out the page data. */
+  Page() : owned_data_(new char[PAGE_SIZE]), data_(owned_data_.get()) { ResetMemory(); }
+
+  /**
+   * Constructor for a frame of a buffer pool.
+   * @param data the frame's data, PAGE_SIZE bytes owned by the buffer pool
+   */
+  explicit Page(char *data) : data_(data) {}
 
   /** Default destructor. */
   ~Page() = default;
@@ -78,14 +102,23 @@ class Page {
   /** Zeroes out the data that is held within the page. */
   inline void ResetMemory() { memset(data_, OFFSET_PAGE_START, PAGE_SIZE); }
 
+  /** Data of a page created outside a buffer pool. */
+  std::unique_ptr<char[]> owned_data_;
   /** The actual data that is stored within a page. */
-  char data_[PAGE_SIZE]{};
+  char *data_;
   /** The ID of this page. */
   page_id_t page_id_ = INVALID_PAGE_ID;
-  /** The pin count of this page. */
-  int pin_count_ = 0;
+  /** The pin count of this page. Atomic so that cache hits can pin the frame without taking the buffer pool latch. */
+  std::atomic<int> pin_count_ = 0;
   /** True if the page is dirty, i.e. it is different from its corresponding page on disk. */
-  bool is_dirty_ = false;
+  std::atomic<bool> is_dirty_ = false;
+  /** In-flight I/O on this frame. A loader holds the page write latch for as long as the frame is READING. */
+  std::atomic<FrameState> state_ = FrameState::VALID;
+  /**
+   * Recovery LSN: no change below it is missing from the page on disk. The buffer pool sets it to the next LSN when
+   * the page comes in and whenever a clean, unpinned page is pinned again; guarded by the page table stripe latch.
+   */
+  lsn_t rec_lsn_ = INVALID_LSN;
   /** Page latch. */
   ReaderWriterLatch rwlatch_;
 };
@@ -0,0 +1,229 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// page_guard.h
+//
+// Identification: src/include/storage/page/page_guard.h
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <utility>
+
+#include "storage/page/page.h"
+
+namespace bustub {
+
+class BufferPoolManager;
+class ReadPageGuard;
+class WritePageGuard;
+
+/**
+ * BasicPageGuard keeps a page pinned for as long as it lives and unpins it when it is dropped or destroyed, passing
+ * on whether the page was modified through it. It does not latch the page. Guards are move-only; a guard that has
+ * been moved from or dropped, or that was returned for a page the buffer pool could not provide, is invalid.
+ *
+ * Unpinning goes straight to the frame the guard holds, so releasing a page never looks it up in the page table.
+ */
+class BasicPageGuard {
+ public:
+  BasicPageGuard() = default;
+
+  /**
+   * @param bpm the buffer pool manager the page was pinned in
+   * @param page the pinned page, or nullptr for an invalid guard
+   */
+  BasicPageGuard(BufferPoolManager *bpm, Page *page) : bpm_(bpm), page_(page) {}
+
+  BasicPageGuard(const BasicPageGuard &) = delete;
+  auto operator=(const BasicPageGuard &) -> BasicPageGuard & = delete;
+
+  BasicPageGuard(BasicPageGuard &&that) noexcept;
+  /** Drops the page this guard holds, then takes over the other guard's page. */
+  auto operator=(BasicPageGuard &&that) noexcept -> BasicPageGuard &;
+
+  ~BasicPageGuard() { Drop(); }
+
+  /** Unpin the page now, marking it dirty if it was modified through this guard. The guard becomes invalid. */
+  void Drop();
+
+  /**
+   * Latch the page for reading and hand it over to a ReadPageGuard. This guard becomes invalid.
+   * @return the read guard, invalid if this guard was
+   */
+  auto UpgradeRead() -> ReadPageGuard;
+
+  /**
+   * Latch the page for writing and hand it over to a WritePageGuard. This guard becomes invalid.
+   * @return the write guard, invalid if this guard was
+   */
+  auto UpgradeWrite() -> WritePageGuard;
+
+  /** @return true if the guard holds a page */
+  auto IsValid() const -> bool { return page_ != nullptr; }
+
+  /** @return the id of the guarded page */
+  auto PageId() const -> page_id_t { return page_->GetPageId(); }
+
+  /** @return the guarded page, e.g. to downcast it to a TablePage */
+  auto GetPage() const -> Page * { return page_; }
+
+  /** @return the content of the guarded page */
+  auto GetData() const -> const char * { return page_->GetData(); }
+
+  /** @return the content of the guarded page for modification; the page will be unpinned dirty */
+  auto GetDataMut() -> char * {
+    is_dirty_ = true;
+    return page_->GetData();
+  }
+
+  /**
+   * @return the content of the guarded page viewed as T. Modifications through it are only written back if the page
+   * is also marked dirty, so prefer AsMut() for those.
+   */
+  template <class T>
+  auto As() const -> T * {
+    return reinterpret_cast<T *>(page_->GetData());
+  }
+
+  /** @return the content of the guarded page viewed as T, for modification; the page will be unpinned dirty */
+  template <class T>
+  auto AsMut() -> T * {
+    is_dirty_ = true;
+    return reinterpret_cast<T *>(page_->GetData());
+  }
+
+  /** Mark the page as modified, e.g. after changing it through GetPage(). */
+  void SetDirty() { is_dirty_ = true; }
+
+ private:
+  friend class ReadPageGuard;
+  friend class WritePageGuard;
+
+  BufferPoolManager *bpm_{nullptr};
+  Page *page_{nullptr};
+  bool is_dirty_{false};
+};
+
+/**
+ * ReadPageGuard keeps a page pinned and read-latched. Dropping it releases the latch, then the pin.
+ */
+class ReadPageGuard {
+ public:
+  ReadPageGuard() = default;
+
+  /**
+   * @param bpm the buffer pool manager the page was pinned in
+   * @param page the pinned page, or nullptr for an invalid guard. The guard takes the read latch.
+   */
+  ReadPageGuard(BufferPoolManager *bpm, Page *page);
+
+  ReadPageGuard(const ReadPageGuard &) = delete;
+  auto operator=(const ReadPageGuard &) -> ReadPageGuard & = delete;
+
+  ReadPageGuard(ReadPageGuard &&that) noexcept = default;
+  /** Drops the page this guard holds, then takes over the other guard's page. */
+  auto operator=(ReadPageGuard &&that) noexcept -> ReadPageGuard &;
+
+  ~ReadPageGuard() { Drop(); }
+
+  /** Release the read latch and unpin the page now. The guard becomes invalid. */
+  void Drop();
+
+  /** @return true if the guard holds a page */
+  auto IsValid() const -> bool { return guard_.IsValid(); }
+
+  /** @return the id of the guarded page */
+  auto PageId() const -> page_id_t { return guard_.PageId(); }
+
+  /** @return the guarded page, e.g. to downcast it to a TablePage */
+  auto GetPage() const -> Page * { return guard_.GetPage(); }
+
+  /** @return the content of the guarded page */
+  auto GetData() const -> const char * { return guard_.GetData(); }
+
+  /** @return the content of the guarded page viewed as T */
+  template <class T>
+  auto As() const -> T * {
+    return guard_.As<T>();
+  }
+
+ private:
+  friend class BasicPageGuard;
+
+  /** Take over a guard whose page is already read-latched. */
+  explicit ReadPageGuard(BasicPageGuard &&guard) : guard_(std::move(guard)) {}
+
+  BasicPageGuard guard_;
+};
+
+/**
+ * WritePageGuard keeps a page pinned and write-latched. Dropping it releases the latch, then the pin, marking the
+ * page dirty if it was modified through the guard.
+ */
+class WritePageGuard {
+ public:
+  WritePageGuard() = default;
+
+  /**
+   * @param bpm the buffer pool manager the page was pinned in
+   * @param page the pinned page, or nullptr for an invalid guard. The guard takes the write latch.
+   */
+  WritePageGuard(BufferPoolManager *bpm, Page *page);
+
+  WritePageGuard(const WritePageGuard &) = delete;
+  auto operator=(const WritePageGuard &) -> WritePageGuard & = delete;
+
+  WritePageGuard(WritePageGuard &&that) noexcept = default;
+  /** Drops the page this guard holds, then takes over the other guard's page. */
+  auto operator=(WritePageGuard &&that) noexcept -> WritePageGuard &;
+
+  ~WritePageGuard() { Drop(); }
+
+  /** Release the write latch and unpin the page now. The guard becomes invalid. */
+  void Drop();
+
+  /** @return true if the guard holds a page */
+  auto IsValid() const -> bool { return guard_.IsValid(); }
+
+  /** @return the id of the guarded page */
+  auto PageId() const -> page_id_t { return guard_.PageId(); }
+
+  /** @return the guarded page, e.g. to downcast it to a TablePage */
+  auto GetPage() const -> Page * { return guard_.GetPage(); }
+
+  /** @return the content of the guarded page */
+  auto GetData() const -> const char * { return guard_.GetData(); }
+
+  /** @return the content of the guarded page for modification; the page will be unpinned dirty */
+  auto GetDataMut() -> char * { return guard_.GetDataMut(); }
+
+  /** @return the content of the guarded page viewed as T, without marking it dirty */
+  template <class T>
+  auto As() const -> T * {
+    return guard_.As<T>();
+  }
+
+  /** @return the content of the guarded page viewed as T, for modification; the page will be unpinned dirty */
+  template <class T>
+  auto AsMut() -> T * {
+    return guard_.AsMut<T>();
+  }
+
+  /** Mark the page as modified, e.g. after changing it through GetPage(). */
+  void SetDirty() { guard_.SetDirty(); }
+
+ private:
+  friend class BasicPageGuard;
+
+  /** Take over a guard whose page is already write-latched. */
+  explicit WritePageGuard(BasicPageGuard &&guard) : guard_(std::move(guard)) {}
+
+  BasicPageGuard guard_;
+};
+
+}  // namespace bustub
@@ -84,6 +84,14 @@ class TablePage : public Page {
   auto InsertTuple(const Tuple &tuple, RID *rid, Transaction *txn, LockManager *lock_manager, LogManager *log_manager)
       -> bool;
 
+  /**
+   * Put a tuple into a given slot, for recovery: redoing an insert, or undoing a delete. Nothing is logged or locked.
+   * @param tuple tuple to insert
+   * @param rid rid the tuple had; its slot has to be empty or past the last one
+   * @return true if the insert is successful (i.e. the slot is free and there is enough space)
+   */
+  auto InsertTupleAt(const Tuple &tuple, const RID &rid) -> bool;
+
   /**
    * Mark a tuple as deleted. This does not actually delete the tuple.
    * @param rid rid of the tuple to mark as deleted
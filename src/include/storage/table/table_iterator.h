@@ -13,7 +13,10 @@
 #pragma once
 
 #include <cassert>
+#include <memory>
+#include <utility>
 
+#include "buffer/buffer_access_strategy.h"
 #include "common/rid.h"
 #include "concurrency/transaction.h"
 #include "storage/table/tuple.h"
@@ -23,16 +26,30 @@ namespace bustub {
 class TableHeap;
 
 /**
- * TableIterator enables the sequential scan of a TableHeap.
+ * TableIterator enables the sequential scan of a TableHeap. An iterator created with a BufferAccessStrategy reads the
+ * pages it walks through that strategy; copies of the iterator share it.
+ *
+ * Once two page changes in a row move by the same page id stride, the iterator asks the buffer pool to prefetch the
+ * pages further along that stride, so that a cold scan does not wait for every page read in turn.
  */
 class TableIterator {
   friend class Cursor;
 
  public:
-  TableIterator(TableHeap *table_heap, RID rid, Transaction *txn);
+  /** How many pages ahead of the scan to prefetch, at most. */
+  static constexpr int READ_AHEAD_PAGES = 8;
+
+  TableIterator(TableHeap *table_heap, RID rid, Transaction *txn,
+                std::shared_ptr<BufferAccessStrategy> strategy = nullptr);
 
   TableIterator(const TableIterator &other)
-      : table_heap_(other.table_heap_), tuple_(new Tuple(*other.tuple_)), txn_(other.txn_) {}
+      : table_heap_(other.table_heap_),
+        tuple_(new Tuple(*other.tuple_)),
+        txn_(other.txn_),
+        strategy_(other.strategy_),
+        prefetch_strategy_(other.prefetch_strategy_),
+        stride_(other.stride_),
+        next_prefetch_page_id_(other.next_prefetch_page_id_) {}
 
   ~TableIterator() { delete tuple_; }
 
@@ -54,13 +71,33 @@ class TableIterator {
     table_heap_ = other.table_heap_;
     *tuple_ = *other.tuple_;
     txn_ = other.txn_;
+    strategy_ = other.strategy_;
+    prefetch_strategy_ = other.prefetch_strategy_;
+    stride_ = other.stride_;
+    next_prefetch_page_id_ = other.next_prefetch_page_id_;
     return *this;
   }
 
  private:
+  /**
+   * Called when the scan moves from one page to the next. Detects a constant stride and keeps READ_AHEAD_PAGES of the
+   * pages along it requested from the buffer pool.
+   */
+  void ReadAhead(page_id_t cur_page_id, page_id_t next_page_id);
+
   TableHeap *table_heap_;
   Tuple *tuple_;
   Transaction *txn_;
+  std::shared_ptr<BufferAccessStrategy> strategy_;
+  /**
+   * Ring that prefetched pages are read into when the scan has a strategy. The prefetch threads use it, so it has to
+   * be separate from the scan's own ring.
+   */
+  std::shared_ptr<BufferAccessStrategy> prefetch_strategy_;
+  /** Page id difference of the last page change, 0 before the first one. */
+  page_id_t stride_{0};
+  /** The next page along the stride that has not been requested yet. */
+  page_id_t next_prefetch_page_id_{INVALID_PAGE_ID};
 };
 
 }  // namespace bustub
@@ -12,7 +12,26 @@
 
 #include "recovery/log_manager.h"
 
+#include <cassert>
+#include <cstring>
+#include <utility>
+
 namespace bustub {
+
+namespace {
+constexpr int COUNT_SHIFT = 40;
+constexpr int GEN_SHIFT = 56;
+constexpr uint64_t SIZE_MASK = (uint64_t{1} << COUNT_SHIFT) - 1;
+constexpr uint64_t GEN_MASK = ~((uint64_t{1} << GEN_SHIFT) - 1);
+// A record takes at least its 20 byte header. Appenders that overflow a sealed buffer still add to its count, but
+// at most once per thread, so half of the count bits are left for them.
+static_assert(LOG_BUFFER_SIZE / 20 < (1 << 15), "the record count of a log buffer needs more bits");
+
+auto SizeOf(uint64_t reservation) -> int64_t { return reservation & SIZE_MASK; }
+auto CountOf(uint64_t reservation) -> int32_t { return (reservation >> COUNT_SHIFT) & 0xffff; }
+auto GenOf(uint64_t reservation) -> uint32_t { return reservation >> GEN_SHIFT; }
+}  // namespace
+
 /*
  * set enable_logging = true
  * Start a separate thread to execute flush to disk operation periodically
@@ -22,33 +41,266 @@ namespace bustub {
  *
  * This thread runs forever until system shutdown/StopFlushThread
  */
-void LogManager::RunFlushThread() {}
+void LogManager::RunFlushThread() {
+  std::lock_guard<std::mutex> lock(latch_);
+  if (flush_thread_ != nullptr) {
+    return;
+  }
+  running_ = true;
+  enable_logging = true;
+  flush_thread_ = new std::thread([this] {
+    std::unique_lock<std::mutex> lock(latch_);
+    while (running_) {
+      cv_.wait_for(lock, log_timeout, [this] { return !running_ || flush_requested_; });
+      flush_requested_ = false;
+      lock.unlock();
+      FlushBuffer();
+      lock.lock();
+    }
+    // Whatever is left in the buffer still goes out.
+    lock.unlock();
+    FlushBuffer();
+  });
+}
 
 /*
  * Stop and join the flush thread, set enable_logging = false
  */
-void LogManager::StopFlushThread() {}
+void LogManager::StopFlushThread() {
+  std::thread *flush_thread;
+  {
+    std::lock_guard<std::mutex> lock(latch_);
+    running_ = false;
+    flush_thread = flush_thread_;
+    flush_thread_ = nullptr;
+  }
+  enable_logging = false;
+  if (flush_thread != nullptr) {
+    cv_.notify_one();
+    flush_thread->join();
+    delete flush_thread;
+  }
+}
 
 /*
  * append a log record into log buffer
  * you MUST set the log record's lsn within this method
  * @return: lsn that is assigned to this log record
- *
- *
- * example below
- * // First, serialize the must have fields(20 bytes in total)
- * log_record.lsn_ = next_lsn_++;
- * memcpy(log_buffer_ + offset_, &log_record, 20);
- * int pos = offset_ + 20;
- *
- * if (log_record.log_record_type_ == LogRecordType::INSERT) {
- *    memcpy(log_buffer_ + pos, &log_record.insert_rid_, sizeof(RID));
- *    pos += sizeof(RID);
- *    // we have provided serialize function for tuple class
- *    log_record.insert_tuple_.SerializeTo(log_buffer_ + pos);
- *  }
- *
  */
-auto LogManager::AppendLogRecord(LogRecord *log_record) -> lsn_t { return INVALID_LSN; }
+auto LogManager::AppendLogRecord(LogRecord *log_record) -> lsn_t {
+  assert(log_record->size_ <= LOG_BUFFER_SIZE);
+  int32_t size = log_record->size_;
+  while (true) {
+    // The room and the LSN come with the same fetch-add, so LSNs follow the order of the records in the log.
+    uint64_t reservation = reservation_.fetch_add((uint64_t{1} << COUNT_SHIFT) + size);
+    LogBuffer &buffer = buffers_[GenOf(reservation) % 2];
+    int64_t offset = SizeOf(reservation);
+    if (offset + size <= LOG_BUFFER_SIZE) {
+      lsn_t lsn = buffer.base_lsn_ + CountOf(reservation);
+      log_record->lsn_ = lsn;
+      SerializeLogRecord(log_record, buffer.data_ + offset);
+      lsn_t next_lsn = next_lsn_;
+      while (next_lsn <= lsn && !next_lsn_.compare_exchange_weak(next_lsn, lsn + 1)) {
+      }
+      buffer.filled_ += size;
+      return lsn;
+    }
+    // Only the first record that does not fit sees the buffer unsealed; the records before it make up the buffer.
+    if (offset <= LOG_BUFFER_SIZE) {
+      buffer.sealed_ = static_cast<int64_t>(reservation & ~GEN_MASK);
+    }
+    WaitForRoom(GenOf(reservation), size);
+  }
+}
+
+void LogManager::SerializeLogRecord(LogRecord *log_record, char *pos) {
+  // First, serialize the must have fields(20 bytes in total)
+  memcpy(pos, log_record, LogRecord::HEADER_SIZE);
+  pos += LogRecord::HEADER_SIZE;
+  LogRecordType body_type = log_record->log_record_type_;
+  if (body_type == LogRecordType::CLR) {
+    // The compensating change follows like the body of a record of its type.
+    memcpy(pos, &log_record->undo_next_lsn_, sizeof(lsn_t));
+    memcpy(pos + sizeof(lsn_t), &log_record->compensating_type_, sizeof(LogRecordType));
+    pos += sizeof(lsn_t) + sizeof(LogRecordType);
+    body_type = log_record->compensating_type_;
+  }
+  switch (body_type) {
+    case LogRecordType::INSERT:
+      memcpy(pos, &log_record->insert_rid_, sizeof(RID));
+      log_record->insert_tuple_.SerializeTo(pos + sizeof(RID));
+      break;
+    case LogRecordType::MARKDELETE:
+    case LogRecordType::APPLYDELETE:
+    case LogRecordType::ROLLBACKDELETE:
+      memcpy(pos, &log_record->delete_rid_, sizeof(RID));
+      log_record->delete_tuple_.SerializeTo(pos + sizeof(RID));
+      break;
+    case LogRecordType::UPDATE:
+      memcpy(pos, &log_record->update_rid_, sizeof(RID));
+      pos += sizeof(RID);
+      log_record->old_tuple_.SerializeTo(pos);
+      pos += sizeof(int32_t) + log_record->old_tuple_.GetLength();
+      log_record->new_tuple_.SerializeTo(pos);
+      break;
+    case LogRecordType::NEWPAGE:
+      memcpy(pos, &log_record->prev_page_id_, sizeof(page_id_t));
+      memcpy(pos + sizeof(page_id_t), &log_record->page_id_, sizeof(page_id_t));
+      break;
+    case LogRecordType::END_CHECKPOINT: {
+      memcpy(pos, &log_record->scan_offset_, sizeof(int64_t));
+      memcpy(pos + sizeof(int64_t), &log_record->redo_offset_, sizeof(int64_t));
+      pos += 2 * sizeof(int64_t);
+      auto txn_count = static_cast<int32_t>(log_record->active_txns_.size());
+      memcpy(pos, &txn_count, sizeof(int32_t));
+      pos += sizeof(int32_t);
+      for (const auto &[txn_id, last_lsn] : log_record->active_txns_) {
+        memcpy(pos, &txn_id, sizeof(txn_id_t));
+        memcpy(pos + sizeof(txn_id_t), &last_lsn, sizeof(lsn_t));
+        pos += sizeof(txn_id_t) + sizeof(lsn_t);
+      }
+      auto page_count = static_cast<int32_t>(log_record->dirty_pages_.size());
+      memcpy(pos, &page_count, sizeof(int32_t));
+      pos += sizeof(int32_t);
+      for (const auto &[page_id, rec_lsn] : log_record->dirty_pages_) {
+        memcpy(pos, &page_id, sizeof(page_id_t));
+        memcpy(pos + sizeof(page_id_t), &rec_lsn, sizeof(lsn_t));
+        pos += sizeof(page_id_t) + sizeof(lsn_t);
+      }
+      break;
+    }
+    default:
+      // BEGIN, COMMIT, ABORT and BEGIN_CHECKPOINT are all header.
+      break;
+  }
+}
+
+void LogManager::WaitForRoom(uint32_t gen, int32_t size) {
+  std::unique_lock<std::mutex> lock(latch_);
+  if (!running_) {
+    lock.unlock();
+    FlushBuffer();
+    return;
+  }
+  flush_requested_ = true;
+  cv_.notify_one();
+  flushed_cv_.wait(lock, [&] {
+    uint64_t reservation = reservation_;
+    return GenOf(reservation) != gen || SizeOf(reservation) + size <= LOG_BUFFER_SIZE;
+  });
+}
+
+auto LogManager::Flush(lsn_t lsn) -> bool {
+  std::unique_lock<std::mutex> lock(latch_);
+  // Nothing past the last record can become persistent.
+  lsn = std::min<lsn_t>(lsn, next_lsn_ - 1);
+  while (persistent_lsn_ < lsn) {
+    if (write_failed_) {
+      return false;
+    }
+    if (running_) {
+      // Whoever else asks before the flush thread gets to it is served by the same write.
+      flush_requested_ = true;
+      cv_.notify_one();
+      flushed_cv_.wait(lock);
+    } else {
+      lock.unlock();
+      FlushBuffer();
+      lock.lock();
+    }
+  }
+  return true;
+}
+
+void LogManager::SetNextLSN(lsn_t lsn, lsn_t oldest_lsn, int64_t oldest_offset) {
+  std::lock_guard<std::mutex> flush_lock(flush_latch_);
+  std::lock_guard<std::mutex> lock(latch_);
+  assert(SizeOf(reservation_) == 0);
+  LogBuffer &buffer = buffers_[GenOf(reservation_) % 2];
+  buffer.base_lsn_ = lsn;
+  buffer.file_offset_ = disk_manager_ != nullptr ? disk_manager_->GetLogFileSize() : 0;
+  written_buffers_.clear();
+  if (oldest_lsn < lsn) {
+    written_buffers_.emplace_back(oldest_lsn, oldest_offset);
+  }
+  written_buffers_.emplace_back(lsn, buffer.file_offset_);
+  next_lsn_ = lsn;
+  persistent_lsn_ = lsn - 1;
+}
+
+void LogManager::FlushBuffer() {
+  std::lock_guard<std::mutex> flush_lock(flush_latch_);
+  // Only FlushBuffer() changes the generation, so the active buffer stays the same from here on.
+  uint64_t reservation = reservation_;
+  uint32_t gen = GenOf(reservation);
+  LogBuffer &buffer = buffers_[gen % 2];
+  if (SizeOf(reservation) == 0) {
+    return;
+  }
+  if (SizeOf(reservation) <= LOG_BUFFER_SIZE) {
+    reservation = reservation_.fetch_add(LOG_BUFFER_SIZE + 1);
+  }
+  uint64_t sealed = reservation & ~GEN_MASK;
+  if (SizeOf(reservation) > LOG_BUFFER_SIZE) {
+    // An appender sealed the buffer; it publishes the size right after its fetch-add.
+    int64_t published;
+    while ((published = buffer.sealed_) < 0) {
+      std::this_thread::yield();
+    }
+    sealed = published;
+  }
+  int64_t size = SizeOf(sealed);
+  int32_t count = CountOf(sealed);
+
+  // Records that got their room before the seal may still be being copied in; they take no locks, so this is short.
+  while (buffer.filled_ < size) {
+    std::this_thread::yield();
+  }
+
+  // The other buffer was written out by the previous call.
+  LogBuffer &next = buffers_[(gen + 1) % 2];
+  next.base_lsn_ = buffer.base_lsn_ + count;
+  next.file_offset_ = buffer.file_offset_ + size;
+  written_buffers_.emplace_back(next.base_lsn_, next.file_offset_);
+  next.filled_ = 0;
+  next.sealed_ = -1;
+  {
+    std::lock_guard<std::mutex> lock(latch_);
+    reservation_ = static_cast<uint64_t>((gen + 1) & 0xff) << GEN_SHIFT;
+  }
+  flushed_cv_.notify_all();
+
+  // Only FlushBuffer() sets write_failed_, so flush_latch_ is enough to read it.
+  bool written = !write_failed_ && disk_manager_->WriteLog(buffer.data_, size);
+  {
+    std::lock_guard<std::mutex> lock(latch_);
+    if (written) {
+      persistent_lsn_ = buffer.base_lsn_ + count - 1;
+    } else {
+      write_failed_ = true;
+    }
+  }
+  flushed_cv_.notify_all();
+}
+
+auto LogManager::GetLogBuffer() -> char * { return buffers_[GenOf(reservation_) % 2].data_; }
+
+auto LogManager::GetLogOffset(lsn_t lsn) -> int64_t {
+  std::lock_guard<std::mutex> flush_lock(flush_latch_);
+  // The last entry is the active buffer, which gets all the LSNs from its base on.
+  auto iter = std::upper_bound(written_buffers_.begin(), written_buffers_.end(), lsn,
+                               [](lsn_t lsn, const std::pair<lsn_t, int64_t> &entry) { return lsn < entry.first; });
+  if (iter != written_buffers_.begin()) {
+    --iter;
+  }
+  return iter->second;
+}
+
+void LogManager::TrimLogOffsets(lsn_t lsn) {
+  std::lock_guard<std::mutex> flush_lock(flush_latch_);
+  while (written_buffers_.size() > 1 && written_buffers_[1].first <= lsn) {
+    written_buffers_.pop_front();
+  }
+}
 
 }  // namespace bustub
@@ -12,7 +12,13 @@
 
 #include "recovery/log_recovery.h"
 
-#include "storage/page/table_page.h"
+#include <cstring>
+#include <queue>
+#include <string>
+#include <thread>  // NOLINT
+#include <utility>
+
+#include "common/exception.h"
 
 namespace bustub {
 /*
@@ -20,7 +26,188 @@ namespace bustub {
  * @return: true means deserialize succeed, otherwise can't deserialize cause
  * incomplete log record
  */
-auto LogRecovery::DeserializeLogRecord(const char *data, LogRecord *log_record) -> bool { return false; }
+auto LogRecovery::DeserializeLogRecord(const char *data, int64_t size, LogRecord *log_record) -> bool {
+  if (size < LogRecord::HEADER_SIZE) {
+    return false;
+  }
+  int32_t record_size;
+  memcpy(&record_size, data, sizeof(int32_t));
+  // The log ends with a record that was cut off, or with the zeroes past the end of the file.
+  if (record_size < LogRecord::HEADER_SIZE || record_size > size) {
+    return false;
+  }
+  LogRecord record;
+  record.size_ = record_size;
+  memcpy(&record.lsn_, data + 4, sizeof(lsn_t));
+  memcpy(&record.txn_id_, data + 8, sizeof(txn_id_t));
+  memcpy(&record.prev_lsn_, data + 12, sizeof(lsn_t));
+  memcpy(&record.log_record_type_, data + 16, sizeof(LogRecordType));
+
+  const char *pos = data + LogRecord::HEADER_SIZE;
+  const char *end = data + record_size;
+  LogRecordType body_type = record.log_record_type_;
+  if (body_type == LogRecordType::CLR) {
+    if (end - pos < static_cast<int64_t>(sizeof(lsn_t) + sizeof(LogRecordType))) {
+      return false;
+    }
+    memcpy(&record.undo_next_lsn_, pos, sizeof(lsn_t));
+    memcpy(&record.compensating_type_, pos + sizeof(lsn_t), sizeof(LogRecordType));
+    pos += sizeof(lsn_t) + sizeof(LogRecordType);
+    body_type = record.compensating_type_;
+    if (body_type < LogRecordType::INSERT || body_type > LogRecordType::UPDATE) {
+      return false;
+    }
+  }
+  // A tuple is stored as its size and its data, and has to end within the record.
+  auto read_tuple = [&](Tuple *tuple) {
+    int32_t tuple_size;
+    if (end - pos < static_cast<int64_t>(sizeof(int32_t))) {
+      return false;
+    }
+    memcpy(&tuple_size, pos, sizeof(int32_t));
+    if (tuple_size < 0 || end - pos - static_cast<int64_t>(sizeof(int32_t)) < tuple_size) {
+      return false;
+    }
+    tuple->DeserializeFrom(pos);
+    pos += sizeof(int32_t) + tuple_size;
+    return true;
+  };
+  switch (body_type) {
+    case LogRecordType::INSERT:
+      if (end - pos < static_cast<int64_t>(sizeof(RID))) {
+        return false;
+      }
+      memcpy(&record.insert_rid_, pos, sizeof(RID));
+      pos += sizeof(RID);
+      if (!read_tuple(&record.insert_tuple_)) {
+        return false;
+      }
+      break;
+    case LogRecordType::MARKDELETE:
+    case LogRecordType::APPLYDELETE:
+    case LogRecordType::ROLLBACKDELETE:
+      if (end - pos < static_cast<int64_t>(sizeof(RID))) {
+        return false;
+      }
+      memcpy(&record.delete_rid_, pos, sizeof(RID));
+      pos += sizeof(RID);
+      if (!read_tuple(&record.delete_tuple_)) {
+        return false;
+      }
+      break;
+    case LogRecordType::UPDATE:
+      if (end - pos < static_cast<int64_t>(sizeof(RID))) {
+        return false;
+      }
+      memcpy(&record.update_rid_, pos, sizeof(RID));
+      pos += sizeof(RID);
+      if (!read_tuple(&record.old_tuple_) || !read_tuple(&record.new_tuple_)) {
+        return false;
+      }
+      break;
+    case LogRecordType::NEWPAGE:
+      if (end - pos < static_cast<int64_t>(2 * sizeof(page_id_t))) {
+        return false;
+      }
+      memcpy(&record.prev_page_id_, pos, sizeof(page_id_t));
+      memcpy(&record.page_id_, pos + sizeof(page_id_t), sizeof(page_id_t));
+      break;
+    case LogRecordType::END_CHECKPOINT: {
+      int32_t count;
+      if (end - pos < static_cast<int64_t>(2 * sizeof(int64_t) + sizeof(int32_t))) {
+        return false;
+      }
+      memcpy(&record.scan_offset_, pos, sizeof(int64_t));
+      memcpy(&record.redo_offset_, pos + sizeof(int64_t), sizeof(int64_t));
+      pos += 2 * sizeof(int64_t);
+      memcpy(&count, pos, sizeof(int32_t));
+      pos += sizeof(int32_t);
+      if (count < 0 || end - pos < static_cast<int64_t>(count * (sizeof(txn_id_t) + sizeof(lsn_t)) + sizeof(int32_t))) {
+        return false;
+      }
+      record.active_txns_.resize(count);
+      for (auto &[txn_id, last_lsn] : record.active_txns_) {
+        memcpy(&txn_id, pos, sizeof(txn_id_t));
+        memcpy(&last_lsn, pos + sizeof(txn_id_t), sizeof(lsn_t));
+        pos += sizeof(txn_id_t) + sizeof(lsn_t);
+      }
+      memcpy(&count, pos, sizeof(int32_t));
+      pos += sizeof(int32_t);
+      if (count < 0 || end - pos < static_cast<int64_t>(count * (sizeof(page_id_t) + sizeof(lsn_t)))) {
+        return false;
+      }
+      record.dirty_pages_.resize(count);
+      for (auto &[page_id, rec_lsn] : record.dirty_pages_) {
+        memcpy(&page_id, pos, sizeof(page_id_t));
+        memcpy(&rec_lsn, pos + sizeof(page_id_t), sizeof(lsn_t));
+        pos += sizeof(page_id_t) + sizeof(lsn_t);
+      }
+      break;
+    }
+    case LogRecordType::BEGIN:
+    case LogRecordType::COMMIT:
+    case LogRecordType::ABORT:
+    case LogRecordType::BEGIN_CHECKPOINT:
+      break;
+    default:
+      return false;
+  }
+  *log_record = std::move(record);
+  return true;
+}
+
+auto LogRecovery::ReadCheckpoint(int64_t offset) -> bool {
+  int64_t end = disk_manager_->GetLogFileSize();
+  int64_t begin_offset = -1;
+  while (offset < end) {
+    auto size = static_cast<int>(std::min<int64_t>(REDO_READ_SIZE, end - offset));
+    if (!disk_manager_->ReadLog(log_buffer_, size, offset)) {
+      return false;
+    }
+    int pos = 0;
+    LogRecord record;
+    while (DeserializeLogRecord(log_buffer_ + pos, size - pos, &record)) {
+      if (record.log_record_type_ == LogRecordType::BEGIN_CHECKPOINT) {
+        begin_offset = offset + pos;
+      } else if (record.log_record_type_ == LogRecordType::END_CHECKPOINT && begin_offset >= 0) {
+        checkpoint_offset_ = begin_offset;
+        scan_offset_ = record.scan_offset_;
+        redo_offset_ = record.redo_offset_;
+        for (const auto &[txn_id, last_lsn] : record.active_txns_) {
+          if (last_lsn != INVALID_LSN) {
+            active_txn_[txn_id] = last_lsn;
+          }
+        }
+        for (const auto &[page_id, rec_lsn] : record.dirty_pages_) {
+          auto iter = dirty_pages_.find(page_id);
+          if (iter == dirty_pages_.end() || rec_lsn < iter->second) {
+            dirty_pages_[page_id] = rec_lsn;
+          }
+        }
+        return true;
+      }
+      pos += record.size_;
+    }
+    if (pos == 0) {
+      return false;
+    }
+    offset += pos;
+  }
+  return false;
+}
+
+auto LogRecovery::NeedsRedo(page_id_t page_id, lsn_t lsn, int64_t offset) -> bool {
+  if (offset >= checkpoint_offset_) {
+    return true;
+  }
+  // Before the checkpoint, only the pages in its dirty page table can miss a change, and only from their recovery
+  // LSN on.
+  if (offset < redo_offset_) {
+    return false;
+  }
+  auto iter = dirty_pages_.find(page_id);
+  return iter != dirty_pages_.end() && lsn >= iter->second;
+}
 
 /*
  *redo phase on TABLE PAGE level(table/table_page.h)
@@ -29,12 +216,314 @@ auto LogRecovery::DeserializeLogRecord(const char *data, LogRecord *log_record)
  *LSN with log_record's sequence number, and also build active_txn_ table &
  *lsn_mapping_ table
  */
-void LogRecovery::Redo() {}
+void LogRecovery::Redo() {
+  std::vector<std::unique_ptr<RedoQueue>> queues;
+  std::vector<std::thread> workers;
+  for (size_t i = 0; i < num_redo_threads_; ++i) {
+    queues.emplace_back(std::make_unique<RedoQueue>());
+    workers.emplace_back(&LogRecovery::RedoLoop, this, queues.back().get());
+  }
+  auto worker_of = [this](page_id_t page_id) { return static_cast<size_t>(page_id) % num_redo_threads_; };
+
+  // With a checkpoint, the log before it is only read as far back as the checkpoint says.
+  // Without one, it is read from its oldest segment on.
+  offset_ = disk_manager_->GetLogStartOffset();
+  int64_t master_record = disk_manager_->ReadMasterRecord();
+  if (master_record >= 0 && ReadCheckpoint(master_record)) {
+    offset_ = std::max(offset_, scan_offset_);
+  }
+
+  int64_t end = disk_manager_->GetLogFileSize();
+  while (offset_ < end) {
+    // Every read starts at a record; one that does not fit completely is read again by the next one.
+    auto size = static_cast<int>(std::min<int64_t>(REDO_READ_SIZE, end - offset_));
+    if (!disk_manager_->ReadLog(log_buffer_, size, offset_)) {
+      break;
+    }
+    std::vector<std::vector<RedoItem>> batches(num_redo_threads_);
+    int pos = 0;
+    LogRecord record;
+    int64_t record_offset;
+    auto dispatch = [&](page_id_t page_id) {
+      if (NeedsRedo(page_id, record.lsn_, record_offset)) {
+        batches[worker_of(page_id)].push_back({page_id, record});
+      }
+    };
+    while (DeserializeLogRecord(log_buffer_ + pos, size - pos, &record)) {
+      record_offset = offset_ + pos;
+      lsn_mapping_[record.lsn_] = record_offset;
+      next_lsn_ = std::max(next_lsn_, record.lsn_ + 1);
+      if (first_lsn_ == INVALID_LSN) {
+        first_lsn_ = record.lsn_;
+        first_offset_ = record_offset;
+      }
+      pos += record.size_;
+      switch (record.log_record_type_) {
+        case LogRecordType::COMMIT:
+        case LogRecordType::ABORT:
+          active_txn_.erase(record.txn_id_);
+          continue;
+        case LogRecordType::BEGIN:
+          active_txn_[record.txn_id_] = record.lsn_;
+          continue;
+        case LogRecordType::BEGIN_CHECKPOINT:
+        case LogRecordType::END_CHECKPOINT:
+          continue;
+        case LogRecordType::NEWPAGE:
+          // The previous page of the table gets linked to the new one.
+          if (record.prev_page_id_ != INVALID_PAGE_ID) {
+            dispatch(record.prev_page_id_);
+          }
+          dispatch(record.page_id_);
+          break;
+        default:
+          dispatch(ChangedPage(record));
+          break;
+      }
+      active_txn_[record.txn_id_] = record.lsn_;
+    }
+    // Nothing complete left: the log ends in a torn record.
+    if (pos == 0) {
+      break;
+    }
+    offset_ += pos;
+
+    for (size_t i = 0; i < num_redo_threads_; ++i) {
+      if (batches[i].empty()) {
+        continue;
+      }
+      RedoQueue *queue = queues[i].get();
+      std::unique_lock<std::mutex> lock(queue->latch_);
+      queue->cv_.wait(lock, [queue] { return queue->batches_.size() < REDO_MAX_QUEUED_BATCHES; });
+      queue->batches_.push_back(std::move(batches[i]));
+      queue->cv_.notify_all();
+    }
+  }
+
+  for (auto &queue : queues) {
+    std::lock_guard<std::mutex> lock(queue->latch_);
+    queue->done_ = true;
+    queue->cv_.notify_all();
+  }
+  for (auto &worker : workers) {
+    worker.join();
+  }
+  for (auto &queue : queues) {
+    if (queue->error_ != nullptr) {
+      std::rethrow_exception(queue->error_);
+    }
+  }
+
+  // New records have to come after the old ones, in LSNs as in the log; otherwise the page LSNs would hide them.
+  // The pages redo changed got recovery LSNs from before that, so a checkpoint sends the next recovery back to
+  // where this one started reading.
+  if (log_manager_ != nullptr) {
+    if (first_lsn_ == INVALID_LSN) {
+      log_manager_->SetNextLSN(next_lsn_, next_lsn_, offset_);
+    } else {
+      log_manager_->SetNextLSN(next_lsn_, first_lsn_, first_offset_);
+    }
+  }
+}
+
+void LogRecovery::RedoLoop(RedoQueue *queue) {
+  while (true) {
+    std::vector<RedoItem> batch;
+    {
+      std::unique_lock<std::mutex> lock(queue->latch_);
+      queue->cv_.wait(lock, [queue] { return queue->done_ || !queue->batches_.empty(); });
+      if (queue->batches_.empty()) {
+        return;
+      }
+      batch = std::move(queue->batches_.front());
+      queue->batches_.pop_front();
+      // The reader may be waiting for room.
+      queue->cv_.notify_all();
+    }
+    // Only this worker sets error_, and Redo() reads it after joining it.
+    if (queue->error_ != nullptr) {
+      continue;
+    }
+    try {
+      for (const auto &item : batch) {
+        RedoRecord(item);
+      }
+    } catch (...) {
+      queue->error_ = std::current_exception();
+    }
+  }
+}
+
+void LogRecovery::RedoRecord(const RedoItem &item) {
+  WritePageGuard guard = buffer_pool_manager_->FetchPageWrite(item.page_id_);
+  if (!guard.IsValid()) {
+    throw Exception("no frame to redo a log record in");
+  }
+  auto *table_page = static_cast<TablePage *>(guard.GetPage());
+  const LogRecord &record = item.record_;
+  if (record.log_record_type_ == LogRecordType::NEWPAGE && item.page_id_ != record.page_id_) {
+    // The link from the previous page is not logged on its own, and setting it again does no harm.
+    if (table_page->GetNextPageId() != record.page_id_) {
+      table_page->SetNextPageId(record.page_id_);
+      guard.SetDirty();
+    }
+  } else if (table_page->GetLSN() < record.lsn_) {
+    if (record.log_record_type_ == LogRecordType::NEWPAGE) {
+      table_page->Init(record.page_id_, PAGE_SIZE, record.prev_page_id_, nullptr, nullptr);
+    } else {
+      ApplyChange(table_page, record);
+    }
+    table_page->SetLSN(record.lsn_);
+    guard.SetDirty();
+  }
+}
+
+auto LogRecovery::ChangedPage(const LogRecord &log_record) -> page_id_t {
+  LogRecordType type = log_record.log_record_type_ == LogRecordType::CLR ? log_record.compensating_type_
+                                                                          : log_record.log_record_type_;
+  switch (type) {
+    case LogRecordType::INSERT:
+      return log_record.insert_rid_.GetPageId();
+    case LogRecordType::UPDATE:
+      return log_record.update_rid_.GetPageId();
+    case LogRecordType::MARKDELETE:
+    case LogRecordType::APPLYDELETE:
+    case LogRecordType::ROLLBACKDELETE:
+      return log_record.delete_rid_.GetPageId();
+    default:
+      return INVALID_PAGE_ID;
+  }
+}
+
+void LogRecovery::ApplyChange(TablePage *table_page, const LogRecord &log_record) {
+  LogRecordType type = log_record.log_record_type_ == LogRecordType::CLR ? log_record.compensating_type_
+                                                                          : log_record.log_record_type_;
+  Tuple old_tuple;
+  bool applied = true;
+  switch (type) {
+    case LogRecordType::INSERT:
+      // The tuple goes back where it was: later records, and the indexes, refer to it by its RID.
+      applied = table_page->InsertTupleAt(log_record.insert_tuple_, log_record.insert_rid_);
+      break;
+    case LogRecordType::MARKDELETE:
+      applied = table_page->MarkDelete(log_record.delete_rid_, nullptr, nullptr, nullptr);
+      break;
+    case LogRecordType::APPLYDELETE:
+      table_page->ApplyDelete(log_record.delete_rid_, nullptr, nullptr);
+      break;
+    case LogRecordType::ROLLBACKDELETE:
+      table_page->RollbackDelete(log_record.delete_rid_, nullptr, nullptr);
+      break;
+    case LogRecordType::UPDATE:
+      applied = table_page->UpdateTuple(log_record.new_tuple_, &old_tuple, log_record.update_rid_, nullptr, nullptr,
+                                        nullptr);
+      break;
+    default:
+      break;
+  }
+  if (!applied) {
+    throw Exception("can't apply " + log_record.ToString());
+  }
+}
+
+void LogRecovery::ReadRecord(lsn_t lsn, LogRecord *log_record) {
+  auto iter = lsn_mapping_.find(lsn);
+  int32_t size;
+  if (iter == lsn_mapping_.end() ||
+      !disk_manager_->ReadLog(reinterpret_cast<char *>(&size), sizeof(size), iter->second)) {
+    throw Exception("can't find log record " + std::to_string(lsn) + " to undo");
+  }
+  std::vector<char> data(size < LogRecord::HEADER_SIZE ? LogRecord::HEADER_SIZE : size);
+  if (!disk_manager_->ReadLog(data.data(), data.size(), iter->second) ||
+      !DeserializeLogRecord(data.data(), data.size(), log_record) || log_record->lsn_ != lsn) {
+    throw Exception("can't read log record " + std::to_string(lsn) + " to undo");
+  }
+}
 
 /*
  *undo phase on TABLE PAGE level(table/table_page.h)
  *iterate through active txn map and undo each operation
  */
-void LogRecovery::Undo() {}
+void LogRecovery::Undo() {
+  // The records of all the unfinished transactions, newest first.
+  std::priority_queue<std::pair<lsn_t, txn_id_t>> pending;
+  for (const auto &[txn_id, lsn] : active_txn_) {
+    pending.emplace(lsn, txn_id);
+  }
+  while (!pending.empty()) {
+    auto [lsn, txn_id] = pending.top();
+    pending.pop();
+    LogRecord record;
+    ReadRecord(lsn, &record);
+    lsn_t undo_next_lsn = record.prev_lsn_;
+    if (record.log_record_type_ == LogRecordType::CLR) {
+      // An earlier recovery got this far; redo has repeated its changes.
+      undo_next_lsn = record.undo_next_lsn_;
+    } else {
+      UndoRecord(&record);
+    }
+    if (undo_next_lsn != INVALID_LSN) {
+      pending.emplace(undo_next_lsn, txn_id);
+    } else if (log_manager_ != nullptr) {
+      // Rolled back completely; the next recovery can leave the transaction alone.
+      LogRecord abort_record(txn_id, active_txn_[txn_id], LogRecordType::ABORT);
+      log_manager_->AppendLogRecord(&abort_record);
+    }
+  }
+  if (log_manager_ != nullptr && !log_manager_->Flush(log_manager_->GetNextLSN() - 1)) {
+    throw Exception("can't write the log records of undo");
+  }
+  active_txn_.clear();
+  lsn_mapping_.clear();
+}
+
+void LogRecovery::UndoRecord(LogRecord *log_record) {
+  // The change that undoes the record, in a record of its own type.
+  txn_id_t txn_id = log_record->txn_id_;
+  LogRecord change;
+  switch (log_record->log_record_type_) {
+    case LogRecordType::INSERT:
+      change = LogRecord(txn_id, INVALID_LSN, LogRecordType::APPLYDELETE, log_record->insert_rid_,
+                         log_record->insert_tuple_);
+      break;
+    case LogRecordType::UPDATE:
+      change = LogRecord(txn_id, INVALID_LSN, LogRecordType::UPDATE, log_record->update_rid_, log_record->new_tuple_,
+                         log_record->old_tuple_);
+      break;
+    case LogRecordType::MARKDELETE:
+      change = LogRecord(txn_id, INVALID_LSN, LogRecordType::ROLLBACKDELETE, log_record->delete_rid_,
+                         log_record->delete_tuple_);
+      break;
+    case LogRecordType::APPLYDELETE:
+      change =
+          LogRecord(txn_id, INVALID_LSN, LogRecordType::INSERT, log_record->delete_rid_, log_record->delete_tuple_);
+      break;
+    case LogRecordType::ROLLBACKDELETE:
+      change = LogRecord(txn_id, INVALID_LSN, LogRecordType::MARKDELETE, log_record->delete_rid_,
+                         log_record->delete_tuple_);
+      break;
+    default:
+      // BEGIN has nothing to undo, and a new page stays, empty, in its table.
+      return;
+  }
+  page_id_t page_id = ChangedPage(change);
+  WritePageGuard guard = buffer_pool_manager_->FetchPageWrite(page_id);
+  if (!guard.IsValid()) {
+    throw Exception("no frame to undo a log record in");
+  }
+  auto *table_page = static_cast<TablePage *>(guard.GetPage());
+  lsn_t lsn = INVALID_LSN;
+  if (log_manager_ != nullptr) {
+    // The page gets the LSN of the CLR, so the buffer pool writes it only after the CLR.
+    LogRecord clr(txn_id, active_txn_[txn_id], log_record->prev_lsn_, change);
+    lsn = log_manager_->AppendLogRecord(&clr);
+    active_txn_[txn_id] = lsn;
+  }
+  ApplyChange(table_page, change);
+  if (lsn != INVALID_LSN) {
+    table_page->SetLSN(lsn);
+  }
+  guard.SetDirty();
+}
 
 }  // namespace bustub
@@ -0,0 +1,363 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// async_io.cpp
+//
+// Identification: src/storage/disk/async_io.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "storage/disk/async_io.h"
+
+#include <sys/mman.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>  // NOLINT
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#define BUSTUB_HAVE_IO_URING 1
+#endif
+
+#include "common/logger.h"
+
+namespace bustub {
+
+auto AsyncIO::Advance(AsyncIORequest *request, ssize_t result) -> bool {
+  if (result == -EINTR || result == -EAGAIN) {
+    return false;
+  }
+  if (result < 0) {
+    LOG_DEBUG("I/O error in asynchronous %s", request->is_write_ ? "write" : "read");
+    request->callback_(false);
+    return true;
+  }
+  if (result == 0) {
+    if (request->is_write_) {
+      LOG_DEBUG("I/O error in asynchronous write");
+      request->callback_(false);
+      return true;
+    }
+    // end of file
+    memset(request->data_ + request->done_, 0, request->size_ - request->done_);
+    request->done_ = request->size_;
+  }
+  request->done_ += result;
+  if (request->done_ < request->size_) {
+    return false;
+  }
+  request->callback_(true);
+  return true;
+}
+
+#ifdef BUSTUB_HAVE_IO_URING
+
+namespace {
+auto IoUringSetup(unsigned entries, io_uring_params *params) -> int {
+  return static_cast<int>(syscall(__NR_io_uring_setup, entries, params));
+}
+
+auto IoUringEnter(int ring_fd, unsigned to_submit, unsigned min_complete, unsigned flags) -> int {
+  return static_cast<int>(syscall(__NR_io_uring_enter, ring_fd, to_submit, min_complete, flags, nullptr, 0));
+}
+
+template <class T>
+auto RingField(void *ring, uint32_t offset) -> T * {
+  return reinterpret_cast<T *>(static_cast<char *>(ring) + offset);
+}
+}  // namespace
+
+IoUringIO::IoUringIO(size_t queue_depth) {
+  io_uring_params params;
+  memset(&params, 0, sizeof(params));
+  ring_fd_ = IoUringSetup(queue_depth, &params);
+  if (ring_fd_ < 0) {
+    return;
+  }
+  depth_ = params.sq_entries;
+  sq_ring_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+  cq_ring_size_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+  // Newer kernels map both rings with one call.
+  bool single_mmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+  if (single_mmap) {
+    sq_ring_size_ = std::max(sq_ring_size_, cq_ring_size_);
+    cq_ring_size_ = sq_ring_size_;
+  }
+  sq_ring_ = mmap(nullptr, sq_ring_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd_,
+                  IORING_OFF_SQ_RING);
+  cq_ring_ = single_mmap ? sq_ring_
+                         : mmap(nullptr, cq_ring_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd_,
+                                IORING_OFF_CQ_RING);
+  sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+  void *sqes = mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQES);
+  if (sq_ring_ == MAP_FAILED || cq_ring_ == MAP_FAILED || sqes == MAP_FAILED) {
+    LOG_DEBUG("can't map io_uring rings");
+    if (sq_ring_ != MAP_FAILED) {
+      munmap(sq_ring_, sq_ring_size_);
+    }
+    if (!single_mmap && cq_ring_ != MAP_FAILED) {
+      munmap(cq_ring_, cq_ring_size_);
+    }
+    if (sqes != MAP_FAILED) {
+      munmap(sqes, sqes_size_);
+    }
+    close(ring_fd_);
+    ring_fd_ = -1;
+    return;
+  }
+  sqes_ = static_cast<io_uring_sqe *>(sqes);
+  sq_tail_ = RingField<unsigned>(sq_ring_, params.sq_off.tail);
+  sq_mask_ = RingField<unsigned>(sq_ring_, params.sq_off.ring_mask);
+  sq_array_ = RingField<unsigned>(sq_ring_, params.sq_off.array);
+  cq_head_ = RingField<unsigned>(cq_ring_, params.cq_off.head);
+  cq_tail_ = RingField<unsigned>(cq_ring_, params.cq_off.tail);
+  cq_mask_ = RingField<unsigned>(cq_ring_, params.cq_off.ring_mask);
+  cqes_ = RingField<io_uring_cqe>(cq_ring_, params.cq_off.cqes);
+  completion_thread_ = std::thread(&IoUringIO::CompletionLoop, this);
+}
+
+IoUringIO::~IoUringIO() {
+  if (ring_fd_ < 0) {
+    return;
+  }
+  {
+    // Let everything in flight complete, then wake the completion thread with a request that has no owner.
+    std::unique_lock<std::mutex> lock(sq_latch_);
+    slot_cv_.wait(lock, [&] { return in_flight_ == 0; });
+    Push(nullptr);
+    Flush(&lock, false);
+  }
+  completion_thread_.join();
+  munmap(sqes_, sqes_size_);
+  if (cq_ring_ != sq_ring_) {
+    munmap(cq_ring_, cq_ring_size_);
+  }
+  munmap(sq_ring_, sq_ring_size_);
+  close(ring_fd_);
+}
+
+void IoUringIO::Submit(std::unique_ptr<AsyncIORequest> request) {
+  std::unique_lock<std::mutex> lock(sq_latch_);
+  slot_cv_.wait(lock, [&] { return in_flight_ < depth_; });
+  in_flight_++;
+  Push(request.release());
+  Flush(&lock, false);
+}
+
+void IoUringIO::Push(AsyncIORequest *request) {
+  // Only this class writes the tail, always under sq_latch_. Without SQPOLL the kernel consumes entries only within
+  // io_uring_enter(), and in_flight_ counts the entries not yet consumed as well, so the ring never overflows.
+  unsigned tail = *sq_tail_;
+  unsigned index = tail & *sq_mask_;
+  io_uring_sqe *sqe = &sqes_[index];
+  memset(sqe, 0, sizeof(*sqe));
+  if (request == nullptr) {
+    sqe->opcode = IORING_OP_NOP;
+  } else {
+    request->iov_.iov_base = request->data_ + request->done_;
+    request->iov_.iov_len = request->size_ - request->done_;
+    sqe->opcode = request->is_write_ ? IORING_OP_WRITEV : IORING_OP_READV;
+    sqe->fd = request->fd_;
+    sqe->off = request->offset_ + request->done_;
+    sqe->addr = reinterpret_cast<uint64_t>(&request->iov_);
+    sqe->len = 1;
+  }
+  sqe->user_data = reinterpret_cast<uint64_t>(request);
+  sq_array_[index] = index;
+  __atomic_store_n(sq_tail_, tail + 1, __ATOMIC_RELEASE);
+  unsubmitted_++;
+}
+
+auto IoUringIO::Flush(std::unique_lock<std::mutex> *lock, bool from_reaper) -> bool {
+  auto backoff = MIN_SUBMIT_BACKOFF;
+  while (unsubmitted_ > 0) {
+    int rc = IoUringEnter(ring_fd_, unsubmitted_, 0, 0);
+    if (rc > 0) {
+      unsubmitted_ -= rc;
+      backoff = MIN_SUBMIT_BACKOFF;
+      continue;
+    }
+    int error = rc == 0 ? EAGAIN : errno;
+    if (error == EINTR) {
+      continue;
+    }
+    if (error == EBUSY && from_reaper) {
+      // The completion ring is full and only the caller reaps it; the entries stay queued and go out on its next turn.
+      return true;
+    }
+    if (error == EAGAIN || error == EBUSY) {
+      // The kernel is short of memory or waits for the completion ring to be reaped. Give it time without holding
+      // the latch the completion thread needs.
+      lock->unlock();
+      std::this_thread::sleep_for(backoff);
+      backoff = std::min(backoff * 2, MAX_SUBMIT_BACKOFF);
+      lock->lock();
+      continue;
+    }
+    FailUnsubmitted(lock, error);
+    return false;
+  }
+  return true;
+}
+
+void IoUringIO::FailUnsubmitted(std::unique_lock<std::mutex> *lock, int error) {
+  LOG_DEBUG("io_uring_enter failed: %s", strerror(error));
+  // A failing io_uring_enter() consumed none of the entries, so they can be taken back out of the ring.
+  unsigned tail = *sq_tail_;
+  std::vector<AsyncIORequest *> failed;
+  for (unsigned i = tail - unsubmitted_; i != tail; ++i) {
+    auto *request = reinterpret_cast<AsyncIORequest *>(sqes_[sq_array_[i & *sq_mask_]].user_data);
+    if (request != nullptr) {
+      failed.push_back(request);
+    }
+  }
+  __atomic_store_n(sq_tail_, tail - unsubmitted_, __ATOMIC_RELEASE);
+  unsubmitted_ = 0;
+  ring_failed_ = true;
+  in_flight_ -= failed.size();
+  // The callbacks may submit again, so they run without the latch.
+  lock->unlock();
+  for (auto *request : failed) {
+    request->callback_(false);
+    delete request;
+  }
+  slot_cv_.notify_all();
+  lock->lock();
+}
+
+void IoUringIO::CompletionLoop() {
+  while (true) {
+    unsigned head = *cq_head_;
+    if (head == __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE)) {
+      {
+        // Entries held back by a full completion ring go out now that it has been reaped.
+        std::unique_lock<std::mutex> lock(sq_latch_);
+        Flush(&lock, true);
+      }
+      if (IoUringEnter(ring_fd_, 0, 1, IORING_ENTER_GETEVENTS) < 0 && errno != EINTR && errno != EAGAIN &&
+          errno != EBUSY) {
+        std::lock_guard<std::mutex> lock(sq_latch_);
+        if (ring_failed_) {
+          // The ring is unusable, so the shutdown request may never arrive either.
+          return;
+        }
+      }
+      continue;
+    }
+    io_uring_cqe *cqe = &cqes_[head & *cq_mask_];
+    auto *request = reinterpret_cast<AsyncIORequest *>(cqe->user_data);
+    ssize_t result = cqe->res;
+    __atomic_store_n(cq_head_, head + 1, __ATOMIC_RELEASE);
+    if (request == nullptr) {
+      return;
+    }
+    {
+      // The kernel completes a request only after Push() handed it over, and Push() runs under sq_latch_. Taking the
+      // latch makes the submitter's writes to the request visible here in terms of the C++ memory model as well.
+      std::lock_guard<std::mutex> lock(sq_latch_);
+    }
+    if (!Advance(request, result)) {
+      // The request keeps its slot for the rest of the transfer.
+      std::unique_lock<std::mutex> lock(sq_latch_);
+      Push(request);
+      Flush(&lock, true);
+      continue;
+    }
+    delete request;
+    {
+      std::lock_guard<std::mutex> lock(sq_latch_);
+      in_flight_--;
+    }
+    slot_cv_.notify_all();
+  }
+}
+
+#else
+
+IoUringIO::IoUringIO(size_t /*queue_depth*/) {}
+
+IoUringIO::~IoUringIO() = default;
+
+void IoUringIO::Submit(std::unique_ptr<AsyncIORequest> /*request*/) {
+  UNREACHABLE("io_uring is not available");
+}
+
+void IoUringIO::Push(AsyncIORequest * /*request*/) {}
+
+auto IoUringIO::Flush(std::unique_lock<std::mutex> * /*lock*/, bool /*from_reaper*/) -> bool { return false; }
+
+void IoUringIO::FailUnsubmitted(std::unique_lock<std::mutex> * /*lock*/, int /*error*/) {}
+
+void IoUringIO::CompletionLoop() {}
+
+#endif
+
+ThreadPoolIO::ThreadPoolIO(size_t num_threads) {
+  for (size_t i = 0; i < num_threads; ++i) {
+    workers_.emplace_back(&ThreadPoolIO::WorkerLoop, this);
+  }
+}
+
+ThreadPoolIO::~ThreadPoolIO() {
+  {
+    std::lock_guard<std::mutex> lock(latch_);
+    stop_ = true;
+  }
+  cv_.notify_all();
+  for (auto &worker : workers_) {
+    worker.join();
+  }
+}
+
+void ThreadPoolIO::Submit(std::unique_ptr<AsyncIORequest> request) {
+  {
+    std::lock_guard<std::mutex> lock(latch_);
+    queue_.push_back(std::move(request));
+  }
+  cv_.notify_one();
+}
+
+void ThreadPoolIO::WorkerLoop() {
+  while (true) {
+    std::unique_ptr<AsyncIORequest> request;
+    {
+      std::unique_lock<std::mutex> lock(latch_);
+      // Queued requests are still executed after stop_ is set.
+      cv_.wait(lock, [&] { return stop_ || !queue_.empty(); });
+      if (queue_.empty()) {
+        return;
+      }
+      request = std::move(queue_.front());
+      queue_.pop_front();
+    }
+    bool done = false;
+    while (!done) {
+      char *data = request->data_ + request->done_;
+      size_t size = request->size_ - request->done_;
+      off_t offset = request->offset_ + request->done_;
+      ssize_t rc =
+          request->is_write_ ? pwrite(request->fd_, data, size, offset) : pread(request->fd_, data, size, offset);
+      done = Advance(request.get(), rc < 0 ? -errno : rc);
+    }
+  }
+}
+
+auto MakeAsyncIO(size_t queue_depth, bool use_io_uring) -> std::unique_ptr<AsyncIO> {
+  if (use_io_uring) {
+    auto io_uring = std::make_unique<IoUringIO>(queue_depth);
+    if (io_uring->IsOpen()) {
+      return io_uring;
+    }
+    LOG_INFO("io_uring is not available, falling back to a thread pool");
+  }
+  return std::make_unique<ThreadPoolIO>(ASYNC_IO_FALLBACK_THREADS);
+}
+
+}  // namespace bustub
@@ -0,0 +1,261 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// compressed_page_store.cpp
+//
+// Identification: src/storage/disk/compressed_page_store.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "storage/disk/compressed_page_store.h"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iterator>
+
+#include "common/exception.h"
+#include "common/logger.h"
+#include "storage/disk/lz4_codec.h"
+
+namespace bustub {
+
+namespace {
+/** pread until done or the end of the file. @return bytes read, or -1 on an error */
+auto ReadFully(int fd, char *data, size_t size, off_t offset) -> ssize_t {
+  size_t read_count = 0;
+  while (read_count < size) {
+    ssize_t rc = pread(fd, data + read_count, size - read_count, offset + read_count);
+    if (rc < 0 && errno == EINTR) {
+      continue;
+    }
+    if (rc < 0) {
+      return -1;
+    }
+    if (rc == 0) {
+      break;
+    }
+    read_count += rc;
+  }
+  return read_count;
+}
+
+/** pwrite until done. @return false on an error */
+auto WriteFully(int fd, const char *data, size_t size, off_t offset) -> bool {
+  size_t written = 0;
+  while (written < size) {
+    ssize_t rc = pwrite(fd, data + written, size - written, offset + written);
+    if (rc < 0 && errno == EINTR) {
+      continue;
+    }
+    if (rc < 0) {
+      return false;
+    }
+    written += rc;
+  }
+  return true;
+}
+}  // namespace
+
+CompressedPageStore::CompressedPageStore(int db_fd, const std::string &map_file_name) : db_fd_(db_fd) {
+  map_fd_ = open(map_file_name.c_str(), O_RDWR | O_CREAT, 0644);
+  if (map_fd_ < 0) {
+    throw Exception("can't open page map file");
+  }
+  struct stat stat_buf;
+  if (fstat(map_fd_, &stat_buf) == 0) {
+    locations_.resize(stat_buf.st_size / sizeof(PageLocation));
+  }
+  size_t size = locations_.size() * sizeof(PageLocation);
+  if (ReadFully(map_fd_, reinterpret_cast<char *>(locations_.data()), size, 0) != static_cast<ssize_t>(size)) {
+    throw Exception("can't read page map file");
+  }
+
+  // Everything between the extents the map refers to is free.
+  std::vector<std::pair<uint64_t, size_t>> extents;
+  for (const auto &location : locations_) {
+    if (location.size_ != 0) {
+      extents.emplace_back(location.sector_, SectorsOf(location.size_));
+    }
+  }
+  std::sort(extents.begin(), extents.end());
+  for (const auto &[sector, sectors] : extents) {
+    if (sector > end_sector_) {
+      FreeExtent(end_sector_, sector - end_sector_);
+    }
+    end_sector_ = std::max(end_sector_, sector + sectors);
+  }
+}
+
+CompressedPageStore::~CompressedPageStore() { close(map_fd_); }
+
+auto CompressedPageStore::ReadPage(page_id_t page_id, char *page_data) -> size_t {
+  PageLocation location{};
+  {
+    std::lock_guard<std::mutex> lock(latch_);
+    if (page_id >= 0 && static_cast<size_t>(page_id) < locations_.size()) {
+      location = locations_[page_id];
+    }
+  }
+  if (location.size_ == 0) {
+    memset(page_data, 0, PAGE_SIZE);
+    return 0;
+  }
+  char buffer[PAGE_SIZE];
+  off_t offset = static_cast<off_t>(location.sector_ * SECTOR_SIZE);
+  if (ReadFully(db_fd_, buffer, location.size_, offset) != static_cast<ssize_t>(location.size_)) {
+    LOG_DEBUG("I/O error while reading compressed page");
+    memset(page_data, 0, PAGE_SIZE);
+    return 0;
+  }
+  if (location.size_ == PAGE_SIZE) {
+    memcpy(page_data, buffer, PAGE_SIZE);
+  } else if (Lz4Codec::Decompress(buffer, location.size_, page_data, PAGE_SIZE) != PAGE_SIZE) {
+    LOG_DEBUG("corrupt compressed page");
+    memset(page_data, 0, PAGE_SIZE);
+  }
+  return location.size_;
+}
+
+auto CompressedPageStore::WritePage(page_id_t page_id, const char *page_data) -> size_t {
+  // Whole sectors are written, the padding is zeroed.
+  char buffer[PAGE_SIZE];
+  size_t size = Lz4Codec::Compress(page_data, PAGE_SIZE, buffer, PAGE_SIZE - SECTOR_SIZE);
+  if (size == 0) {
+    // Saves not even a sector.
+    size = PAGE_SIZE;
+    memcpy(buffer, page_data, PAGE_SIZE);
+  }
+  size_t sectors = SectorsOf(size);
+  memset(buffer + size, 0, sectors * SECTOR_SIZE - size);
+
+  uint64_t sector;
+  {
+    std::lock_guard<std::mutex> lock(latch_);
+    sector = AllocateExtent(sectors);
+  }
+  if (!WriteFully(db_fd_, buffer, sectors * SECTOR_SIZE, static_cast<off_t>(sector * SECTOR_SIZE))) {
+    LOG_DEBUG("I/O error while writing compressed page");
+    std::lock_guard<std::mutex> lock(latch_);
+    FreeExtent(sector, sectors);
+    return 0;
+  }
+  std::lock_guard<std::mutex> lock(latch_);
+  SetLocation(page_id, {sector, static_cast<uint32_t>(size), 0});
+  return sectors * SECTOR_SIZE;
+}
+
+void CompressedPageStore::DeallocatePage(page_id_t page_id) {
+  std::lock_guard<std::mutex> lock(latch_);
+  if (page_id >= 0 && static_cast<size_t>(page_id) < locations_.size() && locations_[page_id].size_ != 0) {
+    SetLocation(page_id, {0, 0, 0});
+  }
+}
+
+void CompressedPageStore::Sync() {
+  std::lock_guard<std::mutex> sync_lock(sync_latch_);
+  std::vector<std::pair<size_t, std::vector<PageLocation>>> blocks;
+  std::vector<std::pair<uint64_t, size_t>> retired;
+  {
+    std::lock_guard<std::mutex> lock(latch_);
+    for (size_t block : dirty_blocks_) {
+      size_t begin = block * LOCATIONS_PER_BLOCK;
+      size_t end = std::min(begin + LOCATIONS_PER_BLOCK, locations_.size());
+      blocks.emplace_back(block, std::vector<PageLocation>(locations_.begin() + begin, locations_.begin() + end));
+    }
+    dirty_blocks_.clear();
+    retired.swap(retired_extents_);
+  }
+
+  // The new extents must be durable before the map points at them...
+  bool ok = fdatasync(db_fd_) == 0;
+  // ...and a block of the map is written as a whole sector, so every entry is either old or new after a crash.
+  for (const auto &[block, locations] : blocks) {
+    ok = ok && WriteFully(map_fd_, reinterpret_cast<const char *>(locations.data()),
+                          locations.size() * sizeof(PageLocation), block * SECTOR_SIZE);
+  }
+  ok = ok && fdatasync(map_fd_) == 0;
+
+  std::lock_guard<std::mutex> lock(latch_);
+  if (!ok) {
+    LOG_DEBUG("I/O error while syncing compressed pages");
+    for (const auto &block : blocks) {
+      dirty_blocks_.insert(block.first);
+    }
+    retired_extents_.insert(retired_extents_.end(), retired.begin(), retired.end());
+    return;
+  }
+  for (const auto &[sector, sectors] : retired) {
+    FreeExtent(sector, sectors);
+  }
+}
+
+auto CompressedPageStore::GetNumPages() -> page_id_t {
+  std::lock_guard<std::mutex> lock(latch_);
+  return static_cast<page_id_t>(locations_.size());
+}
+
+auto CompressedPageStore::AllocateExtent(size_t sectors) -> uint64_t {
+  // The smallest free extent that is large enough, or else the end of the file.
+  auto best = free_by_size_.lower_bound({sectors, 0});
+  if (best == free_by_size_.end()) {
+    uint64_t sector = end_sector_;
+    end_sector_ += sectors;
+    return sector;
+  }
+  auto [length, sector] = *best;
+  free_by_size_.erase(best);
+  free_by_sector_.erase(sector);
+  if (length > sectors) {
+    free_by_sector_.emplace(sector + sectors, length - sectors);
+    free_by_size_.emplace(length - sectors, sector + sectors);
+  }
+  return sector;
+}
+
+void CompressedPageStore::FreeExtent(uint64_t sector, size_t sectors) {
+  // Merge with the free extents right before and right after, so that the space freed by small pages can take a
+  // large one again.
+  auto next = free_by_sector_.lower_bound(sector);
+  if (next != free_by_sector_.begin()) {
+    auto prev = std::prev(next);
+    if (prev->first + prev->second == sector) {
+      sector = prev->first;
+      sectors += prev->second;
+      free_by_size_.erase({prev->second, prev->first});
+      free_by_sector_.erase(prev);
+    }
+  }
+  if (next != free_by_sector_.end() && sector + sectors == next->first) {
+    sectors += next->second;
+    free_by_size_.erase({next->second, next->first});
+    free_by_sector_.erase(next);
+  }
+  if (sector + sectors == end_sector_) {
+    // Free space at the end is simply where the file continues.
+    end_sector_ = sector;
+    return;
+  }
+  free_by_sector_.emplace(sector, sectors);
+  free_by_size_.emplace(sectors, sector);
+}
+
+void CompressedPageStore::SetLocation(page_id_t page_id, PageLocation location) {
+  if (static_cast<size_t>(page_id) >= locations_.size()) {
+    locations_.resize(page_id + 1, PageLocation{0, 0, 0});
+  }
+  PageLocation &old = locations_[page_id];
+  if (old.size_ != 0) {
+    retired_extents_.emplace_back(old.sector_, SectorsOf(old.size_));
+  }
+  old = location;
+  dirty_blocks_.insert(page_id / LOCATIONS_PER_BLOCK);
+}
+
+}  // namespace bustub
@@ -10,16 +10,24 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include <fcntl.h>
 #include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
 #include <cassert>
+#include <cerrno>
+#include <cstdio>
 #include <cstring>
 #include <iostream>
+#include <memory>
 #include <mutex>  // NOLINT
 #include <string>
 #include <thread>  // NOLINT
+#include <utility>
 
 #include "common/exception.h"
 #include "common/logger.h"
+#include "common/util/file_util.h"
 #include "storage/disk/disk_manager.h"
 
 namespace bustub {
@@ -30,7 +38,7 @@ static char *buffer_used;
  * Constructor: open/create a single database file & log file
  * @input db_file: database file name
  */
-DiskManager::DiskManager(const std::string &db_file)
+DiskManager::DiskManager(const std::string &db_file, const DiskManagerOptions &options)
     : file_name_(db_file), num_flushes_(0), num_writes_(0), flush_log_(false), flush_log_f_(nullptr) {
   std::string::size_type n = file_name_.rfind('.');
   if (n == std::string::npos) {
@@ -38,94 +46,223 @@ DiskManager::DiskManager(const std::string &db_file)
     return;
   }
   log_name_ = file_name_.substr(0, n) + ".log";
+  free_page_map_name_ = file_name_.substr(0, n) + ".fpm";
+  page_map_name_ = file_name_.substr(0, n) + ".pmap";
+  master_record_name_ = file_name_.substr(0, n) + ".ckpt";
 
-  log_io_.open(log_name_, std::ios::binary | std::ios::in | std::ios::app | std::ios::out);
-  // directory or file does not exist
-  if (!log_io_.is_open()) {
-    log_io_.clear();
-    // create a new file
-    log_io_.open(log_name_, std::ios::binary | std::ios::trunc | std::ios::app | std::ios::out);
-    log_io_.close();
-    // reopen with original mode
-    log_io_.open(log_name_, std::ios::binary | std::ios::in | std::ios::app | std::ios::out);
-    if (!log_io_.is_open()) {
-      throw Exception("can't open dblog file");
-    }
+  // The log is only appended to, by one flusher at a time.
+  log_segments_ = std::make_unique<LogSegments>(log_name_, options.log_segment_size_);
+  struct stat stat_buf;
+
+  // Page I/O goes through a plain descriptor: pread/pwrite carry their own offset, so concurrent requests need no
+  // shared cursor and no latch.
+  db_fd_ = open(db_file.c_str(), O_RDWR | O_CREAT, 0644);
+  if (db_fd_ < 0) {
+    throw Exception("can't open db file");
+  }
+  if (fstat(db_fd_, &stat_buf) == 0) {
+    db_file_size_ = stat_buf.st_size;
+  }
+  // A map left behind by an earlier database of the same name must not hand out pages of a new, empty file.
+  if (db_file_size_ == 0) {
+    remove(free_page_map_name_.c_str());
+    remove(page_map_name_.c_str());
   }
+  // Nor may a checkpoint point into a new log. An empty db file is fine, its pages may all be in the log still.
+  if (log_segments_->GetEnd() == 0) {
+    remove(master_record_name_.c_str());
+  }
+  free_page_map_.Load(free_page_map_name_);
+  // A compressed db file is recognized by its page location map.
+  if (db_file_size_ == 0 ? options.compress_pages_ : GetFileSize(page_map_name_) >= 0) {
+    compressed_store_ = std::make_unique<CompressedPageStore>(db_fd_, page_map_name_);
+  }
+  buffer_used = nullptr;
+}
 
-  std::scoped_lock scoped_db_io_latch(db_io_latch_);
-  db_io_.open(db_file, std::ios::binary | std::ios::in | std::ios::out);
-  // directory or file does not exist
-  if (!db_io_.is_open()) {
-    db_io_.clear();
-    // create a new file
-    db_io_.open(db_file, std::ios::binary | std::ios::trunc | std::ios::out);
-    db_io_.close();
-    // reopen with original mode
-    db_io_.open(db_file, std::ios::binary | std::ios::in | std::ios::out);
-    if (!db_io_.is_open()) {
-      throw Exception("can't open db file");
+DiskManager::~DiskManager() {
+  // Let the requests in flight finish before their file goes away.
+  async_io_.reset();
+  int fd = db_fd_.exchange(-1);
+  if (fd >= 0) {
+    free_page_map_.Store(free_page_map_name_);
+    if (compressed_store_ != nullptr) {
+      compressed_store_->Sync();
     }
+    close(fd);
   }
-  buffer_used = nullptr;
 }
 
 /**
  * Close all file streams
  */
 void DiskManager::ShutDown() {
-  {
-    std::scoped_lock scoped_db_io_latch(db_io_latch_);
-    db_io_.close();
+  async_io_.reset();
+  int fd = db_fd_.exchange(-1);
+  if (fd >= 0) {
+    free_page_map_.Store(free_page_map_name_);
+    if (compressed_store_ != nullptr) {
+      compressed_store_->Sync();
+    }
+    fdatasync(fd);
+    close(fd);
+  }
+  if (log_segments_ != nullptr) {
+    log_segments_->Close();
   }
-  log_io_.close();
 }
 
 /**
  * Write the contents of the specified page into disk file
  */
-void DiskManager::WritePage(page_id_t page_id, const char *page_data) {
-  std::scoped_lock scoped_db_io_latch(db_io_latch_);
-  size_t offset = static_cast<size_t>(page_id) * PAGE_SIZE;
-  // set write cursor to offset
+void DiskManager::WritePage(page_id_t page_id, const char *page_data) { WritePages(page_id, page_data, 1); }
+
+/**
+ * Write a run of consecutive pages with a single positional write
+ */
+auto DiskManager::WritePages(page_id_t page_id, const char *pages_data, size_t num_pages) -> bool {
   num_writes_ += 1;
-  db_io_.seekp(offset);
-  db_io_.write(page_data, PAGE_SIZE);
-  // check for I/O error
-  if (db_io_.bad()) {
-    LOG_DEBUG("I/O error while writing");
-    return;
+  if (compressed_store_ != nullptr) {
+    // Each page is compressed on its own and lands wherever there is room.
+    for (size_t i = 0; i < num_pages; ++i) {
+      size_t written = compressed_store_->WritePage(page_id + i, pages_data + i * PAGE_SIZE);
+      if (written == 0) {
+        LOG_DEBUG("I/O error while writing");
+        return false;
+      }
+      bytes_written_ += written;
+    }
+    return true;
+  }
+  off_t offset = static_cast<off_t>(page_id) * PAGE_SIZE;
+  size_t size = num_pages * PAGE_SIZE;
+  // pwrite may write less than asked for; keep going until the whole run is out.
+  size_t written = 0;
+  while (written < size) {
+    ssize_t rc = pwrite(db_fd_, pages_data + written, size - written, offset + written);
+    if (rc < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      LOG_DEBUG("I/O error while writing");
+      return false;
+    }
+    written += rc;
   }
-  // needs to flush to keep disk file in sync
-  db_io_.flush();
+  bytes_written_ += written;
+  GrowDbFileSize(offset + written);
+  // No flush here: the write is in the page cache, Sync() makes it durable.
+  return true;
 }
 
 /**
  * Read the contents of the specified page into the given memory area
  */
-void DiskManager::ReadPage(page_id_t page_id, char *page_data) {
-  std::scoped_lock scoped_db_io_latch(db_io_latch_);
-  int offset = page_id * PAGE_SIZE;
-  // check if read beyond file length
-  if (offset > GetFileSize(file_name_)) {
-    LOG_DEBUG("I/O error reading past end of file");
-    // std::cerr << "I/O error while reading" << std::endl;
-  } else {
-    // set read cursor to offset
-    db_io_.seekp(offset);
-    db_io_.read(page_data, PAGE_SIZE);
-    if (db_io_.bad()) {
+void DiskManager::ReadPage(page_id_t page_id, char *page_data) { ReadPages(page_id, page_data, 1); }
+
+void DiskManager::ReadPages(page_id_t page_id, char *pages_data, size_t num_pages) {
+  if (compressed_store_ != nullptr) {
+    for (size_t i = 0; i < num_pages; ++i) {
+      bytes_read_ += compressed_store_->ReadPage(page_id + i, pages_data + i * PAGE_SIZE);
+    }
+    return;
+  }
+  off_t offset = static_cast<off_t>(page_id) * PAGE_SIZE;
+  size_t size = num_pages * PAGE_SIZE;
+  size_t read_count = 0;
+  while (read_count < size) {
+    ssize_t rc = pread(db_fd_, pages_data + read_count, size - read_count, offset + read_count);
+    if (rc < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
       LOG_DEBUG("I/O error while reading");
-      return;
+      break;
     }
-    // if file ends before reading PAGE_SIZE
-    int read_count = db_io_.gcount();
-    if (read_count < PAGE_SIZE) {
-      LOG_DEBUG("Read less than a page");
-      db_io_.clear();
-      // std::cerr << "Read less than a page" << std::endl;
-      memset(page_data + read_count, 0, PAGE_SIZE - read_count);
+    if (rc == 0) {
+      // end of file
+      break;
+    }
+    read_count += rc;
+  }
+  bytes_read_ += read_count;
+  // The run may reach past the end of the file.
+  if (read_count < size) {
+    memset(pages_data + read_count, 0, size - read_count);
+  }
+}
+
+void DiskManager::ReadPagesAsync(page_id_t page_id, char *pages_data, size_t num_pages,
+                                 std::function<void(bool)> callback) {
+  if (compressed_store_ != nullptr) {
+    ReadPages(page_id, pages_data, num_pages);
+    callback(true);
+    return;
+  }
+  SubmitPages(false, page_id, pages_data, num_pages, std::move(callback));
+  bytes_read_ += num_pages * PAGE_SIZE;
+}
+
+void DiskManager::WritePagesAsync(page_id_t page_id, const char *pages_data, size_t num_pages,
+                                  std::function<void(bool)> callback) {
+  if (compressed_store_ != nullptr) {
+    callback(WritePages(page_id, pages_data, num_pages));
+    return;
+  }
+  num_writes_ += 1;
+  int64_t end = static_cast<int64_t>(page_id + num_pages) * PAGE_SIZE;
+  auto grow = [this, end, num_pages, callback = std::move(callback)](bool ok) {
+    if (ok) {
+      bytes_written_ += num_pages * PAGE_SIZE;
+      GrowDbFileSize(end);
     }
+    callback(ok);
+  };
+  // The backend only reads from the buffer of a write.
+  SubmitPages(true, page_id, const_cast<char *>(pages_data), num_pages, std::move(grow));
+}
+
+auto DiskManager::ReadPagesAsync(page_id_t page_id, char *pages_data, size_t num_pages) -> std::future<bool> {
+  auto promise = std::make_shared<std::promise<bool>>();
+  ReadPagesAsync(page_id, pages_data, num_pages, [promise](bool ok) { promise->set_value(ok); });
+  return promise->get_future();
+}
+
+auto DiskManager::WritePagesAsync(page_id_t page_id, const char *pages_data, size_t num_pages) -> std::future<bool> {
+  auto promise = std::make_shared<std::promise<bool>>();
+  WritePagesAsync(page_id, pages_data, num_pages, [promise](bool ok) { promise->set_value(ok); });
+  return promise->get_future();
+}
+
+void DiskManager::SubmitPages(bool is_write, page_id_t page_id, char *pages_data, size_t num_pages,
+                              std::function<void(bool)> callback) {
+  auto request = std::make_unique<AsyncIORequest>();
+  request->is_write_ = is_write;
+  request->fd_ = db_fd_;
+  request->data_ = pages_data;
+  request->size_ = num_pages * PAGE_SIZE;
+  request->offset_ = static_cast<off_t>(page_id) * PAGE_SIZE;
+  request->callback_ = std::move(callback);
+  GetAsyncIO()->Submit(std::move(request));
+}
+
+auto DiskManager::GetAsyncIO() -> AsyncIO * {
+  // Most disk managers never issue an asynchronous request, so the rings or threads are set up on demand.
+  std::call_once(async_io_once_, [&] { async_io_ = MakeAsyncIO(ASYNC_IO_QUEUE_DEPTH); });
+  return async_io_.get();
+}
+
+/**
+ * Force the pages written so far to stable storage
+ */
+void DiskManager::Sync() {
+  free_page_map_.Store(free_page_map_name_);
+  if (compressed_store_ != nullptr) {
+    compressed_store_->Sync();
+    return;
+  }
+  if (fdatasync(db_fd_) != 0) {
+    LOG_DEBUG("I/O error while syncing db file");
   }
 }
 
@@ -133,13 +270,13 @@ void DiskManager::ReadPage(page_id_t page_id, char *page_data) {
  * Write the contents of the log into disk file
  * Only return when sync is done, and only perform sequence write
  */
-void DiskManager::WriteLog(char *log_data, int size) {
+auto DiskManager::WriteLog(char *log_data, int size) -> bool {
   // enforce swap log buffer
   assert(log_data != buffer_used);
   buffer_used = log_data;
 
   if (size == 0) {  // no effect on num_flushes_ if log buffer is empty
-    return;
+    return true;
   }
 
   flush_log_ = true;
@@ -150,47 +287,53 @@ void DiskManager::WriteLog(char *log_data, int size) {
   }
 
   num_flushes_ += 1;
-  // sequence write
-  log_io_.write(log_data, size);
-
-  // check for I/O error
-  if (log_io_.bad()) {
-    LOG_DEBUG("I/O error while writing log");
-    return;
+  // Sequential write. The records must survive a crash before anybody relies on them: one sync for the whole
+  // buffer, or one per segment if it crosses into the next one.
+  if (log_segments_ == nullptr || !log_segments_->Append(log_data, size)) {
+    return false;
   }
-  // needs to flush to keep disk file in sync
-  log_io_.flush();
   flush_log_ = false;
+  return true;
 }
 
 /**
  * Read the contents of the log into the given memory area
- * Always read from the beginning and perform sequence read
- * @return: false means already reach the end
+ * Reads may start anywhere from the start of the log on, and continue across segments
+ * @return: false means already reach the end, or the offset was truncated away
  */
-auto DiskManager::ReadLog(char *log_data, int size, int offset) -> bool {
-  if (offset >= GetFileSize(log_name_)) {
-    // LOG_DEBUG("end of log file");
-    // LOG_DEBUG("file size is %d", GetFileSize(log_name_));
-    return false;
+auto DiskManager::ReadLog(char *log_data, int size, int64_t offset) -> bool {
+  return log_segments_ != nullptr && log_segments_->Read(log_data, size, offset);
+}
+
+void DiskManager::TruncateLog(int64_t offset) {
+  if (log_segments_ != nullptr) {
+    log_segments_->Truncate(offset);
   }
-  log_io_.seekp(offset);
-  log_io_.read(log_data, size);
+}
 
-  if (log_io_.bad()) {
-    LOG_DEBUG("I/O error while reading log");
+auto DiskManager::WriteMasterRecord(int64_t offset) -> bool {
+  // Like the free page map, write a new file and rename it over the old one.
+  if (!FileUtil::ReplaceFile(master_record_name_, reinterpret_cast<const char *>(&offset), sizeof(offset))) {
+    LOG_DEBUG("I/O error while writing master record");
     return false;
   }
-  // if log file ends before reading "size"
-  int read_count = log_io_.gcount();
-  if (read_count < size) {
-    log_io_.clear();
-    memset(log_data + read_count, 0, size - read_count);
-  }
-
   return true;
 }
 
+auto DiskManager::ReadMasterRecord() -> int64_t {
+  int fd = open(master_record_name_.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return -1;
+  }
+  int64_t offset = -1;
+  ssize_t rc;
+  do {
+    rc = pread(fd, &offset, sizeof(offset), 0);
+  } while (rc < 0 && errno == EINTR);
+  close(fd);
+  return rc == static_cast<ssize_t>(sizeof(offset)) ? offset : -1;
+}
+
 /**
  * Returns number of flushes made so far
  */
@@ -206,13 +349,29 @@ auto DiskManager::GetNumWrites() const -> int { return num_writes_; }
  */
 auto DiskManager::GetFlushState() const -> bool { return flush_log_; }
 
+/**
+ * Returns number of pages in the database file
+ */
+auto DiskManager::GetNumPages() -> page_id_t {
+  if (compressed_store_ != nullptr) {
+    return compressed_store_->GetNumPages();
+  }
+  return db_file_size_.load() / PAGE_SIZE;
+}
+
 /**
  * Private helper function to get disk file size
  */
-auto DiskManager::GetFileSize(const std::string &file_name) -> int {
+auto DiskManager::GetFileSize(const std::string &file_name) -> int64_t {
   struct stat stat_buf;
   int rc = stat(file_name.c_str(), &stat_buf);
-  return rc == 0 ? static_cast<int>(stat_buf.st_size) : -1;
+  return rc == 0 ? static_cast<int64_t>(stat_buf.st_size) : -1;
+}
+
+void DiskManager::GrowDbFileSize(int64_t end) {
+  int64_t size = db_file_size_.load();
+  while (size < end && !db_file_size_.compare_exchange_weak(size, end)) {
+  }
 }
 
 }  // namespace bustub
@@ -0,0 +1,161 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// free_page_map.cpp
+//
+// Identification: src/storage/disk/free_page_map.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "storage/disk/free_page_map.h"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+
+#include "common/logger.h"
+#include "common/util/file_util.h"
+
+namespace bustub {
+
+void FreePageMap::Free(page_id_t page_id) {
+  std::lock_guard<std::mutex> lock(latch_);
+  size_t word = page_id / BITS_PER_WORD;
+  uint64_t bit = uint64_t{1} << (page_id % BITS_PER_WORD);
+  if (word >= words_.size()) {
+    words_.resize(word + 1, 0);
+  }
+  if ((words_[word] & bit) == 0) {
+    words_[word] |= bit;
+    num_free_++;
+    version_++;
+    for (auto &hint : hints_) {
+      if (static_cast<uint32_t>(page_id) % hint.modulus_ == hint.residue_) {
+        hint.word_ = std::min(hint.word_, word);
+      }
+    }
+  }
+}
+
+auto FreePageMap::Take(page_id_t min_page_id, uint32_t residue, uint32_t modulus) -> page_id_t {
+  std::lock_guard<std::mutex> lock(latch_);
+  if (num_free_ == 0) {
+    return INVALID_PAGE_ID;
+  }
+  // Nothing of the stripe is free below its hint. The hint only moves up if the search started there, as the words
+  // between it and min_page_id are not looked at otherwise.
+  size_t &hint = GetHint(residue, modulus);
+  size_t min_word = min_page_id / BITS_PER_WORD;
+  size_t start = std::max(min_word, hint);
+  // Skip the empty words at once; only the set bits of the others are looked at.
+  for (size_t word = start; word < words_.size(); ++word) {
+    uint64_t bits = words_[word];
+    if (word == min_word) {
+      bits &= ~uint64_t{0} << (min_page_id % BITS_PER_WORD);
+    }
+    while (bits != 0) {
+      auto page_id = static_cast<page_id_t>(word * BITS_PER_WORD + __builtin_ctzll(bits));
+      if (static_cast<uint32_t>(page_id) % modulus == residue) {
+        words_[word] &= ~(uint64_t{1} << (page_id % BITS_PER_WORD));
+        num_free_--;
+        version_++;
+        if (start == hint) {
+          hint = word;
+        }
+        return page_id;
+      }
+      bits &= bits - 1;
+    }
+  }
+  if (start == hint) {
+    hint = words_.size();
+  }
+  return INVALID_PAGE_ID;
+}
+
+auto FreePageMap::GetHint(uint32_t residue, uint32_t modulus) -> size_t & {
+  for (auto &hint : hints_) {
+    if (hint.residue_ == residue && hint.modulus_ == modulus) {
+      return hint.word_;
+    }
+  }
+  hints_.push_back({residue, modulus, 0});
+  return hints_.back().word_;
+}
+
+auto FreePageMap::IsFree(page_id_t page_id) const -> bool {
+  std::lock_guard<std::mutex> lock(latch_);
+  size_t word = page_id / BITS_PER_WORD;
+  return word < words_.size() && (words_[word] >> (page_id % BITS_PER_WORD) & 1) != 0;
+}
+
+auto FreePageMap::GetNumFree() const -> size_t {
+  std::lock_guard<std::mutex> lock(latch_);
+  return num_free_;
+}
+
+void FreePageMap::Load(const std::string &file_name) {
+  std::lock_guard<std::mutex> lock(latch_);
+  words_.clear();
+  hints_.clear();
+  num_free_ = 0;
+  stored_version_ = version_;
+  int fd = open(file_name.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return;
+  }
+  struct stat stat_buf;
+  if (fstat(fd, &stat_buf) == 0) {
+    words_.resize(stat_buf.st_size / sizeof(uint64_t));
+    auto *data = reinterpret_cast<char *>(words_.data());
+    size_t size = words_.size() * sizeof(uint64_t);
+    size_t read_count = 0;
+    while (read_count < size) {
+      ssize_t rc = pread(fd, data + read_count, size - read_count, read_count);
+      if (rc < 0 && errno == EINTR) {
+        continue;
+      }
+      if (rc <= 0) {
+        LOG_DEBUG("I/O error while reading free page map");
+        words_.clear();
+        break;
+      }
+      read_count += rc;
+    }
+  }
+  close(fd);
+  for (auto word : words_) {
+    num_free_ += __builtin_popcountll(word);
+  }
+}
+
+void FreePageMap::Store(const std::string &file_name) {
+  // One store at a time, so that a newer copy of the map is never overwritten by an older one.
+  std::lock_guard<std::mutex> store_lock(store_latch_);
+  std::vector<uint64_t> words;
+  uint64_t version;
+  {
+    std::lock_guard<std::mutex> lock(latch_);
+    if (version_ == stored_version_) {
+      return;
+    }
+    words = words_;
+    version = version_;
+  }
+  // The copy is written without latch_, so pages are freed and taken meanwhile. The file is replaced atomically, so a
+  // crash leaves either map behind but never half of one.
+  const auto *data = reinterpret_cast<const char *>(words.data());
+  if (!FileUtil::ReplaceFile(file_name, data, words.size() * sizeof(uint64_t))) {
+    LOG_DEBUG("I/O error while writing free page map");
+    return;
+  }
+  std::lock_guard<std::mutex> lock(latch_);
+  stored_version_ = version;
+}
+
+}  // namespace bustub
@@ -0,0 +1,382 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// log_segments.cpp
+//
+// Identification: src/storage/disk/log_segments.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "storage/disk/log_segments.h"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <cstddef>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <utility>
+#include <vector>
+
+#include "common/exception.h"
+#include "common/logger.h"
+#include "common/util/file_util.h"
+
+namespace bustub {
+
+namespace {
+auto WriteFully(int fd, const char *data, int64_t size, int64_t offset) -> bool {
+  int64_t written = 0;
+  while (written < size) {
+    ssize_t rc = pwrite(fd, data + written, size - written, offset + written);
+    if (rc < 0 && errno == EINTR) {
+      continue;
+    }
+    if (rc < 0) {
+      return false;
+    }
+    written += rc;
+  }
+  return true;
+}
+
+/** @return the number of bytes read, less at the end of the file, or -1 on an error */
+auto ReadFully(int fd, char *data, int64_t size, int64_t offset) -> int64_t {
+  int64_t read_count = 0;
+  while (read_count < size) {
+    ssize_t rc = pread(fd, data + read_count, size - read_count, offset + read_count);
+    if (rc < 0 && errno == EINTR) {
+      continue;
+    }
+    if (rc < 0) {
+      return -1;
+    }
+    if (rc == 0) {
+      break;
+    }
+    read_count += rc;
+  }
+  return read_count;
+}
+
+auto FileExists(const std::string &file_name) -> bool {
+  struct stat stat_buf;
+  return stat(file_name.c_str(), &stat_buf) == 0;
+}
+
+/** Extend a CRC-32 (the one of zlib) by data; the checksum of nothing is 0. */
+auto Crc32(uint32_t crc, const char *data, int64_t size) -> uint32_t {
+  static const std::array<uint32_t, 256> TABLE = [] {
+    std::array<uint32_t, 256> table{};
+    for (uint32_t i = 0; i < 256; i++) {
+      uint32_t c = i;
+      for (int k = 0; k < 8; k++) {
+        c = (c & 1) != 0 ? 0xEDB88320U ^ (c >> 1) : c >> 1;
+      }
+      table[i] = c;
+    }
+    return table;
+  }();
+  crc = ~crc;
+  for (int64_t i = 0; i < size; i++) {
+    crc = TABLE[(crc ^ static_cast<uint8_t>(data[i])) & 0xFF] ^ (crc >> 8);
+  }
+  return ~crc;
+}
+
+constexpr uint64_t SEGMENT_MAGIC = 0x42555354554C4F47;  // "BUSTULOG"
+constexpr int64_t SEGMENT_HEADER_BLOCK = LogSegments::SEGMENT_HEADER_SIZE / 2;
+
+/** One of the two headers of a segment file. */
+struct SegmentHeader {
+  uint64_t magic_;
+  int64_t segment_;
+  /** Which header is newer; header sequence % 2 is written next. */
+  int64_t sequence_;
+  /** Bytes of log in the segment. */
+  int64_t size_;
+  /** Of those bytes. */
+  uint32_t checksum_;
+  /** Of the fields above. */
+  uint32_t header_checksum_;
+};
+
+auto HeaderChecksum(const SegmentHeader &header) -> uint32_t {
+  return Crc32(0, reinterpret_cast<const char *>(&header), offsetof(SegmentHeader, header_checksum_));
+}
+}  // namespace
+
+LogSegments::LogSegments(std::string file_name, int64_t segment_size)
+    : file_name_(std::move(file_name)), segment_size_(segment_size) {
+  int64_t control[2];
+  bool has_control = false;
+  int fd = open(file_name_.c_str(), O_RDONLY);
+  if (fd >= 0) {
+    has_control = ReadFully(fd, reinterpret_cast<char *>(control), sizeof(control), 0) ==
+                      static_cast<int64_t>(sizeof(control)) &&
+                  control[0] > 0 && control[1] >= 0 && control[1] % control[0] == 0;
+    close(fd);
+  }
+  if (!has_control) {
+    // Segments without a control file are left over from a log that was removed.
+    RemoveSegments(INT64_MAX);
+    if (!StoreControl(0)) {
+      throw Exception("can't open dblog file");
+    }
+    return;
+  }
+  segment_size_ = control[0];
+  start_ = control[1];
+  // Truncate() may have been cut short after it moved the start.
+  RemoveSegments(start_ / segment_size_);
+  // The log goes on through full segments and ends in the first one that is not; what follows it are spares.
+  int64_t end = start_;
+  for (int64_t segment = start_ / segment_size_;; ++segment) {
+    int segment_fd = open(GetSegmentName(segment).c_str(), O_RDONLY);
+    if (segment_fd < 0) {
+      break;
+    }
+    SegmentEnd segment_end = ReadSegmentEnd(segment_fd, segment);
+    close(segment_fd);
+    end = segment * segment_size_ + segment_end.size_;
+    if (segment_end.size_ < segment_size_) {
+      break;
+    }
+  }
+  end_ = end;
+}
+
+auto LogSegments::Append(const char *data, int size) -> bool {
+  std::lock_guard<std::mutex> lock(latch_);
+  int64_t end = end_;
+  int written = 0;
+  while (written < size) {
+    int64_t segment = end / segment_size_;
+    int64_t pos = end % segment_size_;
+    if (segment != append_segment_ && !OpenForAppend(segment)) {
+      return false;
+    }
+    auto piece = static_cast<int>(std::min<int64_t>(size - written, segment_size_ - pos));
+    uint32_t checksum = Crc32(append_checksum_, data + written, piece);
+    if (!WriteFully(append_fd_, data + written, piece, SEGMENT_HEADER_SIZE + pos) ||
+        !WriteSegmentHeader(pos + piece, checksum) || fdatasync(append_fd_) != 0) {
+      LOG_DEBUG("I/O error while writing log");
+      // Opening the segment again finds out from its headers where it ends.
+      Close();
+      return false;
+    }
+    append_checksum_ = checksum;
+    written += piece;
+    end += piece;
+    end_ = end;
+  }
+  return true;
+}
+
+auto LogSegments::Read(char *data, int size, int64_t offset) -> bool {
+  int64_t end = end_;
+  if (offset >= end || offset < start_) {
+    return false;
+  }
+  int done = 0;
+  while (done < size) {
+    int64_t piece_offset = offset + done;
+    int64_t pos = piece_offset % segment_size_;
+    auto piece = static_cast<int>(std::min<int64_t>(size - done, segment_size_ - pos));
+    int64_t read_count = 0;
+    if (piece_offset < end) {
+      int fd = open(GetSegmentName(piece_offset / segment_size_).c_str(), O_RDONLY);
+      if (fd < 0) {
+        // Truncated meanwhile.
+        return false;
+      }
+      read_count =
+          ReadFully(fd, data + done, std::min<int64_t>(piece, end - piece_offset), SEGMENT_HEADER_SIZE + pos);
+      close(fd);
+      if (read_count < 0) {
+        LOG_DEBUG("I/O error while reading log");
+        return false;
+      }
+    }
+    memset(data + done + read_count, 0, piece - read_count);
+    done += piece;
+  }
+  return true;
+}
+
+void LogSegments::Truncate(int64_t offset) {
+  std::lock_guard<std::mutex> truncate_lock(truncate_latch_);
+  int64_t first = start_ / segment_size_;
+  int64_t new_first = std::min<int64_t>(offset, end_) / segment_size_;
+  if (new_first <= first) {
+    return;
+  }
+  // The start moves first. If the segments before it are not gone when the system crashes, opening the log removes
+  // them. Appends go on meanwhile; they only ever touch the segment the log ends in, which is kept.
+  if (!StoreControl(new_first * segment_size_)) {
+    return;
+  }
+
+  std::lock_guard<std::mutex> lock(latch_);
+  start_ = new_first * segment_size_;
+  if (append_segment_ < new_first) {
+    Close();
+  }
+  // Spares are numbered on from the segment the log continues in; the files from there on are spares already.
+  int64_t next_spare = (end_ + segment_size_ - 1) / segment_size_;
+  size_t num_spares = 0;
+  while (FileExists(GetSegmentName(next_spare))) {
+    next_spare++;
+    num_spares++;
+  }
+  for (int64_t segment = first; segment < new_first; ++segment) {
+    std::string name = GetSegmentName(segment);
+    // A spare keeps its blocks and its contents. Its headers are for the segment it was, so none of it is log under
+    // its new name until appends overwrite it.
+    if (num_spares < MAX_SPARE_SEGMENTS && rename(name.c_str(), GetSegmentName(next_spare).c_str()) == 0) {
+      next_spare++;
+      num_spares++;
+      continue;
+    }
+    remove(name.c_str());
+  }
+}
+
+void LogSegments::Close() {
+  if (append_fd_ >= 0) {
+    close(append_fd_);
+  }
+  append_fd_ = -1;
+  append_segment_ = -1;
+  append_sequence_ = 0;
+  append_checksum_ = 0;
+}
+
+auto LogSegments::GetSegmentName(int64_t segment) const -> std::string {
+  char suffix[32];
+  snprintf(suffix, sizeof(suffix), ".%06lld", static_cast<long long>(segment));  // NOLINT
+  return file_name_ + suffix;
+}
+
+auto LogSegments::StoreControl(int64_t start) -> bool {
+  // Like the free page map, write a new file and rename it over the old one.
+  int64_t control[2] = {segment_size_, start};
+  if (!FileUtil::ReplaceFile(file_name_, reinterpret_cast<const char *>(control), sizeof(control))) {
+    LOG_DEBUG("I/O error while writing log control file");
+    return false;
+  }
+  return true;
+}
+
+auto LogSegments::OpenForAppend(int64_t segment) -> bool {
+  Close();
+  int fd = open(GetSegmentName(segment).c_str(), O_RDWR | O_CREAT, 0644);
+  if (fd < 0) {
+    LOG_DEBUG("can't open log segment");
+    return false;
+  }
+  // Allocate the whole file up front, so appends only overwrite blocks that exist. A spare has them already.
+  if (posix_fallocate(fd, 0, SEGMENT_HEADER_SIZE + segment_size_) != 0) {
+    LOG_DEBUG("can't allocate log segment");
+    close(fd);
+    return false;
+  }
+  // The log may continue in a segment that has some of it already, e.g. after an earlier Append() failed.
+  SegmentEnd segment_end = ReadSegmentEnd(fd, segment);
+  if (segment * segment_size_ + segment_end.size_ != end_) {
+    LOG_DEBUG("log segment does not end where the log does");
+    close(fd);
+    return false;
+  }
+  append_fd_ = fd;
+  append_segment_ = segment;
+  append_sequence_ = segment_end.sequence_;
+  append_checksum_ = segment_end.checksum_;
+  return true;
+}
+
+auto LogSegments::ReadSegmentEnd(int fd, int64_t segment) -> SegmentEnd {
+  std::vector<SegmentHeader> headers;
+  for (int64_t slot = 0; slot < 2; slot++) {
+    SegmentHeader header;
+    if (ReadFully(fd, reinterpret_cast<char *>(&header), sizeof(header), slot * SEGMENT_HEADER_BLOCK) !=
+            static_cast<int64_t>(sizeof(header)) ||
+        header.magic_ != SEGMENT_MAGIC || header.header_checksum_ != HeaderChecksum(header) ||
+        header.segment_ != segment || header.size_ < 0 || header.size_ > segment_size_) {
+      continue;
+    }
+    headers.push_back(header);
+  }
+  std::sort(headers.begin(), headers.end(),
+            [](const SegmentHeader &a, const SegmentHeader &b) { return a.sequence_ > b.sequence_; });
+  // A torn append leaves the newer header pointing past data that did not make it; the older one still holds.
+  std::vector<char> buffer(std::min<int64_t>(segment_size_, 1 << 20));
+  for (const auto &header : headers) {
+    uint32_t checksum = 0;
+    int64_t done = 0;
+    while (done < header.size_) {
+      int64_t piece = std::min<int64_t>(header.size_ - done, buffer.size());
+      if (ReadFully(fd, buffer.data(), piece, SEGMENT_HEADER_SIZE + done) != piece) {
+        break;
+      }
+      checksum = Crc32(checksum, buffer.data(), piece);
+      done += piece;
+    }
+    if (done == header.size_ && checksum == header.checksum_) {
+      return {header.size_, header.sequence_, checksum};
+    }
+  }
+  return {};
+}
+
+auto LogSegments::WriteSegmentHeader(int64_t size, uint32_t checksum) -> bool {
+  SegmentHeader header;
+  memset(&header, 0, sizeof(header));
+  header.magic_ = SEGMENT_MAGIC;
+  header.segment_ = append_segment_;
+  header.sequence_ = append_sequence_ + 1;
+  header.size_ = size;
+  header.checksum_ = checksum;
+  header.header_checksum_ = HeaderChecksum(header);
+  // Never overwrite the newest header: until the sync, a crash may leave this one torn.
+  if (!WriteFully(append_fd_, reinterpret_cast<const char *>(&header), sizeof(header),
+                  (header.sequence_ % 2) * SEGMENT_HEADER_BLOCK)) {
+    return false;
+  }
+  append_sequence_ = header.sequence_;
+  return true;
+}
+
+void LogSegments::RemoveSegments(int64_t before_segment) {
+  std::filesystem::path path(file_name_);
+  std::filesystem::path dir = path.has_parent_path() ? path.parent_path() : std::filesystem::path(".");
+  std::string prefix = path.filename().string() + ".";
+  std::vector<std::filesystem::path> obsolete;
+  std::error_code ec;
+  for (const auto &entry : std::filesystem::directory_iterator(dir, ec)) {
+    std::string name = entry.path().filename().string();
+    if (name.size() <= prefix.size() || name.compare(0, prefix.size(), prefix) != 0) {
+      continue;
+    }
+    std::string number = name.substr(prefix.size());
+    if (number.size() > 18 || !std::all_of(number.begin(), number.end(), [](char c) { return isdigit(c) != 0; })) {
+      continue;
+    }
+    if (std::stoll(number) < before_segment) {
+      obsolete.push_back(entry.path());
+    }
+  }
+  for (const auto &file : obsolete) {
+    std::filesystem::remove(file, ec);
+  }
+}
+
+}  // namespace bustub
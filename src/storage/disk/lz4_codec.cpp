@@ -0,0 +1,194 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// lz4_codec.cpp
+//
+// Identification: src/storage/disk/lz4_codec.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "storage/disk/lz4_codec.h"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+
+namespace bustub {
+
+namespace {
+/** Matches are at least this long; the match length field stores the excess. */
+constexpr size_t MIN_MATCH = 4;
+/** The format requires the last bytes of a block to be literals... */
+constexpr size_t LAST_LITERALS = 5;
+/** ...and the last match to start at least this far from the end. */
+constexpr size_t MF_LIMIT = 12;
+/** Matches reach back at most this far, as the offset field has two bytes. */
+constexpr size_t MAX_OFFSET = 65535;
+/** The length fields of a token saturate at this value, longer lengths continue in extra bytes. */
+constexpr size_t RUN_MASK = 15;
+constexpr int HASH_LOG = 12;
+
+auto Read32(const char *p) -> uint32_t {
+  uint32_t value;
+  memcpy(&value, p, sizeof(value));
+  return value;
+}
+
+auto Hash(uint32_t sequence) -> uint32_t { return (sequence * 2654435761U) >> (32 - HASH_LOG); }
+
+/** @return the number of bytes a length takes beyond its token field */
+auto ExtraLengthBytes(size_t length) -> size_t { return length < RUN_MASK ? 0 : (length - RUN_MASK) / 255 + 1; }
+
+void WriteExtraLength(size_t length, char **op) {
+  if (length < RUN_MASK) {
+    return;
+  }
+  length -= RUN_MASK;
+  while (length >= 255) {
+    *(*op)++ = static_cast<char>(255);
+    length -= 255;
+  }
+  *(*op)++ = static_cast<char>(length);
+}
+
+/**
+ * Append a sequence: the literals from anchor, then a match of match_length bytes at offset back, if match_length
+ * is not 0.
+ * @return false if the output buffer is too small
+ */
+auto EmitSequence(const char *anchor, size_t literal_length, size_t offset, size_t match_length, char **op,
+                  const char *oend) -> bool {
+  size_t needed = 1 + ExtraLengthBytes(literal_length) + literal_length;
+  if (match_length > 0) {
+    needed += 2 + ExtraLengthBytes(match_length - MIN_MATCH);
+  }
+  if (needed > static_cast<size_t>(oend - *op)) {
+    return false;
+  }
+  char *token = (*op)++;
+  size_t literal_field = std::min(literal_length, RUN_MASK);
+  WriteExtraLength(literal_length, op);
+  memcpy(*op, anchor, literal_length);
+  *op += literal_length;
+  size_t match_field = 0;
+  if (match_length > 0) {
+    *(*op)++ = static_cast<char>(offset & 0xff);
+    *(*op)++ = static_cast<char>(offset >> 8);
+    match_field = std::min(match_length - MIN_MATCH, RUN_MASK);
+    WriteExtraLength(match_length - MIN_MATCH, op);
+  }
+  *token = static_cast<char>(literal_field << 4 | match_field);
+  return true;
+}
+
+/** Read the rest of a length whose token field saturated. @return false if the input ends first */
+auto ReadExtraLength(const unsigned char **ip, const unsigned char *iend, size_t *length) -> bool {
+  if (*length < RUN_MASK) {
+    return true;
+  }
+  while (true) {
+    if (*ip >= iend) {
+      return false;
+    }
+    unsigned char byte = *(*ip)++;
+    *length += byte;
+    if (byte != 255) {
+      return true;
+    }
+  }
+}
+}  // namespace
+
+auto Lz4Codec::Compress(const char *src, size_t size, char *dst, size_t capacity) -> size_t {
+  char *op = dst;
+  const char *oend = dst + capacity;
+  const char *anchor = src;
+  const char *iend = src + size;
+  if (size > MF_LIMIT) {
+    // Positions plus one, so that zero means empty.
+    std::array<uint32_t, 1 << HASH_LOG> table{};
+    const char *ip = src;
+    const char *mflimit = iend - MF_LIMIT;
+    const char *matchlimit = iend - LAST_LITERALS;
+    while (ip < mflimit) {
+      uint32_t sequence = Read32(ip);
+      uint32_t &slot = table[Hash(sequence)];
+      const char *match = slot == 0 ? nullptr : src + slot - 1;
+      slot = static_cast<uint32_t>(ip - src + 1);
+      if (match == nullptr || static_cast<size_t>(ip - match) > MAX_OFFSET || Read32(match) != sequence) {
+        ip++;
+        continue;
+      }
+      const char *match_end = ip + MIN_MATCH;
+      const char *ref = match + MIN_MATCH;
+      while (match_end < matchlimit && *match_end == *ref) {
+        match_end++;
+        ref++;
+      }
+      // The bytes before the match may match as well.
+      while (ip > anchor && match > src && ip[-1] == match[-1]) {
+        ip--;
+        match--;
+      }
+      if (!EmitSequence(anchor, ip - anchor, ip - match, match_end - ip, &op, oend)) {
+        return 0;
+      }
+      ip = match_end;
+      anchor = ip;
+    }
+  }
+  if (!EmitSequence(anchor, iend - anchor, 0, 0, &op, oend)) {
+    return 0;
+  }
+  return op - dst;
+}
+
+auto Lz4Codec::Decompress(const char *src, size_t size, char *dst, size_t capacity) -> int64_t {
+  const auto *ip = reinterpret_cast<const unsigned char *>(src);
+  const auto *iend = ip + size;
+  char *op = dst;
+  const char *oend = dst + capacity;
+  while (ip < iend) {
+    unsigned char token = *ip++;
+    size_t literal_length = token >> 4;
+    if (!ReadExtraLength(&ip, iend, &literal_length) || literal_length > static_cast<size_t>(iend - ip) ||
+        literal_length > static_cast<size_t>(oend - op)) {
+      return -1;
+    }
+    memcpy(op, ip, literal_length);
+    ip += literal_length;
+    op += literal_length;
+    // The last sequence has no match.
+    if (ip == iend) {
+      break;
+    }
+    if (iend - ip < 2) {
+      return -1;
+    }
+    size_t offset = ip[0] | ip[1] << 8;
+    ip += 2;
+    size_t match_length = token & RUN_MASK;
+    if (!ReadExtraLength(&ip, iend, &match_length)) {
+      return -1;
+    }
+    match_length += MIN_MATCH;
+    if (offset == 0 || offset > static_cast<size_t>(op - dst) || match_length > static_cast<size_t>(oend - op)) {
+      return -1;
+    }
+    // A match closer than its length repeats a short pattern. Every copy doubles how much of the pattern is already
+    // written, so the copies never overlap and a run of zeroes takes a handful of them.
+    const char *match = op - offset;
+    while (match_length > 0) {
+      size_t chunk = std::min(static_cast<size_t>(op - match), match_length);
+      memcpy(op, match, chunk);
+      op += chunk;
+      match_length -= chunk;
+    }
+  }
+  return op - dst;
+}
+
+}  // namespace bustub
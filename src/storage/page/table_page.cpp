@@ -85,6 +85,33 @@ auto TablePage::InsertTuple(const Tuple &tuple, RID *rid, Transaction *txn, Lock
   return true;
 }
 
+auto TablePage::InsertTupleAt(const Tuple &tuple, const RID &rid) -> bool {
+  BUSTUB_ASSERT(tuple.size_ > 0, "Cannot have empty tuples.");
+  uint32_t slot_num = rid.GetSlotNum();
+  uint32_t tuple_count = GetTupleCount();
+  if (slot_num < tuple_count && GetTupleSize(slot_num) != 0) {
+    return false;
+  }
+  uint32_t new_slots = slot_num < tuple_count ? 0 : slot_num + 1 - tuple_count;
+  if (GetFreeSpaceRemaining() < tuple.size_ + new_slots * SIZE_TUPLE) {
+    return false;
+  }
+
+  // The slots in between stay empty.
+  for (uint32_t i = tuple_count; i < slot_num; i++) {
+    SetTupleOffsetAtSlot(i, 0);
+    SetTupleSize(i, 0);
+  }
+  if (new_slots > 0) {
+    SetTupleCount(slot_num + 1);
+  }
+  SetFreeSpacePointer(GetFreeSpacePointer() - tuple.size_);
+  memcpy(GetData() + GetFreeSpacePointer(), tuple.data_, tuple.size_);
+  SetTupleOffsetAtSlot(slot_num, GetFreeSpacePointer());
+  SetTupleSize(slot_num, tuple.size_);
+  return true;
+}
+
 auto TablePage::MarkDelete(const RID &rid, Transaction *txn, LockManager *lock_manager, LogManager *log_manager)
     -> bool {
   uint32_t slot_num = rid.GetSlotNum();
@@ -10,14 +10,17 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include <algorithm>
 #include <cassert>
+#include <vector>
 
 #include "storage/table/table_heap.h"
 
 namespace bustub {
 
-TableIterator::TableIterator(TableHeap *table_heap, RID rid, Transaction *txn)
-    : table_heap_(table_heap), tuple_(new Tuple(rid)), txn_(txn) {
+TableIterator::TableIterator(TableHeap *table_heap, RID rid, Transaction *txn,
+                             std::shared_ptr<BufferAccessStrategy> strategy)
+    : table_heap_(table_heap), tuple_(new Tuple(rid)), txn_(txn), strategy_(std::move(strategy)) {
   if (rid.GetPageId() != INVALID_PAGE_ID) {
     table_heap_->GetTuple(tuple_->rid_, tuple_, txn_);
   }
@@ -35,19 +38,20 @@ auto TableIterator::operator->() -> Tuple * {
 
 auto TableIterator::operator++() -> TableIterator & {
   BufferPoolManager *buffer_pool_manager = table_heap_->buffer_pool_manager_;
-  auto cur_page = static_cast<TablePage *>(buffer_pool_manager->FetchPage(tuple_->rid_.GetPageId()));
-  cur_page->RLatch();
-  assert(cur_page != nullptr);  // all pages are pinned
+  ReadPageGuard cur_guard = buffer_pool_manager->FetchPageRead(tuple_->rid_.GetPageId(), strategy_.get());
+  assert(cur_guard.IsValid());  // all pages are pinned
+  auto cur_page = static_cast<TablePage *>(cur_guard.GetPage());
 
   RID next_tuple_rid;
   if (!cur_page->GetNextTupleRid(tuple_->rid_,
                                  &next_tuple_rid)) {  // end of this page
     while (cur_page->GetNextPageId() != INVALID_PAGE_ID) {
-      auto next_page = static_cast<TablePage *>(buffer_pool_manager->FetchPage(cur_page->GetNextPageId()));
-      cur_page->RUnlatch();
-      buffer_pool_manager->UnpinPage(cur_page->GetTablePageId(), false);
-      cur_page = next_page;
-      cur_page->RLatch();
+      ReadAhead(cur_page->GetTablePageId(), cur_page->GetNextPageId());
+      // Pin the next page before letting go of the current one, but only latch it afterwards.
+      BasicPageGuard next_guard = buffer_pool_manager->FetchPageBasic(cur_page->GetNextPageId(), strategy_.get());
+      cur_guard.Drop();
+      cur_guard = next_guard.UpgradeRead();
+      cur_page = static_cast<TablePage *>(cur_guard.GetPage());
       if (cur_page->GetFirstTupleRid(&next_tuple_rid)) {
         break;
       }
@@ -59,11 +63,48 @@ auto TableIterator::operator++() -> TableIterator & {
     table_heap_->GetTuple(tuple_->rid_, tuple_, txn_);
   }
   // release until copy the tuple
-  cur_page->RUnlatch();
-  buffer_pool_manager->UnpinPage(cur_page->GetTablePageId(), false);
   return *this;
 }
 
+void TableIterator::ReadAhead(page_id_t cur_page_id, page_id_t next_page_id) {
+  page_id_t stride = next_page_id - cur_page_id;
+  bool sequential = stride != 0 && stride == stride_;
+  stride_ = stride;
+  if (!sequential) {
+    next_prefetch_page_id_ = INVALID_PAGE_ID;
+    return;
+  }
+
+  BufferPoolManager *buffer_pool_manager = table_heap_->buffer_pool_manager_;
+  int read_ahead = READ_AHEAD_PAGES;
+  if (strategy_ != nullptr) {
+    if (prefetch_strategy_ == nullptr) {
+      prefetch_strategy_ = std::make_shared<BufferAccessStrategy>(strategy_->GetType());
+    }
+    // Stay within half of the ring, or the prefetched pages get recycled before the scan reaches them.
+    auto ring_frames = prefetch_strategy_->GetRingFrames(buffer_pool_manager->GetPoolSize());
+    read_ahead = std::min(read_ahead, static_cast<int>(ring_frames / 2));
+  }
+
+  // Only ask for the pages that are not requested yet, so that every page change tops the window up by one page.
+  int requested = 0;
+  if (next_prefetch_page_id_ != INVALID_PAGE_ID && (next_prefetch_page_id_ - next_page_id) % stride == 0) {
+    requested = std::max((next_prefetch_page_id_ - next_page_id) / stride - 1, 0);
+  }
+  std::vector<page_id_t> page_ids;
+  for (int i = requested + 1; i <= read_ahead; ++i) {
+    page_id_t page_id = next_page_id + i * stride;
+    if (page_id < 0) {
+      break;
+    }
+    page_ids.push_back(page_id);
+  }
+  if (!page_ids.empty()) {
+    next_prefetch_page_id_ = page_ids.back() + stride;
+    buffer_pool_manager->PrefetchPages(page_ids, prefetch_strategy_);
+  }
+}
+
 auto TableIterator::operator++(int) -> TableIterator {
   TableIterator clone(*this);
   ++(*this);
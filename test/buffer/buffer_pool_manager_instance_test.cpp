@@ -11,9 +11,17 @@
 //===----------------------------------------------------------------------===//
 
 #include "buffer/buffer_pool_manager_instance.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>  // NOLINT
 #include <cstdio>
+#include <cstring>
+#include <future>  // NOLINT
+#include <iostream>
 #include <random>
 #include <string>
+#include <thread>  // NOLINT
+#include <vector>
 #include "buffer/buffer_pool_manager.h"
 #include "gtest/gtest.h"
 
@@ -140,4 +148,820 @@ TEST(BufferPoolManagerInstanceTest, SampleTest) {
   delete disk_manager;
 }
 
+// NOLINTNEXTLINE
+TEST(BufferPoolManagerInstanceTest, ConcurrentHitTest) {
+  const std::string db_name = "test.db";
+  const size_t buffer_pool_size = 16;
+  const int num_threads = 8;
+  const int rounds = 2000;
+
+  auto *disk_manager = new DiskManager(db_name);
+  auto *bpm = new BufferPoolManagerInstance(buffer_pool_size, disk_manager);
+
+  std::vector<page_id_t> page_ids(buffer_pool_size);
+  for (size_t i = 0; i < buffer_pool_size; ++i) {
+    auto *page = bpm->NewPage(&page_ids[i]);
+    ASSERT_NE(nullptr, page);
+    snprintf(page->GetData(), PAGE_SIZE, "page %d", page_ids[i]);
+    EXPECT_EQ(true, bpm->UnpinPage(page_ids[i], true));
+  }
+
+  // Scenario: many threads hammer resident pages. Every fetch must hit and see the right content.
+  std::vector<std::thread> threads;
+  for (int tid = 0; tid < num_threads; ++tid) {
+    threads.emplace_back([&, tid]() {
+      char expected[PAGE_SIZE];
+      for (int i = 0; i < rounds; ++i) {
+        page_id_t page_id = page_ids[(tid + i) % buffer_pool_size];
+        auto *page = bpm->FetchPage(page_id);
+        ASSERT_NE(nullptr, page);
+        snprintf(expected, PAGE_SIZE, "page %d", page_id);
+        EXPECT_EQ(0, strcmp(page->GetData(), expected));
+        EXPECT_EQ(true, bpm->UnpinPage(page_id, false));
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+
+  // Scenario: all pins were released, so every frame can be reused for a new page.
+  for (size_t i = 0; i < buffer_pool_size; ++i) {
+    EXPECT_NE(nullptr, bpm->NewPage(&page_ids[i]));
+  }
+
+  disk_manager->ShutDown();
+  remove("test.db");
+  delete bpm;
+  delete disk_manager;
+}
+
+// NOLINTNEXTLINE
+TEST(BufferPoolManagerInstanceTest, QueuedReplacerUpdatesTest) {
+  const std::string db_name = "test.db";
+  const size_t buffer_pool_size = 4;
+
+  auto *disk_manager = new DiskManager(db_name);
+  auto *bpm = new BufferPoolManagerInstance(buffer_pool_size, disk_manager);
+
+  std::vector<page_id_t> page_ids(buffer_pool_size);
+  for (size_t i = 0; i < buffer_pool_size; ++i) {
+    ASSERT_NE(nullptr, bpm->NewPage(&page_ids[i]));
+    EXPECT_TRUE(bpm->UnpinPage(page_ids[i], false));
+  }
+
+  // Hits only queue their pins and unpins, spread over several stripes, but the replacer sees them in order before it
+  // picks a victim: the pages go in the order they were last used.
+  for (int round = 0; round < 20; ++round) {
+    for (size_t i = buffer_pool_size; i > 0; --i) {
+      ASSERT_NE(nullptr, bpm->FetchPage(page_ids[i - 1]));
+      EXPECT_TRUE(bpm->UnpinPage(page_ids[i - 1], false));
+    }
+  }
+  std::vector<page_id_t> expected(page_ids.begin(), page_ids.end());
+  EXPECT_EQ(expected, bpm->GetResidentPages());
+  page_id_t new_page_id;
+  for (size_t i = buffer_pool_size; i > 0; --i) {
+    ASSERT_NE(nullptr, bpm->NewPage(&new_page_id));
+    auto resident = bpm->GetResidentPages();
+    EXPECT_EQ(resident.end(), std::find(resident.begin(), resident.end(), page_ids[i - 1]));
+    if (i > 1) {
+      EXPECT_NE(resident.end(), std::find(resident.begin(), resident.end(), page_ids[i - 2]));
+    }
+  }
+  // Only pinned pages are left.
+  EXPECT_EQ(nullptr, bpm->NewPage(&new_page_id));
+
+  disk_manager->ShutDown();
+  remove("test.db");
+  delete bpm;
+  delete disk_manager;
+}
+
+// NOLINTNEXTLINE
+TEST(BufferPoolManagerInstanceTest, ConcurrentMissTest) {
+  const std::string db_name = "test.db";
+  const size_t buffer_pool_size = 8;
+  const size_t num_pages = 64;
+  const int num_threads = 8;
+  const int rounds = 500;
+
+  auto *disk_manager = new DiskManager(db_name);
+  auto *bpm = new BufferPoolManagerInstance(buffer_pool_size, disk_manager);
+
+  // Create more pages than fit in the pool, so that they get written back and read in again.
+  std::vector<page_id_t> page_ids(num_pages);
+  for (size_t i = 0; i < num_pages; ++i) {
+    auto *page = bpm->NewPage(&page_ids[i]);
+    ASSERT_NE(nullptr, page);
+    snprintf(page->GetData(), PAGE_SIZE, "page %d", page_ids[i]);
+    EXPECT_EQ(true, bpm->UnpinPage(page_ids[i], true));
+  }
+
+  // Scenario: threads fetch overlapping pages, so some wait for a read another thread started, and pages are
+  // re-dirtied while they are being written back. Content must never be torn or stale.
+  std::vector<std::thread> threads;
+  for (int tid = 0; tid < num_threads; ++tid) {
+    threads.emplace_back([&, tid]() {
+      std::default_random_engine rng(tid);
+      std::uniform_int_distribution<size_t> dist(0, num_pages - 1);
+      char expected[PAGE_SIZE];
+      for (int i = 0; i < rounds; ++i) {
+        page_id_t page_id = page_ids[dist(rng)];
+        auto *page = bpm->FetchPage(page_id);
+        if (page == nullptr) {
+          // Every frame was pinned by the other threads.
+          continue;
+        }
+        snprintf(expected, PAGE_SIZE, "page %d", page_id);
+        page->RLatch();
+        EXPECT_EQ(0, strcmp(page->GetData(), expected));
+        page->RUnlatch();
+        EXPECT_EQ(true, bpm->UnpinPage(page_id, i % 2 == 0));
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+
+  disk_manager->ShutDown();
+  remove("test.db");
+  delete bpm;
+  delete disk_manager;
+}
+
+// NOLINTNEXTLINE
+TEST(BufferPoolManagerInstanceTest, ClockReplacerTest) {
+  const std::string db_name = "test.db";
+  const size_t buffer_pool_size = 4;
+  const int num_threads = 4;
+  const int rounds = 200;
+
+  BufferPoolOptions options;
+  options.replacer_type_ = ReplacerType::CLOCK;
+  auto *disk_manager = new DiskManager(db_name);
+  auto *bpm = new BufferPoolManagerInstance(buffer_pool_size, disk_manager, nullptr, options);
+
+  std::vector<page_id_t> page_ids(4 * buffer_pool_size);
+  for (auto &page_id : page_ids) {
+    auto *page = bpm->NewPage(&page_id);
+    ASSERT_NE(nullptr, page);
+    snprintf(page->GetData(), PAGE_SIZE, "page %d", page_id);
+    EXPECT_EQ(true, bpm->UnpinPage(page_id, true));
+  }
+
+  // Scenario: the pool only has room for a quarter of the pages, so the clock keeps evicting under contention.
+  std::vector<std::thread> threads;
+  for (int tid = 0; tid < num_threads; ++tid) {
+    threads.emplace_back([&, tid]() {
+      char expected[PAGE_SIZE];
+      for (int i = 0; i < rounds; ++i) {
+        page_id_t page_id = page_ids[(tid * 7 + i * 3) % page_ids.size()];
+        auto *page = bpm->FetchPage(page_id);
+        if (page == nullptr) {
+          continue;
+        }
+        snprintf(expected, PAGE_SIZE, "page %d", page_id);
+        page->RLatch();
+        EXPECT_EQ(0, strcmp(page->GetData(), expected));
+        page->RUnlatch();
+        EXPECT_EQ(true, bpm->UnpinPage(page_id, false));
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+
+  // Scenario: with everything unpinned, every frame can be reused.
+  for (size_t i = 0; i < buffer_pool_size; ++i) {
+    page_id_t page_id;
+    EXPECT_NE(nullptr, bpm->NewPage(&page_id));
+  }
+
+  disk_manager->ShutDown();
+  remove("test.db");
+  delete bpm;
+  delete disk_manager;
+}
+
+// NOLINTNEXTLINE
+TEST(BufferPoolManagerInstanceTest, AccessStrategyTest) {
+  const std::string db_name = "test.db";
+  const size_t buffer_pool_size = 16;
+  const size_t num_hot_pages = 4;
+  const size_t num_scan_pages = 64;
+
+  auto *disk_manager = new DiskManager(db_name);
+  auto *bpm = new BufferPoolManagerInstance(buffer_pool_size, disk_manager);
+
+  // Scenario: a bulk write creates many pages but only recycles its own ring of frames.
+  BufferAccessStrategy bulk_write(BufferAccessStrategyType::BULKWRITE);
+  std::vector<page_id_t> scan_page_ids(num_scan_pages);
+  for (auto &page_id : scan_page_ids) {
+    auto *page = bpm->NewPageWithStrategy(&page_id, &bulk_write);
+    ASSERT_NE(nullptr, page);
+    snprintf(page->GetData(), PAGE_SIZE, "page %d", page_id);
+    EXPECT_EQ(true, bpm->UnpinPage(page_id, true));
+  }
+  auto is_resident = [bpm](page_id_t page_id) {
+    for (size_t i = 0; i < buffer_pool_size; ++i) {
+      if (bpm->GetPages()[i].GetPageId() == page_id) {
+        return true;
+      }
+    }
+    return false;
+  };
+  size_t resident = std::count_if(scan_page_ids.begin(), scan_page_ids.end(), is_resident);
+  EXPECT_EQ(2, resident);
+
+  // Scenario: a working set is cached next to the bulk pages.
+  std::vector<page_id_t> hot_page_ids(num_hot_pages);
+  for (auto &page_id : hot_page_ids) {
+    ASSERT_NE(nullptr, bpm->NewPage(&page_id));
+    EXPECT_EQ(true, bpm->UnpinPage(page_id, false));
+  }
+
+  // Scenario: a scan that holds the current page while fetching the next one, like TableIterator, reads every page
+  // through a two frame ring and leaves the working set alone.
+  BufferAccessStrategy bulk_read(BufferAccessStrategyType::BULKREAD);
+  char expected[PAGE_SIZE];
+  page_id_t prev_page_id = INVALID_PAGE_ID;
+  for (auto page_id : scan_page_ids) {
+    auto *page = bpm->FetchPageWithStrategy(page_id, &bulk_read);
+    ASSERT_NE(nullptr, page);
+    snprintf(expected, PAGE_SIZE, "page %d", page_id);
+    EXPECT_EQ(0, strcmp(page->GetData(), expected));
+    if (prev_page_id != INVALID_PAGE_ID) {
+      EXPECT_EQ(true, bpm->UnpinPage(prev_page_id, false));
+    }
+    prev_page_id = page_id;
+  }
+  EXPECT_EQ(true, bpm->UnpinPage(prev_page_id, false));
+  for (auto page_id : hot_page_ids) {
+    EXPECT_TRUE(is_resident(page_id));
+  }
+
+  // Scenario: without a strategy, the same scan flushes the working set out.
+  for (auto page_id : scan_page_ids) {
+    ASSERT_NE(nullptr, bpm->FetchPage(page_id));
+    EXPECT_EQ(true, bpm->UnpinPage(page_id, false));
+  }
+  for (auto page_id : hot_page_ids) {
+    EXPECT_FALSE(is_resident(page_id));
+  }
+
+  disk_manager->ShutDown();
+  remove("test.db");
+  delete bpm;
+  delete disk_manager;
+}
+
+// NOLINTNEXTLINE
+TEST(BufferPoolManagerInstanceTest, CleanerTest) {
+  const std::string db_name = "test.db";
+  const size_t buffer_pool_size = 10;
+
+  // Scenario: without a cleaner, every dirty victim is written in the foreground.
+  auto *disk_manager = new DiskManager(db_name);
+  auto *bpm = new BufferPoolManagerInstance(buffer_pool_size, disk_manager);
+  page_id_t page_id;
+  for (size_t i = 0; i < 2 * buffer_pool_size; ++i) {
+    ASSERT_NE(nullptr, bpm->NewPage(&page_id));
+    EXPECT_EQ(true, bpm->UnpinPage(page_id, true));
+  }
+  BufferPoolCounters counters = bpm->GetCounters();
+  EXPECT_EQ(buffer_pool_size, counters.evictions_);
+  EXPECT_EQ(buffer_pool_size, counters.sync_write_backs_);
+  EXPECT_EQ(0, counters.cleaner_write_backs_);
+  delete bpm;
+
+  // Scenario: the cleaner keeps half of the pool clean, so that many evictions need no write.
+  BufferPoolOptions options;
+  options.enable_cleaner_ = true;
+  options.cleaner_clean_fraction_ = 0.5;
+  options.cleaner_interval_ = std::chrono::milliseconds(1);
+  bpm = new BufferPoolManagerInstance(buffer_pool_size, disk_manager, nullptr, options);
+  std::vector<page_id_t> page_ids(buffer_pool_size);
+  for (auto &id : page_ids) {
+    auto *page = bpm->NewPage(&id);
+    ASSERT_NE(nullptr, page);
+    snprintf(page->GetData(), PAGE_SIZE, "page %d", id);
+    EXPECT_EQ(true, bpm->UnpinPage(id, true));
+  }
+  for (int i = 0; i < 1000 && bpm->GetCounters().cleaner_write_backs_ < buffer_pool_size / 2; ++i) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  EXPECT_LE(buffer_pool_size / 2, bpm->GetCounters().cleaner_write_backs_);
+
+  // The cleaner went in page id order, which is also LRU order here, so the next victims are all clean.
+  for (size_t i = 0; i < buffer_pool_size / 2; ++i) {
+    ASSERT_NE(nullptr, bpm->NewPage(&page_id));
+    EXPECT_EQ(true, bpm->UnpinPage(page_id, false));
+  }
+  counters = bpm->GetCounters();
+  EXPECT_EQ(buffer_pool_size / 2, counters.evictions_);
+  EXPECT_EQ(0, counters.sync_write_backs_);
+
+  // What the cleaner wrote is what comes back from disk.
+  char expected[PAGE_SIZE];
+  for (size_t i = 0; i < buffer_pool_size / 2; ++i) {
+    auto *page = bpm->FetchPage(page_ids[i]);
+    ASSERT_NE(nullptr, page);
+    snprintf(expected, PAGE_SIZE, "page %d", page_ids[i]);
+    EXPECT_EQ(0, strcmp(page->GetData(), expected));
+    EXPECT_EQ(true, bpm->UnpinPage(page_ids[i], false));
+  }
+
+  disk_manager->ShutDown();
+  remove("test.db");
+  delete bpm;
+  delete disk_manager;
+}
+
+// Looks pages up the way a cache hit does, so that it can run while the prefetch thread loads pages.
+class ResidencyCheckingBufferPoolManager : public BufferPoolManagerInstance {
+ public:
+  using BufferPoolManagerInstance::BufferPoolManagerInstance;
+
+  auto IsResident(page_id_t page_id) -> bool {
+    PageTableStripe &stripe = GetStripe(page_id);
+    std::lock_guard<std::mutex> stripe_lock(stripe.latch_);
+    return stripe.table_.count(page_id) > 0;
+  }
+};
+
+// NOLINTNEXTLINE
+TEST(BufferPoolManagerInstanceTest, PrefetchTest) {
+  const std::string db_name = "test.db";
+  const size_t buffer_pool_size = 10;
+
+  auto *disk_manager = new DiskManager(db_name);
+  auto *bpm = new ResidencyCheckingBufferPoolManager(buffer_pool_size, disk_manager);
+  std::vector<page_id_t> page_ids(2 * buffer_pool_size);
+  for (auto &page_id : page_ids) {
+    auto *page = bpm->NewPage(&page_id);
+    ASSERT_NE(nullptr, page);
+    snprintf(page->GetData(), PAGE_SIZE, "page %d", page_id);
+    EXPECT_EQ(true, bpm->UnpinPage(page_id, true));
+  }
+  bpm->FlushAllPages();
+  auto is_resident = [bpm](page_id_t page_id) { return bpm->IsResident(page_id); };
+  EXPECT_FALSE(is_resident(page_ids[0]));
+
+  // Scenario: the first pages were evicted. Prefetch them, plus a page past the end of the file.
+  const page_id_t past_end = 1000;
+  bpm->PrefetchPages({page_ids[0], page_ids[1], page_ids[2], past_end});
+  // A prefetched page is resident as soon as its read starts, and keeps a pin until the read is done.
+  for (int i = 0; i < 1000 && (!is_resident(page_ids[2]) || bpm->GetPinnedFrameCount() > 0); ++i) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  EXPECT_TRUE(is_resident(page_ids[0]));
+  EXPECT_TRUE(is_resident(page_ids[1]));
+  EXPECT_TRUE(is_resident(page_ids[2]));
+  EXPECT_FALSE(is_resident(past_end));
+
+  // Scenario: prefetched pages hold their content and are not left pinned.
+  char expected[PAGE_SIZE];
+  for (int i = 0; i < 3; ++i) {
+    auto *page = bpm->FetchPage(page_ids[i]);
+    ASSERT_NE(nullptr, page);
+    EXPECT_EQ(1, page->GetPinCount());
+    snprintf(expected, PAGE_SIZE, "page %d", page_ids[i]);
+    EXPECT_EQ(0, strcmp(page->GetData(), expected));
+    EXPECT_EQ(true, bpm->UnpinPage(page_ids[i], false));
+  }
+
+  disk_manager->ShutDown();
+  remove("test.db");
+  delete bpm;
+  delete disk_manager;
+}
+
+// Cache-hit throughput as the number of threads grows. Run with --gtest_also_run_disabled_tests.
+// NOLINTNEXTLINE
+TEST(BufferPoolManagerInstanceTest, DISABLED_HitScalingBenchmark) {
+  const std::string db_name = "test.db";
+  const size_t buffer_pool_size = 1024;
+  const auto duration = std::chrono::milliseconds(500);
+  const size_t max_threads = std::max(4U, std::thread::hardware_concurrency());
+
+  auto *disk_manager = new DiskManager(db_name);
+  auto *bpm = new BufferPoolManagerInstance(buffer_pool_size, disk_manager);
+  std::vector<page_id_t> page_ids(buffer_pool_size);
+  for (size_t i = 0; i < buffer_pool_size; ++i) {
+    ASSERT_NE(nullptr, bpm->NewPage(&page_ids[i]));
+    bpm->UnpinPage(page_ids[i], false);
+  }
+
+  for (size_t num_threads = 1; num_threads <= max_threads; num_threads *= 2) {
+    std::atomic<bool> stop{false};
+    std::atomic<uint64_t> total_ops{0};
+    std::vector<std::thread> threads;
+    for (size_t tid = 0; tid < num_threads; ++tid) {
+      threads.emplace_back([&, tid]() {
+        std::default_random_engine rng(tid);
+        std::uniform_int_distribution<size_t> dist(0, buffer_pool_size - 1);
+        uint64_t ops = 0;
+        while (!stop.load(std::memory_order_relaxed)) {
+          page_id_t page_id = page_ids[dist(rng)];
+          bpm->FetchPage(page_id);
+          bpm->UnpinPage(page_id, false);
+          ops++;
+        }
+        total_ops += ops;
+      });
+    }
+    std::this_thread::sleep_for(duration);
+    stop = true;
+    for (auto &thread : threads) {
+      thread.join();
+    }
+    std::cout << num_threads << " threads: " << total_ops * 1000 / duration.count() << " hits/s" << std::endl;
+  }
+
+  disk_manager->ShutDown();
+  remove("test.db");
+  delete bpm;
+  delete disk_manager;
+}
+
+// NOLINTNEXTLINE
+TEST(BufferPoolManagerInstanceTest, FlushAllDirtyPagesTest) {
+  const std::string db_name = "test.db";
+  const size_t buffer_pool_size = 10;
+
+  auto *disk_manager = new DiskManager(db_name);
+  auto *bpm = new BufferPoolManagerInstance(buffer_pool_size, disk_manager);
+
+  // Scenario: pages 0-9 are resident, all dirty except page 5, and page 9 is still pinned.
+  std::vector<page_id_t> page_ids(buffer_pool_size);
+  for (auto &page_id : page_ids) {
+    auto *page = bpm->NewPage(&page_id);
+    ASSERT_NE(nullptr, page);
+    snprintf(page->GetData(), PAGE_SIZE, "page %d", page_id);
+    if (page_id != 9) {
+      EXPECT_TRUE(bpm->UnpinPage(page_id, page_id != 5));
+    }
+  }
+  Page *pinned = bpm->FetchPage(9);
+  pinned->WLatch();
+  snprintf(pinned->GetData(), PAGE_SIZE, "page 9");
+  pinned->WUnlatch();
+  EXPECT_TRUE(bpm->UnpinPage(9, true));
+  int writes_before = disk_manager->GetNumWrites();
+
+  // The clean page splits the dirty ones into two runs of one write each.
+  FlushStats stats = bpm->FlushAllDirtyPages();
+  EXPECT_EQ(9, stats.pages_written_);
+  EXPECT_EQ(9 * PAGE_SIZE, stats.bytes_written_);
+  EXPECT_EQ(2, stats.writes_);
+  EXPECT_EQ(writes_before + 2, disk_manager->GetNumWrites());
+  for (auto page_id : page_ids) {
+    if (page_id == 5) {
+      continue;
+    }
+    char data[PAGE_SIZE];
+    char expected[PAGE_SIZE];
+    disk_manager->ReadPage(page_id, data);
+    snprintf(expected, PAGE_SIZE, "page %d", page_id);
+    EXPECT_EQ(0, strcmp(data, expected));
+  }
+
+  // Everything is clean now, and flushed pages can still be evicted.
+  EXPECT_TRUE(bpm->UnpinPage(9, false));
+  stats = bpm->FlushAllDirtyPages();
+  EXPECT_EQ(0, stats.pages_written_);
+  EXPECT_EQ(0, stats.writes_);
+  page_id_t page_id;
+  for (size_t i = 0; i < buffer_pool_size; ++i) {
+    ASSERT_NE(nullptr, bpm->NewPage(&page_id));
+  }
+
+  disk_manager->ShutDown();
+  remove("test.db");
+
+  delete bpm;
+  delete disk_manager;
+}
+
+// NOLINTNEXTLINE
+TEST(BufferPoolManagerInstanceTest, CountersTest) {
+  const std::string db_name = "test.db";
+  const size_t buffer_pool_size = 3;
+
+  auto *disk_manager = new DiskManager(db_name);
+  auto *bpm = new BufferPoolManagerInstance(buffer_pool_size, disk_manager);
+
+  std::vector<page_id_t> page_ids(buffer_pool_size);
+  for (auto &page_id : page_ids) {
+    ASSERT_NE(nullptr, bpm->NewPage(&page_id));
+    EXPECT_TRUE(bpm->UnpinPage(page_id, page_id == 0));
+  }
+  // Three hits, after which every frame is pinned and neither a new page nor a miss can get one.
+  for (auto page_id : page_ids) {
+    ASSERT_NE(nullptr, bpm->FetchPage(page_id));
+  }
+  page_id_t page_id;
+  EXPECT_EQ(nullptr, bpm->NewPage(&page_id));
+  EXPECT_EQ(nullptr, bpm->FetchPage(buffer_pool_size));
+  EXPECT_TRUE(bpm->FlushPage(0));
+  for (auto page_id : page_ids) {
+    EXPECT_TRUE(bpm->UnpinPage(page_id, false));
+  }
+  // Replace all three pages, then read page 0 back in.
+  for (size_t i = 0; i < buffer_pool_size; ++i) {
+    ASSERT_NE(nullptr, bpm->NewPage(&page_id));
+    EXPECT_TRUE(bpm->UnpinPage(page_id, false));
+  }
+  ASSERT_NE(nullptr, bpm->FetchPage(0));
+  EXPECT_TRUE(bpm->UnpinPage(0, false));
+
+  BufferPoolCounters counters = bpm->GetCounters();
+  EXPECT_EQ(3, counters.fetch_hits_);
+  EXPECT_EQ(1, counters.fetch_misses_);
+  EXPECT_EQ(6, counters.new_pages_);
+  EXPECT_EQ(4, counters.evictions_);
+  EXPECT_EQ(0, counters.sync_write_backs_);
+  EXPECT_EQ(1, counters.flushes_);
+  EXPECT_EQ(2, counters.no_free_frames_);
+  EXPECT_DOUBLE_EQ(0.75, counters.HitRatio());
+  // Hits never take latch_; everything else took it exactly once.
+  uint64_t latch_acquisitions = 0;
+  for (auto count : counters.latch_wait_ns_) {
+    latch_acquisitions += count;
+  }
+  EXPECT_EQ(9, latch_acquisitions);
+
+  disk_manager->ShutDown();
+  remove("test.db");
+
+  delete bpm;
+  delete disk_manager;
+}
+
+// NOLINTNEXTLINE
+TEST(BufferPoolManagerInstanceTest, WarmupTest) {
+  const std::string db_name = "test.db";
+  const size_t buffer_pool_size = 10;
+
+  BufferPoolOptions options;
+  options.warmup_file_ = "test.warmup";
+  remove(options.warmup_file_.c_str());
+  auto *disk_manager = new DiskManager(db_name);
+  auto *bpm = new BufferPoolManagerInstance(buffer_pool_size, disk_manager, nullptr, options);
+
+  page_id_t page_id;
+  for (size_t i = 0; i < buffer_pool_size * 2; ++i) {
+    Page *page = bpm->NewPage(&page_id);
+    ASSERT_NE(nullptr, page);
+    snprintf(page->GetData(), PAGE_SIZE, "page %d", page_id);
+    EXPECT_TRUE(bpm->UnpinPage(page_id, true));
+  }
+  bpm->FlushAllPages();
+
+  // Pages 10-19 are resident. The pinned page comes first, then the others from the most recently used.
+  ASSERT_NE(nullptr, bpm->FetchPage(12));
+  std::vector<page_id_t> expected = {12, 19, 18, 17, 16, 15, 14, 13, 11, 10};
+  EXPECT_EQ(expected, bpm->GetResidentPages());
+  EXPECT_TRUE(bpm->UnpinPage(12, false));
+
+  // Destroying the pool writes the list, and a smaller pool preloads the hottest pages that fit.
+  delete bpm;
+  const size_t small_pool_size = 5;
+  bpm = new BufferPoolManagerInstance(small_pool_size, disk_manager, nullptr, options);
+  for (int i = 0; i < 1000 && bpm->GetCounters().preloaded_pages_ < small_pool_size; ++i) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  EXPECT_EQ(small_pool_size, bpm->GetCounters().preloaded_pages_);
+  for (page_id_t page_id : {12, 16, 17, 18, 19}) {
+    Page *page = bpm->FetchPage(page_id);
+    ASSERT_NE(nullptr, page);
+    char expected_data[PAGE_SIZE];
+    snprintf(expected_data, PAGE_SIZE, "page %d", page_id);
+    EXPECT_STREQ(expected_data, page->GetData());
+    EXPECT_TRUE(bpm->UnpinPage(page_id, false));
+  }
+  EXPECT_EQ(0, bpm->GetCounters().fetch_misses_);
+
+  disk_manager->ShutDown();
+  remove("test.db");
+
+  delete bpm;
+  delete disk_manager;
+  remove(options.warmup_file_.c_str());
+}
+
+// NOLINTNEXTLINE
+TEST(BufferPoolManagerInstanceTest, FrameLayoutTest) {
+  const std::string db_name = "test.db";
+  const size_t buffer_pool_size = 10;
+
+  auto *disk_manager = new DiskManager(db_name);
+  for (bool use_huge_pages : {false, true}) {
+    BufferPoolOptions options;
+    options.use_huge_pages_ = use_huge_pages;
+    auto *bpm = new BufferPoolManagerInstance(buffer_pool_size, disk_manager, nullptr, options);
+
+    // Frame data is page-aligned and contiguous, and every descriptor has cache lines of its own.
+    Page *pages = bpm->GetPages();
+    for (size_t i = 0; i < buffer_pool_size; ++i) {
+      EXPECT_EQ(0, reinterpret_cast<uintptr_t>(pages[i].GetData()) % PAGE_SIZE);
+      EXPECT_EQ(pages[0].GetData() + i * PAGE_SIZE, pages[i].GetData());
+      EXPECT_EQ(0, reinterpret_cast<uintptr_t>(&pages[i]) % CACHE_LINE_SIZE);
+    }
+    EXPECT_EQ(0, sizeof(Page) % CACHE_LINE_SIZE);
+
+    page_id_t page_id;
+    Page *page = bpm->NewPage(&page_id);
+    ASSERT_NE(nullptr, page);
+    snprintf(page->GetData(), PAGE_SIZE, "Hello");
+    EXPECT_TRUE(bpm->UnpinPage(page_id, true));
+    EXPECT_TRUE(bpm->FlushPage(page_id));
+    delete bpm;
+  }
+
+  disk_manager->ShutDown();
+  remove("test.db");
+
+  delete disk_manager;
+}
+
+// NOLINTNEXTLINE
+TEST(BufferPoolManagerInstanceTest, FreePageReuseTest) {
+  const std::string db_name = "test.db";
+  const size_t buffer_pool_size = 10;
+
+  remove("test.db");
+  auto *disk_manager = new DiskManager(db_name);
+  auto *bpm = new BufferPoolManagerInstance(buffer_pool_size, disk_manager);
+
+  // A page that was never handed out is not there to be deleted; its id is still to come in order.
+  EXPECT_TRUE(bpm->DeletePage(500));
+  EXPECT_EQ(0, disk_manager->GetNumFreePages());
+
+  page_id_t page_id;
+  for (int i = 0; i < 5; ++i) {
+    ASSERT_NE(nullptr, bpm->NewPage(&page_id));
+    EXPECT_EQ(i, page_id);
+  }
+  for (page_id_t i = 0; i < 5; ++i) {
+    if (i != 2) {
+      EXPECT_TRUE(bpm->UnpinPage(i, true));
+    }
+  }
+  bpm->FlushAllPages();
+
+  // A pinned page cannot be deleted, and must not be handed out again either.
+  EXPECT_FALSE(bpm->DeletePage(2));
+  EXPECT_EQ(0, disk_manager->GetNumFreePages());
+  EXPECT_TRUE(bpm->UnpinPage(2, false));
+  EXPECT_TRUE(bpm->DeletePage(3));
+  EXPECT_TRUE(bpm->DeletePage(1));
+  EXPECT_EQ(2, disk_manager->GetNumFreePages());
+
+  // The lowest deallocated page comes back first; the file only grows once there is none left.
+  for (page_id_t expected : {1, 3, 5}) {
+    ASSERT_NE(nullptr, bpm->NewPage(&page_id));
+    EXPECT_EQ(expected, page_id);
+    EXPECT_TRUE(bpm->UnpinPage(page_id, false));
+  }
+
+  // A page handed out again starts out zeroed, even if it is never written before it is evicted.
+  Page *page = bpm->FetchPage(0);
+  ASSERT_NE(nullptr, page);
+  snprintf(page->GetData(), PAGE_SIZE, "SECRET");
+  EXPECT_TRUE(bpm->UnpinPage(0, true));
+  EXPECT_TRUE(bpm->FlushPage(0));
+  EXPECT_TRUE(bpm->DeletePage(0));
+  ASSERT_NE(nullptr, bpm->NewPage(&page_id));
+  EXPECT_EQ(0, page_id);
+  EXPECT_TRUE(bpm->UnpinPage(0, false));
+  for (size_t i = 0; i < buffer_pool_size; ++i) {
+    ASSERT_NE(nullptr, bpm->NewPage(&page_id));
+    EXPECT_TRUE(bpm->UnpinPage(page_id, false));
+  }
+  auto resident = bpm->GetResidentPages();
+  EXPECT_EQ(resident.end(), std::find(resident.begin(), resident.end(), 0));
+  page = bpm->FetchPage(0);
+  ASSERT_NE(nullptr, page);
+  char zeroes[PAGE_SIZE] = {0};
+  EXPECT_EQ(0, std::memcmp(zeroes, page->GetData(), PAGE_SIZE));
+  EXPECT_TRUE(bpm->UnpinPage(0, false));
+
+  // The map outlives the disk manager.
+  EXPECT_TRUE(bpm->DeletePage(4));
+  delete bpm;
+  disk_manager->ShutDown();
+  delete disk_manager;
+  disk_manager = new DiskManager(db_name);
+  EXPECT_EQ(1, disk_manager->GetNumFreePages());
+  EXPECT_EQ(4, disk_manager->AllocateFreePage(0, 0, 1));
+  EXPECT_EQ(INVALID_PAGE_ID, disk_manager->AllocateFreePage(0, 0, 1));
+
+  disk_manager->ShutDown();
+  remove("test.db");
+  remove("test.fpm");
+
+  delete disk_manager;
+}
+
+// NOLINTNEXTLINE
+TEST(BufferPoolManagerInstanceTest, FlushPageWhileWritingTest) {
+  const std::string db_name = "test.db";
+  const size_t buffer_pool_size = 10;
+
+  remove("test.db");
+  auto *disk_manager = new DiskManager(db_name);
+  auto *bpm = new BufferPoolManagerInstance(buffer_pool_size, disk_manager);
+  page_id_t page_id;
+  ASSERT_NE(nullptr, bpm->NewPage(&page_id));
+  EXPECT_TRUE(bpm->UnpinPage(page_id, true));
+
+  // A writer fills the page with one byte at a time under its write latch, so every flush sees one of them only.
+  std::atomic<bool> done{false};
+  std::thread writer([&] {
+    for (int i = 0; i < 2000; ++i) {
+      Page *page = bpm->FetchPage(page_id);
+      ASSERT_NE(nullptr, page);
+      page->WLatch();
+      memset(page->GetData(), i % 256, PAGE_SIZE);
+      page->WUnlatch();
+      bpm->UnpinPage(page_id, true);
+    }
+    done = true;
+  });
+  char data[PAGE_SIZE];
+  while (!done) {
+    EXPECT_TRUE(bpm->FlushPage(page_id));
+    disk_manager->ReadPage(page_id, data);
+    EXPECT_EQ(PAGE_SIZE, std::count(data, data + PAGE_SIZE, data[0]));
+  }
+  writer.join();
+
+  // The last change is not lost to a flush that ran while it was made.
+  bpm->FlushAllPages();
+  disk_manager->ReadPage(page_id, data);
+  EXPECT_EQ(PAGE_SIZE, std::count(data, data + PAGE_SIZE, static_cast<char>(1999 % 256)));
+
+  disk_manager->ShutDown();
+  remove("test.db");
+  delete bpm;
+  delete disk_manager;
+}
+
+// Starts and finishes cleaner writes by hand.
+class ManualCleaningBufferPoolManager : public BufferPoolManagerInstance {
+ public:
+  using BufferPoolManagerInstance::BufferPoolManagerInstance;
+
+  auto StartClean(page_id_t page_id, frame_id_t frame_id, std::future<bool> *done) -> bool {
+    return BeginCleanPage(page_id, frame_id, done);
+  }
+  void FinishClean(page_id_t page_id, frame_id_t frame_id, bool written) { EndCleanPage(page_id, frame_id, written); }
+};
+
+// NOLINTNEXTLINE
+TEST(BufferPoolManagerInstanceTest, FlushWaitsForWriteBackTest) {
+  const std::string db_name = "test.db";
+  const size_t buffer_pool_size = 10;
+
+  remove("test.db");
+  auto *disk_manager = new DiskManager(db_name);
+  auto *bpm = new ManualCleaningBufferPoolManager(buffer_pool_size, disk_manager);
+  page_id_t page_id;
+  Page *page = bpm->NewPage(&page_id);
+  ASSERT_NE(nullptr, page);
+  snprintf(page->GetData(), PAGE_SIZE, "Hello");
+  EXPECT_TRUE(bpm->UnpinPage(page_id, true));
+
+  // The cleaner is writing the page when the flush comes along, and its write then fails.
+  auto frame_id = static_cast<frame_id_t>(page - bpm->GetPages());
+  std::future<bool> done;
+  ASSERT_TRUE(bpm->StartClean(page_id, frame_id, &done));
+  done.get();
+  std::atomic<bool> flushed{false};
+  FlushStats stats;
+  std::thread flusher([&] {
+    stats = bpm->FlushAllDirtyPages();
+    flushed = true;
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  EXPECT_FALSE(flushed);
+  bpm->FinishClean(page_id, frame_id, false);
+  flusher.join();
+
+  // The flush waited for that write and wrote the page itself.
+  EXPECT_EQ(1, stats.pages_written_);
+  EXPECT_EQ(0, bpm->GetDirtyPageTable().size());
+  char data[PAGE_SIZE];
+  disk_manager->ReadPage(page_id, data);
+  EXPECT_EQ(0, strcmp(data, "Hello"));
+  disk_manager->ShutDown();
+  remove("test.db");
+  delete bpm;
+  delete disk_manager;
+}
+
 }  // namespace bustub
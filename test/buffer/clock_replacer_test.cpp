@@ -19,7 +19,7 @@
 
 namespace bustub {
 
-TEST(ClockReplacerTest, DISABLED_SampleTest) {
+TEST(ClockReplacerTest, SampleTest) {
   ClockReplacer clock_replacer(7);
 
   // Scenario: unpin six elements, i.e. add them to the replacer.
@@ -59,4 +59,39 @@ TEST(ClockReplacerTest, DISABLED_SampleTest) {
   EXPECT_EQ(4, value);
 }
 
+TEST(ClockReplacerTest, ConcurrentVictimTest) {
+  const int num_frames = 1000;
+  const int num_threads = 4;
+  ClockReplacer clock_replacer(num_frames);
+  for (int i = 0; i < num_frames; i++) {
+    clock_replacer.Unpin(i);
+  }
+
+  // Every frame must be handed out exactly once, however the victim calls interleave.
+  std::vector<std::vector<frame_id_t>> victims(num_threads);
+  std::vector<std::thread> threads;
+  for (int tid = 0; tid < num_threads; tid++) {
+    threads.emplace_back([&clock_replacer, &victims, tid] {
+      frame_id_t frame_id;
+      while (clock_replacer.Victim(&frame_id)) {
+        victims[tid].push_back(frame_id);
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+
+  std::vector<int> seen(num_frames, 0);
+  for (auto &list : victims) {
+    for (auto frame_id : list) {
+      seen[frame_id]++;
+    }
+  }
+  for (int i = 0; i < num_frames; i++) {
+    EXPECT_EQ(1, seen[i]);
+  }
+  EXPECT_EQ(0, clock_replacer.Size());
+}
+
 }  // namespace bustub
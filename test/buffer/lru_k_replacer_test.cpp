@@ -0,0 +1,173 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// lru_k_replacer_test.cpp
+//
+// Identification: test/buffer/lru_k_replacer_test.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "buffer/buffer_pool_manager_instance.h"
+#include "buffer/lru_k_replacer.h"
+#include "gtest/gtest.h"
+
+namespace bustub {
+
+TEST(LRUKReplacerTest, SampleTest) {
+  LRUKReplacer lru_k_replacer(7, 2);
+
+  // Scenario: frames 1 and 2 are referenced twice, frames 3 to 5 only once (e.g. by a scan).
+  for (frame_id_t frame_id : {1, 2, 3, 1, 2, 4, 5}) {
+    lru_k_replacer.Pin(frame_id);
+  }
+  for (frame_id_t frame_id = 1; frame_id <= 5; ++frame_id) {
+    lru_k_replacer.Unpin(frame_id);
+  }
+  EXPECT_EQ(5, lru_k_replacer.Size());
+  std::vector<frame_id_t> expected_order = {3, 4, 5, 1, 2};
+  EXPECT_EQ(expected_order, lru_k_replacer.GetEvictionOrder());
+
+  // Scenario: frames with a single reference have an infinite backward 2-distance and go first, oldest first.
+  int value;
+  ASSERT_TRUE(lru_k_replacer.Victim(&value));
+  EXPECT_EQ(3, value);
+  ASSERT_TRUE(lru_k_replacer.Victim(&value));
+  EXPECT_EQ(4, value);
+
+  // Scenario: pinned frames are not victims, and pinning a frame again counts as a reference.
+  lru_k_replacer.Pin(1);
+  EXPECT_EQ(2, lru_k_replacer.Size());
+  ASSERT_TRUE(lru_k_replacer.Victim(&value));
+  EXPECT_EQ(5, value);
+  ASSERT_TRUE(lru_k_replacer.Victim(&value));
+  EXPECT_EQ(2, value);
+  EXPECT_FALSE(lru_k_replacer.Victim(&value));
+
+  // Scenario: frame 1 now has the most recent 2nd reference, but it is the only evictable frame left.
+  lru_k_replacer.Unpin(1);
+  ASSERT_TRUE(lru_k_replacer.Victim(&value));
+  EXPECT_EQ(1, value);
+  EXPECT_EQ(0, lru_k_replacer.Size());
+}
+
+TEST(LRUKReplacerTest, CorrelatedReferenceTest) {
+  LRUKReplacer lru_k_replacer(4, 2, 3);
+
+  // Scenario: frame 0 is referenced three times in a burst, which counts as a single reference.
+  // Frame 1 is referenced twice, far apart.
+  lru_k_replacer.Pin(1);
+  lru_k_replacer.Pin(0);
+  lru_k_replacer.Pin(0);
+  lru_k_replacer.Pin(0);
+  lru_k_replacer.Pin(2);
+  lru_k_replacer.Pin(3);
+  lru_k_replacer.Pin(1);
+  lru_k_replacer.Pin(2);
+  lru_k_replacer.Pin(3);
+  for (frame_id_t frame_id = 0; frame_id < 4; ++frame_id) {
+    lru_k_replacer.Unpin(frame_id);
+  }
+
+  // Scenario: frames referenced within the correlated period (2 and 3) are spared while there are others.
+  // Frame 0 still has a single uncorrelated reference, so it goes before frame 1.
+  int value;
+  ASSERT_TRUE(lru_k_replacer.Victim(&value));
+  EXPECT_EQ(0, value);
+  ASSERT_TRUE(lru_k_replacer.Victim(&value));
+  EXPECT_EQ(1, value);
+  ASSERT_TRUE(lru_k_replacer.Victim(&value));
+  EXPECT_EQ(2, value);
+}
+
+TEST(LRUKReplacerTest, RandomOperationsTest) {
+  const size_t num_frames = 1000;
+  LRUKReplacer lru_k_replacer(num_frames, 3, 50);
+  std::mt19937 rng(15445);
+  std::vector<bool> evictable(num_frames);
+  size_t num_evictable = 0;
+
+  // Scenario: whatever happened before, the victim is the head of the eviction order and the sizes agree.
+  int value;
+  for (int i = 0; i < 20000; ++i) {
+    auto frame_id = static_cast<frame_id_t>(rng() % num_frames);
+    switch (rng() % 4) {
+      case 0:
+        lru_k_replacer.Pin(frame_id);
+        num_evictable -= evictable[frame_id] ? 1 : 0;
+        evictable[frame_id] = false;
+        break;
+      case 1:
+        lru_k_replacer.Unpin(frame_id);
+        num_evictable += evictable[frame_id] ? 0 : 1;
+        evictable[frame_id] = true;
+        break;
+      case 2:
+        lru_k_replacer.Remove(frame_id);
+        num_evictable -= evictable[frame_id] ? 1 : 0;
+        evictable[frame_id] = false;
+        break;
+      default: {
+        std::vector<frame_id_t> order = lru_k_replacer.GetEvictionOrder();
+        ASSERT_EQ(num_evictable, order.size());
+        ASSERT_EQ(num_evictable > 0, lru_k_replacer.Victim(&value));
+        if (num_evictable > 0) {
+          ASSERT_EQ(order.front(), value);
+          evictable[value] = false;
+          num_evictable--;
+        }
+        break;
+      }
+    }
+    ASSERT_EQ(num_evictable, lru_k_replacer.Size());
+  }
+}
+
+// NOLINTNEXTLINE
+TEST(LRUKReplacerTest, ScanResistanceTest) {
+  const std::string db_name = "test.db";
+  const size_t buffer_pool_size = 10;
+
+  BufferPoolOptions options;
+  options.replacer_type_ = ReplacerType::LRU_K;
+  options.lru_k_ = 2;
+  auto *disk_manager = new DiskManager(db_name);
+  auto *bpm = new BufferPoolManagerInstance(buffer_pool_size, disk_manager, nullptr, options);
+
+  // Scenario: a hot working set of five pages, each referenced twice.
+  page_id_t page_id;
+  for (size_t i = 0; i < 5; ++i) {
+    ASSERT_NE(nullptr, bpm->NewPage(&page_id));
+    snprintf(bpm->FetchPage(page_id)->GetData(), PAGE_SIZE, "hot %d", page_id);
+    EXPECT_TRUE(bpm->UnpinPage(page_id, true));
+    EXPECT_TRUE(bpm->UnpinPage(page_id, true));
+  }
+  // Scenario: a scan creates three times as many pages as fit in the pool, touching each once.
+  for (size_t i = 0; i < 3 * buffer_pool_size; ++i) {
+    ASSERT_NE(nullptr, bpm->NewPage(&page_id));
+    EXPECT_TRUE(bpm->UnpinPage(page_id, false));
+  }
+  // Scenario: the hot pages survived the scan. Close the file first, so only resident pages read back correctly.
+  disk_manager->ShutDown();
+  char expected[PAGE_SIZE];
+  for (page_id_t hot = 0; hot < 5; ++hot) {
+    auto *page = bpm->FetchPage(hot);
+    ASSERT_NE(nullptr, page);
+    snprintf(expected, PAGE_SIZE, "hot %d", hot);
+    EXPECT_EQ(0, strcmp(page->GetData(), expected));
+    EXPECT_TRUE(bpm->UnpinPage(hot, false));
+  }
+
+  remove("test.db");
+  delete bpm;
+  delete disk_manager;
+}
+
+}  // namespace bustub
@@ -10,8 +10,14 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include <chrono>  // NOLINT
 #include <cstdio>
+#include <iostream>
+#include <list>
+#include <mutex>  // NOLINT
+#include <random>
 #include <thread>  // NOLINT
+#include <unordered_map>
 #include <vector>
 
 #include "buffer/lru_replacer.h"
@@ -59,4 +65,100 @@ TEST(LRUReplacerTest, SampleTest) {
   EXPECT_EQ(4, value);
 }
 
+TEST(LRUReplacerTest, EvictionOrderTest) {
+  LRUReplacer lru_replacer(7);
+
+  // Scenario: frames leave from the middle and both ends of the list, and come back as the most recent.
+  for (frame_id_t frame_id = 0; frame_id < 7; ++frame_id) {
+    lru_replacer.Unpin(frame_id);
+  }
+  lru_replacer.Pin(3);
+  lru_replacer.Pin(0);
+  lru_replacer.Pin(6);
+  lru_replacer.Unpin(0);
+  std::vector<frame_id_t> expected = {1, 2, 4, 5, 0};
+  EXPECT_EQ(expected, lru_replacer.GetEvictionOrder());
+  EXPECT_EQ(5, lru_replacer.Size());
+
+  int value;
+  for (auto frame_id : expected) {
+    ASSERT_TRUE(lru_replacer.Victim(&value));
+    EXPECT_EQ(frame_id, value);
+  }
+  EXPECT_FALSE(lru_replacer.Victim(&value));
+  EXPECT_EQ(0, lru_replacer.Size());
+}
+
+/** The list and hash map LRUReplacer that the array-based one replaced, kept as the benchmark's baseline. */
+class ListLRUReplacer {
+ public:
+  auto Victim(frame_id_t *frame_id) -> bool {
+    std::lock_guard<std::mutex> lock(lock_);
+    if (list_.empty()) {
+      return false;
+    }
+    *frame_id = list_.back();
+    mp_.erase(*frame_id);
+    list_.pop_back();
+    return true;
+  }
+
+  void Pin(frame_id_t frame_id) {
+    std::lock_guard<std::mutex> lock(lock_);
+    auto iter = mp_.find(frame_id);
+    if (iter != mp_.end()) {
+      list_.erase(iter->second);
+      mp_.erase(iter);
+    }
+  }
+
+  void Unpin(frame_id_t frame_id) {
+    std::lock_guard<std::mutex> lock(lock_);
+    if (mp_.count(frame_id) == 0) {
+      list_.push_front(frame_id);
+      mp_[frame_id] = list_.begin();
+    }
+  }
+
+ private:
+  std::unordered_map<frame_id_t, std::list<frame_id_t>::iterator> mp_;
+  std::list<frame_id_t> list_;
+  std::mutex lock_;
+};
+
+/** @return Pin/Unpin/Victim operations per second of replacer on a buffer-pool-like access pattern */
+template <class ReplacerT>
+auto MeasureReplacer(ReplacerT *replacer, size_t num_frames) -> uint64_t {
+  const size_t num_ops = 4000000;
+  for (size_t i = 0; i < num_frames; ++i) {
+    replacer->Unpin(static_cast<frame_id_t>(i));
+  }
+  std::default_random_engine rng(0);
+  std::uniform_int_distribution<frame_id_t> dist(0, num_frames - 1);
+  auto start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < num_ops; i += 3) {
+    // A hit pins and unpins a frame; every so often a miss evicts one and reuses its frame.
+    frame_id_t frame_id = dist(rng);
+    if (i % 30 == 0) {
+      replacer->Victim(&frame_id);
+    } else {
+      replacer->Pin(frame_id);
+    }
+    replacer->Unpin(frame_id);
+  }
+  auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+  return num_ops * 1000000 / std::max<int64_t>(elapsed.count(), 1);
+}
+
+// NOLINTNEXTLINE
+TEST(LRUReplacerTest, DISABLED_ThroughputBenchmark) {
+  for (size_t num_frames : {64, 4096, 262144}) {
+    ListLRUReplacer list_replacer;
+    LRUReplacer array_replacer(num_frames);
+    uint64_t list_ops = MeasureReplacer(&list_replacer, num_frames);
+    uint64_t array_ops = MeasureReplacer(&array_replacer, num_frames);
+    std::cout << num_frames << " frames: list " << list_ops << " ops/s, array " << array_ops << " ops/s" << std::endl;
+  }
+}
+
 }  // namespace bustub
@@ -11,9 +11,15 @@
 //===----------------------------------------------------------------------===//
 
 #include "buffer/parallel_buffer_pool_manager.h"
+#include <atomic>
+#include <chrono>  // NOLINT
 #include <cstdio>
+#include <cstring>
 #include <random>
+#include <set>
 #include <string>
+#include <thread>  // NOLINT
+#include <vector>
 #include "buffer/buffer_pool_manager.h"
 #include "gtest/gtest.h"
 
@@ -151,4 +157,395 @@ TEST(ParallelBufferPoolManagerTest, SampleTest) {
   delete disk_manager;
 }
 
+// NOLINTNEXTLINE
+TEST(ParallelBufferPoolManagerTest, FreeFrameRoutingTest) {
+  const std::string db_name = "test.db";
+  const size_t buffer_pool_size = 4;
+  const size_t num_instances = 2;
+
+  auto *disk_manager = new DiskManager(db_name);
+  auto *bpm = new ParallelBufferPoolManager(num_instances, buffer_pool_size, disk_manager);
+
+  // Fill both instances, then free up instance 1 only.
+  std::vector<page_id_t> page_ids;
+  page_id_t page_id;
+  for (size_t i = 0; i < buffer_pool_size * num_instances; ++i) {
+    ASSERT_NE(nullptr, bpm->NewPage(&page_id));
+    page_ids.push_back(page_id);
+  }
+  for (auto id : page_ids) {
+    EXPECT_TRUE(bpm->UnpinPage(id, false));
+    if (id % num_instances == 1) {
+      EXPECT_TRUE(bpm->DeletePage(id));
+    }
+  }
+
+  // New pages go where frames are free, rather than evicting instance 0's pages in turn.
+  for (size_t i = 0; i < buffer_pool_size; ++i) {
+    ASSERT_NE(nullptr, bpm->NewPage(&page_id));
+    EXPECT_EQ(1, page_id % num_instances);
+    EXPECT_TRUE(bpm->UnpinPage(page_id, false));
+  }
+  BufferPoolCounters counters = bpm->GetCounters();
+  EXPECT_EQ(0, counters.evictions_);
+  EXPECT_EQ(buffer_pool_size * (num_instances + 1), counters.new_pages_);
+
+  // Once no instance has free frames, pages are created round robin again, evicting as needed.
+  std::set<page_id_t> instances;
+  for (size_t i = 0; i < num_instances; ++i) {
+    ASSERT_NE(nullptr, bpm->NewPage(&page_id));
+    instances.insert(page_id % num_instances);
+    EXPECT_TRUE(bpm->UnpinPage(page_id, false));
+  }
+  EXPECT_EQ(num_instances, instances.size());
+
+  disk_manager->ShutDown();
+  remove("test.db");
+
+  delete bpm;
+  delete disk_manager;
+}
+
+// NOLINTNEXTLINE
+TEST(ParallelBufferPoolManagerTest, ConcurrentNewPageTest) {
+  const std::string db_name = "test.db";
+  const size_t buffer_pool_size = 8;
+  const size_t num_instances = 4;
+  const size_t num_threads = 8;
+  const size_t pages_per_thread = 200;
+
+  auto *disk_manager = new DiskManager(db_name);
+  auto *bpm = new ParallelBufferPoolManager(num_instances, buffer_pool_size, disk_manager);
+
+  std::vector<std::vector<page_id_t>> thread_page_ids(num_threads);
+  std::vector<std::thread> threads;
+  for (size_t t = 0; t < num_threads; ++t) {
+    threads.emplace_back([&, t] {
+      page_id_t page_id;
+      for (size_t i = 0; i < pages_per_thread; ++i) {
+        Page *page = bpm->NewPage(&page_id);
+        if (page == nullptr) {
+          continue;
+        }
+        thread_page_ids[t].push_back(page_id);
+        EXPECT_TRUE(bpm->UnpinPage(page_id, false));
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+
+  // Every page id is handed out once, and with at most num_threads pages pinned at a time no allocation fails.
+  std::set<page_id_t> page_ids;
+  for (auto &ids : thread_page_ids) {
+    EXPECT_EQ(pages_per_thread, ids.size());
+    page_ids.insert(ids.begin(), ids.end());
+  }
+  EXPECT_EQ(num_threads * pages_per_thread, page_ids.size());
+
+  disk_manager->ShutDown();
+  remove("test.db");
+
+  delete bpm;
+  delete disk_manager;
+}
+
+// NOLINTNEXTLINE
+TEST(ParallelBufferPoolManagerTest, FlushAllDirtyPagesTest) {
+  const std::string db_name = "test.db";
+  const size_t buffer_pool_size = 5;
+  const size_t num_instances = 4;
+
+  auto *disk_manager = new DiskManager(db_name);
+  auto *bpm = new ParallelBufferPoolManager(num_instances, buffer_pool_size, disk_manager);
+
+  std::vector<page_id_t> page_ids(buffer_pool_size * num_instances);
+  for (auto &page_id : page_ids) {
+    auto *page = bpm->NewPage(&page_id);
+    ASSERT_NE(nullptr, page);
+    snprintf(page->GetData(), PAGE_SIZE, "page %d", page_id);
+    EXPECT_TRUE(bpm->UnpinPage(page_id, true));
+  }
+
+  // Consecutive page ids live in different instances, but are still written as one run.
+  FlushStats stats = bpm->FlushAllDirtyPages();
+  EXPECT_EQ(page_ids.size(), stats.pages_written_);
+  EXPECT_EQ(page_ids.size() * PAGE_SIZE, stats.bytes_written_);
+  EXPECT_EQ(1, stats.writes_);
+  for (auto page_id : page_ids) {
+    char data[PAGE_SIZE];
+    char expected[PAGE_SIZE];
+    disk_manager->ReadPage(page_id, data);
+    snprintf(expected, PAGE_SIZE, "page %d", page_id);
+    EXPECT_EQ(0, strcmp(data, expected));
+  }
+
+  // FlushAllPages() leaves the instances in place.
+  bpm->FlushAllPages();
+  EXPECT_EQ(0, bpm->FlushAllDirtyPages().pages_written_);
+  page_id_t page_id;
+  ASSERT_NE(nullptr, bpm->NewPage(&page_id));
+  EXPECT_TRUE(bpm->UnpinPage(page_id, false));
+
+  disk_manager->ShutDown();
+  remove("test.db");
+
+  delete bpm;
+  delete disk_manager;
+}
+
+// NOLINTNEXTLINE
+TEST(ParallelBufferPoolManagerTest, ResizeTest) {
+  const std::string db_name = "test.db";
+  const size_t buffer_pool_size = 5;
+  const size_t num_instances = 2;
+
+  auto *disk_manager = new DiskManager(db_name);
+  auto *bpm = new ParallelBufferPoolManager(num_instances, buffer_pool_size, disk_manager);
+
+  std::set<page_id_t> page_ids;
+  auto new_page = [&]() -> page_id_t {
+    page_id_t page_id;
+    Page *page = bpm->NewPage(&page_id);
+    EXPECT_NE(nullptr, page);
+    EXPECT_EQ(0, page_ids.count(page_id));
+    page_ids.insert(page_id);
+    snprintf(page->GetData(), PAGE_SIZE, "page %d", page_id);
+    EXPECT_TRUE(bpm->UnpinPage(page_id, true));
+    return page_id;
+  };
+  auto check_page = [&](page_id_t page_id) {
+    Page *page = bpm->FetchPage(page_id);
+    ASSERT_NE(nullptr, page);
+    char expected[PAGE_SIZE];
+    snprintf(expected, PAGE_SIZE, "page %d", page_id);
+    EXPECT_STREQ(expected, page->GetData());
+    EXPECT_TRUE(bpm->UnpinPage(page_id, false));
+  };
+
+  for (size_t i = 0; i < buffer_pool_size * num_instances; ++i) {
+    new_page();
+  }
+
+  // Growing keeps the cache warm, and the new frames take new pages without evicting anything.
+  EXPECT_TRUE(bpm->Resize(4));
+  EXPECT_EQ(4, bpm->GetNumInstances());
+  EXPECT_EQ(4 * buffer_pool_size, bpm->GetPoolSize());
+  for (auto page_id : page_ids) {
+    check_page(page_id);
+  }
+  std::vector<page_id_t> new_page_ids;
+  for (size_t i = 0; i < buffer_pool_size * 2; ++i) {
+    new_page_ids.push_back(new_page());
+  }
+  BufferPoolCounters counters = bpm->GetCounters();
+  EXPECT_EQ(0, counters.fetch_misses_);
+  EXPECT_EQ(0, counters.evictions_);
+
+  // An instance cannot be removed while its pages are pinned.
+  for (auto page_id : new_page_ids) {
+    ASSERT_NE(nullptr, bpm->FetchPage(page_id));
+  }
+  EXPECT_FALSE(bpm->Resize(1, std::chrono::milliseconds(10)));
+  EXPECT_EQ(4, bpm->GetNumInstances());
+  for (auto page_id : new_page_ids) {
+    EXPECT_TRUE(bpm->UnpinPage(page_id, false));
+  }
+
+  // Once they are unpinned, shrinking writes them back, and the remaining instance reads them in again.
+  EXPECT_TRUE(bpm->Resize(1));
+  EXPECT_EQ(1, bpm->GetNumInstances());
+  EXPECT_EQ(buffer_pool_size, bpm->GetPoolSize());
+  for (auto page_id : page_ids) {
+    check_page(page_id);
+  }
+  for (size_t i = 0; i < buffer_pool_size; ++i) {
+    new_page();
+  }
+  EXPECT_EQ(buffer_pool_size * 5, bpm->GetCounters().new_pages_);
+
+  disk_manager->ShutDown();
+  remove("test.db");
+
+  delete bpm;
+  delete disk_manager;
+}
+
+// NOLINTNEXTLINE
+TEST(ParallelBufferPoolManagerTest, ConcurrentResizeTest) {
+  const std::string db_name = "test.db";
+  const size_t buffer_pool_size = 8;
+  const size_t num_instances = 2;
+  const size_t num_threads = 4;
+  const size_t num_pages = 32;
+
+  auto *disk_manager = new DiskManager(db_name);
+  auto *bpm = new ParallelBufferPoolManager(num_instances, buffer_pool_size, disk_manager);
+
+  std::vector<page_id_t> page_ids;
+  for (size_t i = 0; i < num_pages; ++i) {
+    page_id_t page_id;
+    Page *page = bpm->NewPage(&page_id);
+    ASSERT_NE(nullptr, page);
+    snprintf(page->GetData(), PAGE_SIZE, "page %d", page_id);
+    EXPECT_TRUE(bpm->UnpinPage(page_id, true));
+    page_ids.push_back(page_id);
+  }
+
+  // Readers check pages and writers rewrite them, while new pages keep being created, across resizes.
+  std::atomic<bool> stop{false};
+  std::vector<std::vector<page_id_t>> thread_page_ids(num_threads);
+  std::vector<std::thread> threads;
+  for (size_t t = 0; t < num_threads; ++t) {
+    threads.emplace_back([&, t] {
+      std::mt19937 rng(t);
+      for (size_t i = 0; !stop; ++i) {
+        page_id_t page_id;
+        if (i % 16 == 0) {
+          Page *page = bpm->NewPage(&page_id);
+          ASSERT_NE(nullptr, page);
+          snprintf(page->GetData(), PAGE_SIZE, "page %d", page_id);
+          EXPECT_TRUE(bpm->UnpinPage(page_id, true));
+          thread_page_ids[t].push_back(page_id);
+          continue;
+        }
+        page_id = page_ids[rng() % page_ids.size()];
+        Page *page = bpm->FetchPage(page_id);
+        ASSERT_NE(nullptr, page);
+        char expected[PAGE_SIZE];
+        snprintf(expected, PAGE_SIZE, "page %d", page_id);
+        bool is_dirty = i % 2 == 0;
+        if (is_dirty) {
+          page->WLatch();
+          snprintf(page->GetData(), PAGE_SIZE, "page %d", page_id);
+          page->WUnlatch();
+        } else {
+          page->RLatch();
+          EXPECT_STREQ(expected, page->GetData());
+          page->RUnlatch();
+        }
+        EXPECT_TRUE(bpm->UnpinPage(page_id, is_dirty));
+      }
+    });
+  }
+  for (size_t num_instances : {4, 1, 3, 2, 1, 4, 2}) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    EXPECT_TRUE(bpm->Resize(num_instances));
+  }
+  stop = true;
+  for (auto &thread : threads) {
+    thread.join();
+  }
+
+  // No page id was handed out twice, and no write got lost.
+  std::set<page_id_t> all_page_ids(page_ids.begin(), page_ids.end());
+  size_t total_pages = page_ids.size();
+  for (auto &ids : thread_page_ids) {
+    all_page_ids.insert(ids.begin(), ids.end());
+    total_pages += ids.size();
+  }
+  EXPECT_EQ(total_pages, all_page_ids.size());
+  for (auto page_id : all_page_ids) {
+    Page *page = bpm->FetchPage(page_id);
+    ASSERT_NE(nullptr, page);
+    char expected[PAGE_SIZE];
+    snprintf(expected, PAGE_SIZE, "page %d", page_id);
+    EXPECT_STREQ(expected, page->GetData());
+    EXPECT_TRUE(bpm->UnpinPage(page_id, false));
+  }
+
+  disk_manager->ShutDown();
+  remove("test.db");
+
+  delete bpm;
+  delete disk_manager;
+}
+
+// NOLINTNEXTLINE
+TEST(ParallelBufferPoolManagerTest, WarmupTest) {
+  const std::string db_name = "test.db";
+  const std::string warmup_file = "test.warmup";
+  const size_t buffer_pool_size = 5;
+  const size_t num_instances = 2;
+
+  auto *disk_manager = new DiskManager(db_name);
+  auto *bpm = new ParallelBufferPoolManager(num_instances, buffer_pool_size, disk_manager);
+
+  std::vector<page_id_t> page_ids;
+  for (size_t i = 0; i < buffer_pool_size * num_instances; ++i) {
+    page_id_t page_id;
+    Page *page = bpm->NewPage(&page_id);
+    ASSERT_NE(nullptr, page);
+    snprintf(page->GetData(), PAGE_SIZE, "page %d", page_id);
+    EXPECT_TRUE(bpm->UnpinPage(page_id, true));
+    page_ids.push_back(page_id);
+  }
+  bpm->FlushAllPages();
+  EXPECT_TRUE(bpm->DumpResidentPages(warmup_file));
+  delete bpm;
+
+  // Each instance preloads its own share of the pages.
+  BufferPoolOptions options;
+  options.warmup_file_ = warmup_file;
+  bpm = new ParallelBufferPoolManager(num_instances, buffer_pool_size, disk_manager, nullptr, options);
+  for (int i = 0; i < 1000 && bpm->GetCounters().preloaded_pages_ < page_ids.size(); ++i) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  EXPECT_EQ(page_ids.size(), bpm->GetCounters().preloaded_pages_);
+  for (auto page_id : page_ids) {
+    Page *page = bpm->FetchPage(page_id);
+    ASSERT_NE(nullptr, page);
+    char expected[PAGE_SIZE];
+    snprintf(expected, PAGE_SIZE, "page %d", page_id);
+    EXPECT_STREQ(expected, page->GetData());
+    EXPECT_TRUE(bpm->UnpinPage(page_id, false));
+  }
+  EXPECT_EQ(0, bpm->GetCounters().fetch_misses_);
+
+  disk_manager->ShutDown();
+  remove("test.db");
+
+  delete bpm;
+  delete disk_manager;
+  remove(warmup_file.c_str());
+}
+
+// NOLINTNEXTLINE
+TEST(ParallelBufferPoolManagerTest, FreePageReuseTest) {
+  const std::string db_name = "test.db";
+  const size_t num_instances = 2;
+  const size_t pool_size = 10;
+
+  remove("test.db");
+  auto *disk_manager = new DiskManager(db_name);
+  auto *bpm = new ParallelBufferPoolManager(num_instances, pool_size, disk_manager);
+
+  page_id_t page_id;
+  for (int i = 0; i < 6; ++i) {
+    ASSERT_NE(nullptr, bpm->NewPage(&page_id));
+    EXPECT_TRUE(bpm->UnpinPage(page_id, false));
+  }
+  // One deallocated page in the stripe of each instance.
+  EXPECT_TRUE(bpm->DeletePage(2));
+  EXPECT_TRUE(bpm->DeletePage(3));
+
+  // Each instance takes back the page of its own stripe, whichever one gets the request.
+  std::set<page_id_t> new_page_ids;
+  for (int i = 0; i < 4; ++i) {
+    ASSERT_NE(nullptr, bpm->NewPage(&page_id));
+    new_page_ids.insert(page_id);
+    EXPECT_TRUE(bpm->UnpinPage(page_id, false));
+  }
+  EXPECT_EQ((std::set<page_id_t>{2, 3, 6, 7}), new_page_ids);
+  EXPECT_EQ(0, disk_manager->GetNumFreePages());
+
+  disk_manager->ShutDown();
+  remove("test.db");
+  remove("test.fpm");
+
+  delete bpm;
+  delete disk_manager;
+}
+
 }  // namespace bustub
@@ -0,0 +1,214 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// log_manager_test.cpp
+//
+// Identification: test/recovery/log_manager_test.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include <cstdio>
+#include <cstring>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "common/config.h"
+#include "gtest/gtest.h"
+#include "logging/common.h"
+#include "recovery/log_manager.h"
+#include "storage/disk/disk_manager.h"
+
+namespace bustub {
+
+class LogManagerTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    remove("test.db");
+    remove("test.log");
+    remove("test.log.000000");
+  }
+
+  void TearDown() override {
+    remove("test.db");
+    remove("test.log");
+    remove("test.log.000000");
+  }
+};
+
+// NOLINTNEXTLINE
+TEST_F(LogManagerTest, AppendAndReadBackTest) {
+  DiskManager disk_manager("test.db");
+  LogManager log_manager(&disk_manager);
+
+  Column col1{"a", TypeId::VARCHAR, 20};
+  Column col2{"b", TypeId::SMALLINT};
+  Schema schema{std::vector<Column>{col1, col2}};
+  Tuple tuple = ConstructTuple(&schema);
+  RID rid(3, 7);
+
+  // Without a flush thread, Flush() writes the buffer itself.
+  LogRecord begin(0, INVALID_LSN, LogRecordType::BEGIN);
+  lsn_t begin_lsn = log_manager.AppendLogRecord(&begin);
+  LogRecord insert(0, begin_lsn, LogRecordType::INSERT, rid, tuple);
+  lsn_t insert_lsn = log_manager.AppendLogRecord(&insert);
+  EXPECT_EQ(0, begin_lsn);
+  EXPECT_EQ(1, insert_lsn);
+  EXPECT_EQ(INVALID_LSN, log_manager.GetPersistentLSN());
+  log_manager.Flush(insert_lsn);
+  EXPECT_EQ(insert_lsn, log_manager.GetPersistentLSN());
+  EXPECT_EQ(1, disk_manager.GetNumFlushes());
+
+  int size = begin.GetSize() + insert.GetSize();
+  std::vector<char> data(size);
+  ASSERT_TRUE(disk_manager.ReadLog(data.data(), size, 0));
+  const char *pos = data.data() + begin.GetSize();
+  int32_t record_size;
+  lsn_t lsn;
+  memcpy(&record_size, pos, sizeof(int32_t));
+  memcpy(&lsn, pos + sizeof(int32_t), sizeof(lsn_t));
+  EXPECT_EQ(insert.GetSize(), record_size);
+  EXPECT_EQ(insert_lsn, lsn);
+  RID read_rid;
+  memcpy(&read_rid, pos + 20, sizeof(RID));
+  EXPECT_EQ(rid, read_rid);
+  Tuple read_tuple;
+  read_tuple.DeserializeFrom(pos + 20 + sizeof(RID));
+  EXPECT_EQ(0, memcmp(tuple.GetData(), read_tuple.GetData(), tuple.GetLength()));
+  EXPECT_FALSE(disk_manager.ReadLog(data.data(), 1, size));
+
+  disk_manager.ShutDown();
+}
+
+// NOLINTNEXTLINE
+TEST_F(LogManagerTest, GroupCommitTest) {
+  DiskManager disk_manager("test.db");
+  LogManager log_manager(&disk_manager);
+  log_manager.RunFlushThread();
+  EXPECT_TRUE(enable_logging);
+
+  const int num_threads = 16;
+  const int commits_per_thread = 50;
+  std::vector<std::thread> threads;
+  for (int tid = 0; tid < num_threads; ++tid) {
+    threads.emplace_back([&, tid] {
+      for (int i = 0; i < commits_per_thread; ++i) {
+        LogRecord begin(tid, INVALID_LSN, LogRecordType::BEGIN);
+        lsn_t prev_lsn = log_manager.AppendLogRecord(&begin);
+        LogRecord commit(tid, prev_lsn, LogRecordType::COMMIT);
+        lsn_t lsn = log_manager.AppendLogRecord(&commit);
+        log_manager.Flush(lsn);
+        // A commit returns only once its record is durable.
+        EXPECT_LE(lsn, log_manager.GetPersistentLSN());
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+
+  const int num_commits = num_threads * commits_per_thread;
+  EXPECT_EQ(2 * num_commits - 1, log_manager.GetPersistentLSN());
+  // Commits that wait at the same time share a write and its sync.
+  EXPECT_LT(disk_manager.GetNumFlushes(), num_commits);
+  std::cout << num_commits << " commits took " << disk_manager.GetNumFlushes() << " log flushes" << std::endl;
+
+  log_manager.StopFlushThread();
+  EXPECT_FALSE(enable_logging);
+  // Every record is on disk, in LSN order.
+  std::vector<char> data(2 * num_commits * 20);
+  ASSERT_TRUE(disk_manager.ReadLog(data.data(), data.size(), 0));
+  for (int i = 0; i < 2 * num_commits; ++i) {
+    lsn_t lsn;
+    memcpy(&lsn, data.data() + i * 20 + sizeof(int32_t), sizeof(lsn_t));
+    ASSERT_EQ(i, lsn);
+  }
+  EXPECT_FALSE(disk_manager.ReadLog(data.data(), 1, data.size()));
+
+  disk_manager.ShutDown();
+}
+
+// NOLINTNEXTLINE
+TEST_F(LogManagerTest, FullBufferTest) {
+  DiskManager disk_manager("test.db");
+  LogManager log_manager(&disk_manager);
+  log_manager.RunFlushThread();
+
+  // Far more than fits into the buffer: appenders wait for the flush thread to make room.
+  const int num_threads = 4;
+  const int records_per_thread = 4 * LOG_BUFFER_SIZE / 20 / num_threads;
+  std::vector<std::thread> threads;
+  for (int tid = 0; tid < num_threads; ++tid) {
+    threads.emplace_back([&, tid] {
+      for (int i = 0; i < records_per_thread; ++i) {
+        LogRecord record(tid, INVALID_LSN, LogRecordType::BEGIN);
+        log_manager.AppendLogRecord(&record);
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  log_manager.StopFlushThread();
+
+  EXPECT_EQ(num_threads * records_per_thread - 1, log_manager.GetPersistentLSN());
+  EXPECT_GE(disk_manager.GetNumFlushes(), 4);
+  std::vector<char> data(20);
+  EXPECT_TRUE(disk_manager.ReadLog(data.data(), 20, (num_threads * records_per_thread - 1) * 20));
+  EXPECT_FALSE(disk_manager.ReadLog(data.data(), 20, num_threads * records_per_thread * 20));
+
+  disk_manager.ShutDown();
+}
+
+// NOLINTNEXTLINE
+TEST_F(LogManagerTest, ConcurrentAppendTest) {
+  DiskManager disk_manager("test.db");
+  LogManager log_manager(&disk_manager);
+  log_manager.RunFlushThread();
+
+  Column col1{"a", TypeId::VARCHAR, 20};
+  Column col2{"b", TypeId::SMALLINT};
+  Schema schema{std::vector<Column>{col1, col2}};
+
+  // Records of different sizes are copied in side by side; the log must still hold them back to back, in LSN order.
+  const int num_threads = 8;
+  const int records_per_thread = 2000;
+  std::vector<std::thread> threads;
+  for (int tid = 0; tid < num_threads; ++tid) {
+    threads.emplace_back([&, tid] {
+      for (int i = 0; i < records_per_thread; ++i) {
+        Tuple tuple = ConstructTuple(&schema);
+        LogRecord record(tid, INVALID_LSN, LogRecordType::INSERT, RID(tid, i), tuple);
+        lsn_t lsn = log_manager.AppendLogRecord(&record);
+        EXPECT_EQ(lsn, record.GetLSN());
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  log_manager.StopFlushThread();
+
+  const int num_records = num_threads * records_per_thread;
+  EXPECT_EQ(num_records, log_manager.GetNextLSN());
+  EXPECT_EQ(num_records - 1, log_manager.GetPersistentLSN());
+  std::vector<char> header(20);
+  int64_t offset = 0;
+  for (int i = 0; i < num_records; ++i) {
+    ASSERT_TRUE(disk_manager.ReadLog(header.data(), header.size(), offset));
+    int32_t size;
+    lsn_t lsn;
+    memcpy(&size, header.data(), sizeof(int32_t));
+    memcpy(&lsn, header.data() + sizeof(int32_t), sizeof(lsn_t));
+    ASSERT_EQ(i, lsn);
+    ASSERT_GT(size, 20);
+    offset += size;
+  }
+  EXPECT_FALSE(disk_manager.ReadLog(header.data(), 1, offset));
+
+  disk_manager.ShutDown();
+}
+
+}  // namespace bustub
@@ -23,6 +23,7 @@
 #include "storage/table/table_heap.h"
 #include "storage/table/table_iterator.h"
 #include "storage/table/tuple.h"
+#include "type/value_factory.h"
 
 namespace bustub {
 
@@ -32,6 +33,8 @@ class RecoveryTest : public ::testing::Test {
   void SetUp() override {
     remove("test.db");
     remove("test.log");
+    remove("test.log.000000");
+    remove("test.ckpt");
   }
 
   // This function is called after every test.
@@ -39,11 +42,13 @@ class RecoveryTest : public ::testing::Test {
     LOG_INFO("Tearing down the system..");
     remove("test.db");
     remove("test.log");
+    remove("test.log.000000");
+    remove("test.ckpt");
   };
 };
 
 // NOLINTNEXTLINE
-TEST_F(RecoveryTest, DISABLED_RedoTest) {
+TEST_F(RecoveryTest, RedoTest) {
   BustubInstance *bustub_instance = new BustubInstance("test.db");
 
   ASSERT_FALSE(enable_logging);
@@ -101,7 +106,8 @@ TEST_F(RecoveryTest, DISABLED_RedoTest) {
   delete txn;
 
   LOG_INFO("Begin recovery");
-  auto *log_recovery = new LogRecovery(bustub_instance->disk_manager_, bustub_instance->buffer_pool_manager_);
+  auto *log_recovery = new LogRecovery(bustub_instance->disk_manager_, bustub_instance->buffer_pool_manager_,
+                                       bustub_instance->log_manager_);
 
   ASSERT_FALSE(enable_logging);
 
@@ -132,7 +138,7 @@ TEST_F(RecoveryTest, DISABLED_RedoTest) {
 }
 
 // NOLINTNEXTLINE
-TEST_F(RecoveryTest, DISABLED_UndoTest) {
+TEST_F(RecoveryTest, UndoTest) {
   BustubInstance *bustub_instance = new BustubInstance("test.db");
 
   ASSERT_FALSE(enable_logging);
@@ -185,7 +191,8 @@ TEST_F(RecoveryTest, DISABLED_UndoTest) {
   delete txn;
 
   LOG_INFO("Recovery started..");
-  auto *log_recovery = new LogRecovery(bustub_instance->disk_manager_, bustub_instance->buffer_pool_manager_);
+  auto *log_recovery = new LogRecovery(bustub_instance->disk_manager_, bustub_instance->buffer_pool_manager_,
+                                       bustub_instance->log_manager_);
 
   ASSERT_FALSE(enable_logging);
 
@@ -211,7 +218,7 @@ TEST_F(RecoveryTest, DISABLED_UndoTest) {
 }
 
 // NOLINTNEXTLINE
-TEST_F(RecoveryTest, DISABLED_CheckpointTest) {
+TEST_F(RecoveryTest, CheckpointTest) {
   BustubInstance *bustub_instance = new BustubInstance("test.db");
 
   EXPECT_FALSE(enable_logging);
@@ -314,4 +321,78 @@ TEST_F(RecoveryTest, DISABLED_CheckpointTest) {
   LOG_INFO("Shutdown System");
   delete bustub_instance;
 }
+
+// NOLINTNEXTLINE
+TEST_F(RecoveryTest, RecoverTwiceTest) {
+  Column col1{"a", TypeId::VARCHAR, 20};
+  Column col2{"b", TypeId::SMALLINT};
+  std::vector<Column> cols{col1, col2};
+  Schema schema{cols};
+  // Tuples that differ for sure, so that each check can only pass with the right one.
+  auto make_tuple = [&schema](const std::string &a, int16_t b) {
+    return Tuple({ValueFactory::GetVarcharValue(a), ValueFactory::GetSmallIntValue(b)}, &schema);
+  };
+  const Tuple tuple = make_tuple("first run", 1);
+  const Tuple tuple1 = make_tuple("second run", 2);
+  const Tuple tuple2 = make_tuple("second run, new", 3);
+  RID rid;
+  RID rid1;
+  RID uncommitted_rid;
+
+  auto *bustub_instance = new BustubInstance("test.db");
+  bustub_instance->log_manager_->RunFlushThread();
+  Transaction *txn = bustub_instance->transaction_manager_->Begin();
+  auto *test_table = new TableHeap(bustub_instance->buffer_pool_manager_, bustub_instance->lock_manager_,
+                                   bustub_instance->log_manager_, txn);
+  page_id_t first_page_id = test_table->GetFirstPageId();
+  ASSERT_TRUE(test_table->InsertTuple(tuple, &rid, txn));
+  bustub_instance->transaction_manager_->Commit(txn);
+  delete txn;
+  delete test_table;
+  LOG_INFO("System crash after commit");
+  delete bustub_instance;
+
+  LOG_INFO("System restarted, recovery and a second run");
+  bustub_instance = new BustubInstance("test.db");
+  bustub_instance->Recover();
+  lsn_t next_lsn = bustub_instance->log_manager_->GetNextLSN();
+  EXPECT_GT(next_lsn, 0);
+  // The recovered page goes to disk with the LSN of the first run, which the second run has to go past.
+  bustub_instance->buffer_pool_manager_->FlushAllPages();
+  bustub_instance->log_manager_->RunFlushThread();
+  txn = bustub_instance->transaction_manager_->Begin();
+  EXPECT_EQ(next_lsn, txn->GetPrevLSN());
+  test_table = new TableHeap(bustub_instance->buffer_pool_manager_, bustub_instance->lock_manager_,
+                             bustub_instance->log_manager_, first_page_id);
+  ASSERT_TRUE(test_table->UpdateTuple(tuple1, rid, txn));
+  ASSERT_TRUE(test_table->InsertTuple(tuple2, &rid1, txn));
+  bustub_instance->transaction_manager_->Commit(txn);
+  delete txn;
+  // A loser with its records on disk, which undo finds by their LSNs.
+  txn = bustub_instance->transaction_manager_->Begin();
+  ASSERT_TRUE(test_table->InsertTuple(tuple, &uncommitted_rid, txn));
+  ASSERT_TRUE(test_table->MarkDelete(rid1, txn));
+  bustub_instance->log_manager_->Flush(txn->GetPrevLSN());
+  delete txn;
+  delete test_table;
+  LOG_INFO("System crash before commit");
+  delete bustub_instance;
+
+  LOG_INFO("System restarted, second recovery");
+  bustub_instance = new BustubInstance("test.db");
+  bustub_instance->Recover();
+  txn = bustub_instance->transaction_manager_->Begin();
+  test_table = new TableHeap(bustub_instance->buffer_pool_manager_, bustub_instance->lock_manager_,
+                             bustub_instance->log_manager_, first_page_id);
+  Tuple old_tuple;
+  ASSERT_TRUE(test_table->GetTuple(rid, &old_tuple, txn));
+  EXPECT_EQ(old_tuple.GetValue(&schema, 1).CompareEquals(tuple1.GetValue(&schema, 1)), CmpBool::CmpTrue);
+  ASSERT_TRUE(test_table->GetTuple(rid1, &old_tuple, txn));
+  EXPECT_EQ(old_tuple.GetValue(&schema, 1).CompareEquals(tuple2.GetValue(&schema, 1)), CmpBool::CmpTrue);
+  EXPECT_FALSE(test_table->GetTuple(uncommitted_rid, &old_tuple, txn));
+  bustub_instance->transaction_manager_->Commit(txn);
+  delete txn;
+  delete test_table;
+  delete bustub_instance;
+}
 }  // namespace bustub
@@ -10,26 +10,58 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <atomic>
+#include <chrono>  // NOLINT
+#include <cstdio>
 #include <cstring>
+#include <iostream>
+#include <future>  // NOLINT
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>  // NOLINT
+#include <vector>
 
 #include "common/exception.h"
 #include "gtest/gtest.h"
+#include "storage/disk/async_io.h"
 #include "storage/disk/disk_manager.h"
+#include "storage/disk/lz4_codec.h"
 
 namespace bustub {
 
+static auto GetFileSizeOf(const std::string &file_name) -> int64_t {
+  struct stat stat_buf;
+  return stat(file_name.c_str(), &stat_buf) == 0 ? static_cast<int64_t>(stat_buf.st_size) : -1;
+}
+
+/** Remove a log: its control file and its first segments. */
+static void RemoveLog(const std::string &log_name) {
+  remove(log_name.c_str());
+  for (int segment = 0; segment < 16; ++segment) {
+    char suffix[16];
+    snprintf(suffix, sizeof(suffix), ".%06d", segment);
+    remove((log_name + suffix).c_str());
+  }
+}
+
 class DiskManagerTest : public ::testing::Test {
  protected:
   // This function is called before every test.
   void SetUp() override {
     remove("test.db");
-    remove("test.log");
+    RemoveLog("test.log");
   }
 
   // This function is called after every test.
   void TearDown() override {
     remove("test.db");
-    remove("test.log");
+    RemoveLog("test.log");
+    remove("test.fpm");
+    remove("test.pmap");
   };
 };
 
@@ -55,6 +87,177 @@ TEST_F(DiskManagerTest, ReadWritePageTest) {
   dm.ShutDown();
 }
 
+// NOLINTNEXTLINE
+TEST_F(DiskManagerTest, ConcurrentPageIOTest) {
+  const int num_threads = 8;
+  const int pages_per_thread = 64;
+  std::string db_file("test.db");
+  DiskManager dm(db_file);
+
+  // Every thread owns an interleaved set of pages and writes, then reads back, each of them.
+  std::vector<std::thread> threads;
+  for (int t = 0; t < num_threads; ++t) {
+    threads.emplace_back([&dm, t] {
+      char data[PAGE_SIZE];
+      char buf[PAGE_SIZE];
+      for (int i = 0; i < pages_per_thread; ++i) {
+        page_id_t page_id = i * num_threads + t;
+        std::memset(data, page_id % 251, sizeof(data));
+        dm.WritePage(page_id, data);
+        dm.ReadPage(page_id, buf);
+        EXPECT_EQ(std::memcmp(buf, data, sizeof(buf)), 0);
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  dm.Sync();
+
+  EXPECT_EQ(num_threads * pages_per_thread, dm.GetNumWrites());
+  EXPECT_EQ(num_threads * pages_per_thread, dm.GetNumPages());
+  char buf[PAGE_SIZE];
+  for (page_id_t page_id = 0; page_id < num_threads * pages_per_thread; ++page_id) {
+    dm.ReadPage(page_id, buf);
+    EXPECT_EQ(page_id % 251, static_cast<unsigned char>(buf[0]));
+    EXPECT_EQ(page_id % 251, static_cast<unsigned char>(buf[PAGE_SIZE - 1]));
+  }
+  // Past the end of the file a page reads as zeroes.
+  dm.ReadPage(num_threads * pages_per_thread + 3, buf);
+  EXPECT_EQ(0, buf[0]);
+
+  dm.ShutDown();
+}
+
+// NOLINTNEXTLINE
+TEST_F(DiskManagerTest, AsyncPageIOTest) {
+  const int num_pages = 256;
+  std::string db_file("test.db");
+  DiskManager dm(db_file);
+
+  // Keep every write in flight at once, then every read.
+  std::vector<char> data(num_pages * PAGE_SIZE);
+  for (int i = 0; i < num_pages; ++i) {
+    std::memset(data.data() + i * PAGE_SIZE, i % 251, PAGE_SIZE);
+  }
+  std::vector<std::future<bool>> writes;
+  for (page_id_t page_id = 0; page_id < num_pages; ++page_id) {
+    writes.push_back(dm.WritePagesAsync(page_id, data.data() + page_id * PAGE_SIZE, 1));
+  }
+  for (auto &write : writes) {
+    EXPECT_TRUE(write.get());
+  }
+  EXPECT_EQ(num_pages, dm.GetNumWrites());
+  EXPECT_EQ(num_pages, dm.GetNumPages());
+
+  std::vector<char> buf(num_pages * PAGE_SIZE);
+  std::atomic<int> reads_done{0};
+  for (page_id_t page_id = 0; page_id < num_pages; page_id += 2) {
+    dm.ReadPagesAsync(page_id, buf.data() + page_id * PAGE_SIZE, 2, [&reads_done](bool ok) {
+      EXPECT_TRUE(ok);
+      reads_done++;
+    });
+  }
+  // A run that reaches past the end of the file reads as zeroes there.
+  std::vector<char> tail(4 * PAGE_SIZE, 1);
+  EXPECT_TRUE(dm.ReadPagesAsync(num_pages - 2, tail.data(), 4).get());
+  EXPECT_EQ(0, std::memcmp(tail.data(), data.data() + (num_pages - 2) * PAGE_SIZE, 2 * PAGE_SIZE));
+  EXPECT_EQ(std::vector<char>(2 * PAGE_SIZE, 0), std::vector<char>(tail.begin() + 2 * PAGE_SIZE, tail.end()));
+
+  dm.ShutDown();
+  // ShutDown() waits for the requests in flight.
+  EXPECT_EQ(num_pages / 2, reads_done);
+  EXPECT_EQ(data, buf);
+}
+
+// NOLINTNEXTLINE
+TEST_F(DiskManagerTest, AsyncIOBackendTest) {
+  std::vector<std::unique_ptr<AsyncIO>> backends;
+  backends.push_back(MakeAsyncIO(8, false));
+  EXPECT_FALSE(backends.back()->IsIoUring());
+  auto io_uring = std::make_unique<IoUringIO>(8);
+  if (io_uring->IsOpen()) {
+    backends.push_back(std::move(io_uring));
+  }
+
+  for (auto &backend : backends) {
+    remove("test.db");
+    int fd = open("test.db", O_RDWR | O_CREAT, 0644);
+    ASSERT_GE(fd, 0);
+    // More requests than the queue depth, so that Submit() has to wait for free slots.
+    const int num_requests = 64;
+    std::vector<char> data(num_requests * PAGE_SIZE);
+    for (int i = 0; i < num_requests; ++i) {
+      std::memset(data.data() + i * PAGE_SIZE, 'a' + i % 26, PAGE_SIZE);
+    }
+    for (bool is_write : {true, false}) {
+      std::vector<char> buf(num_requests * PAGE_SIZE);
+      std::vector<std::promise<bool>> done(num_requests);
+      for (int i = 0; i < num_requests; ++i) {
+        auto request = std::make_unique<AsyncIORequest>();
+        request->is_write_ = is_write;
+        request->fd_ = fd;
+        request->data_ = (is_write ? data.data() : buf.data()) + i * PAGE_SIZE;
+        request->size_ = PAGE_SIZE;
+        request->offset_ = static_cast<off_t>(i) * PAGE_SIZE;
+        request->callback_ = [&done, i](bool ok) { done[i].set_value(ok); };
+        backend->Submit(std::move(request));
+      }
+      for (auto &promise : done) {
+        EXPECT_TRUE(promise.get_future().get());
+      }
+      if (!is_write) {
+        EXPECT_EQ(data, buf);
+      }
+    }
+    // A request the kernel rejects completes with false instead of leaving its waiter hanging.
+    std::promise<bool> failed;
+    auto request = std::make_unique<AsyncIORequest>();
+    request->is_write_ = false;
+    request->fd_ = -1;
+    request->data_ = data.data();
+    request->size_ = PAGE_SIZE;
+    request->offset_ = 0;
+    request->callback_ = [&failed](bool ok) { failed.set_value(ok); };
+    backend->Submit(std::move(request));
+    EXPECT_FALSE(failed.get_future().get());
+    close(fd);
+  }
+}
+
+// NOLINTNEXTLINE
+TEST_F(DiskManagerTest, LargeFileTest) {
+  char buf[PAGE_SIZE] = {0};
+  char data[PAGE_SIZE] = {0};
+  std::strncpy(data, "A test string.", sizeof(data));
+  // Far past 4 GB; the file stays sparse.
+  const page_id_t far_page_id = static_cast<page_id_t>((int64_t{5} << 30) / PAGE_SIZE) + 3;
+  std::string db_file("test.db");
+  {
+    DiskManager dm(db_file);
+    EXPECT_EQ(0, dm.GetNumPages());
+    dm.WritePage(far_page_id, data);
+    EXPECT_EQ(far_page_id + 1, dm.GetNumPages());
+    dm.ReadPage(far_page_id, buf);
+    EXPECT_EQ(std::memcmp(buf, data, sizeof(buf)), 0);
+    // A page below the end that was never written reads as zeroes.
+    dm.ReadPage(far_page_id - 1, buf);
+    EXPECT_EQ(0, buf[0]);
+
+    std::memset(buf, 0, sizeof(buf));
+    EXPECT_TRUE(dm.WritePagesAsync(far_page_id + 1, data, 1).get());
+    EXPECT_EQ(far_page_id + 2, dm.GetNumPages());
+    EXPECT_TRUE(dm.ReadPagesAsync(far_page_id + 1, buf, 1).get());
+    EXPECT_EQ(std::memcmp(buf, data, sizeof(buf)), 0);
+    dm.ShutDown();
+  }
+
+  // A new disk manager picks the size up from the file.
+  DiskManager dm(db_file);
+  EXPECT_EQ(far_page_id + 2, dm.GetNumPages());
+  dm.ShutDown();
+}
+
 // NOLINTNEXTLINE
 TEST_F(DiskManagerTest, ReadWriteLogTest) {
   char buf[16] = {0};
@@ -68,11 +271,336 @@ TEST_F(DiskManagerTest, ReadWriteLogTest) {
   dm.WriteLog(data, sizeof(data));
   dm.ReadLog(buf, sizeof(buf), 0);
   EXPECT_EQ(std::memcmp(buf, data, sizeof(buf)), 0);
+  // The log ends right after the entry.
+  EXPECT_FALSE(dm.ReadLog(buf, sizeof(buf), sizeof(data)));
+
+  dm.ShutDown();
+}
+
+// NOLINTNEXTLINE
+TEST_F(DiskManagerTest, LogSegmentsTest) {
+  DiskManagerOptions options;
+  options.log_segment_size_ = 1024;
+  std::vector<char> log(5300);
+  for (size_t i = 0; i < log.size(); ++i) {
+    log[i] = static_cast<char>(i * 7);
+  }
+  std::vector<char> buf(log.size());
+  const int64_t file_size = LogSegments::SEGMENT_HEADER_SIZE + 1024;
+  {
+    DiskManager dm("test.db", options);
+    // Most writes cross into the next segment.
+    for (int offset = 0; offset < 4900; offset += 700) {
+      dm.WriteLog(log.data() + offset, 700);
+    }
+    EXPECT_EQ(4900, dm.GetLogFileSize());
+    // Segments are allocated in full when they are started.
+    EXPECT_EQ(file_size, GetFileSizeOf("test.log.000000"));
+    EXPECT_EQ(file_size, GetFileSizeOf("test.log.000004"));
+    ASSERT_TRUE(dm.ReadLog(buf.data(), 4900, 0));
+    EXPECT_EQ(0, std::memcmp(buf.data(), log.data(), 4900));
+
+    // Only whole segments go; they become the segments after the last one, contents and all.
+    dm.TruncateLog(2500);
+    EXPECT_EQ(2048, dm.GetLogStartOffset());
+    EXPECT_FALSE(dm.ReadLog(buf.data(), 100, 1000));
+    ASSERT_TRUE(dm.ReadLog(buf.data(), 4900 - 2048, 2048));
+    EXPECT_EQ(0, std::memcmp(buf.data(), log.data() + 2048, 4900 - 2048));
+    EXPECT_EQ(-1, GetFileSizeOf("test.log.000000"));
+    EXPECT_EQ(-1, GetFileSizeOf("test.log.000001"));
+    EXPECT_EQ(file_size, GetFileSizeOf("test.log.000005"));
+    EXPECT_EQ(file_size, GetFileSizeOf("test.log.000006"));
+    dm.ShutDown();
+  }
 
+  // Reopened, the log has the same start and end; the full spares after it are not taken for log. It goes on into
+  // a spare segment.
+  {
+    DiskManager dm("test.db", options);
+    EXPECT_EQ(2048, dm.GetLogStartOffset());
+    EXPECT_EQ(4900, dm.GetLogFileSize());
+    EXPECT_TRUE(dm.WriteLog(log.data() + 4900, 400));
+    EXPECT_EQ(file_size, GetFileSizeOf("test.log.000005"));
+    ASSERT_TRUE(dm.ReadLog(buf.data(), 5300 - 2048, 2048));
+    EXPECT_EQ(0, std::memcmp(buf.data(), log.data() + 2048, 5300 - 2048));
+    dm.ShutDown();
+  }
+
+  // A torn append: the last write did not reach the disk in full, so its checksum does not match. The log ends
+  // where the segment before it is full, and the next write goes there.
+  int fd = open("test.log.000005", O_WRONLY);
+  ASSERT_GE(fd, 0);
+  char garbage = ~log[5200];
+  ASSERT_EQ(1, pwrite(fd, &garbage, 1, LogSegments::SEGMENT_HEADER_SIZE + 5200 - 5 * 1024));
+  close(fd);
+  DiskManager dm("test.db", options);
+  EXPECT_EQ(5 * 1024, dm.GetLogFileSize());
+  EXPECT_TRUE(dm.WriteLog(log.data() + 5 * 1024, 5300 - 5 * 1024));
+  ASSERT_TRUE(dm.ReadLog(buf.data(), 5300 - 2048, 2048));
+  EXPECT_EQ(0, std::memcmp(buf.data(), log.data() + 2048, 5300 - 2048));
   dm.ShutDown();
 }
 
+// NOLINTNEXTLINE
+TEST_F(DiskManagerTest, FreePageMapTest) {
+  FreePageMap map;
+  for (page_id_t page_id = 0; page_id < 1000; ++page_id) {
+    map.Free(page_id);
+  }
+  // Each stripe gets its own pages back, lowest first.
+  for (page_id_t expected = 0; expected < 600; expected += 2) {
+    EXPECT_EQ(expected, map.Take(0, 0, 2));
+    EXPECT_EQ(expected + 1, map.Take(0, 1, 2));
+  }
+  EXPECT_EQ(700, map.Take(700, 0, 2));
+  // A page freed below where the last search ended is found again.
+  map.Free(2);
+  map.Free(3);
+  EXPECT_EQ(2, map.Take(0, 0, 2));
+  EXPECT_EQ(3, map.Take(0, 1, 2));
+  EXPECT_EQ(600, map.Take(0, 0, 2));
+  EXPECT_EQ(INVALID_PAGE_ID, map.Take(2000, 0, 2));
+  EXPECT_EQ(601, map.Take(0, 1, 2));
+
+  // Stores run alongside Take() and Free(); the file always holds one complete map.
+  std::atomic<bool> stop{false};
+  std::thread storer([&] {
+    while (!stop) {
+      map.Store("test.fpm");
+    }
+  });
+  for (int round = 0; round < 200; ++round) {
+    page_id_t page_id = map.Take(0, 1, 2);
+    ASSERT_NE(INVALID_PAGE_ID, page_id);
+    map.Free(page_id);
+  }
+  stop = true;
+  storer.join();
+  map.Store("test.fpm");
+  FreePageMap loaded;
+  loaded.Load("test.fpm");
+  EXPECT_EQ(map.GetNumFree(), loaded.GetNumFree());
+  for (page_id_t page_id = 0; page_id < 1000; ++page_id) {
+    EXPECT_EQ(map.IsFree(page_id), loaded.IsFree(page_id));
+  }
+}
+
 // NOLINTNEXTLINE
 TEST_F(DiskManagerTest, ThrowBadFileTest) { EXPECT_THROW(DiskManager("dev/null\\/foo/bar/baz/test.db"), Exception); }
 
+/** A table page as the benchmark and tests see it: the first half holds similar tuples, the rest is empty. */
+static void FillTablePage(char *data, page_id_t page_id) {
+  std::memset(data, 0, PAGE_SIZE);
+  int pos = 0;
+  for (int slot = 0; pos < PAGE_SIZE / 2 - 64; ++slot) {
+    pos += snprintf(data + pos, 64, "id=%08d name=customer#%06d balance=%d;", page_id * 100 + slot, slot, slot * 7);
+  }
+}
+
+/** Inputs for the codec tests: empty, tiny, long runs, random bytes, a table page and a short-period pattern. */
+static auto Lz4TestInputs() -> std::vector<std::string> {
+  std::mt19937 rng(15445);
+  std::vector<std::string> inputs = {"", "a", "abcdefghijklm", std::string(100000, 'x')};
+  std::string random_bytes(PAGE_SIZE, 0);
+  for (auto &c : random_bytes) {
+    c = static_cast<char>(rng());
+  }
+  inputs.push_back(random_bytes);
+  std::string table_page(PAGE_SIZE, 0);
+  FillTablePage(table_page.data(), 3);
+  inputs.push_back(table_page);
+  std::string pattern;
+  for (int i = 0; i < 3000; ++i) {
+    pattern += static_cast<char>('a' + rng() % 3);
+  }
+  inputs.push_back(pattern);
+  return inputs;
+}
+
+// NOLINTNEXTLINE
+TEST(Lz4CodecTest, RoundTripTest) {
+  std::vector<std::string> inputs = Lz4TestInputs();
+  const std::string &random_bytes = inputs[4];
+  const std::string &table_page = inputs[5];
+
+  for (const auto &input : inputs) {
+    std::vector<char> compressed(input.size() + input.size() / 255 + 16);
+    size_t size = Lz4Codec::Compress(input.data(), input.size(), compressed.data(), compressed.size());
+    ASSERT_GT(size, 0);
+    std::string output(input.size(), 0);
+    EXPECT_EQ(static_cast<int64_t>(input.size()),
+              Lz4Codec::Decompress(compressed.data(), size, output.data(), output.size()));
+    EXPECT_EQ(input, output);
+  }
+  // Half-empty table pages shrink to a fraction.
+  std::vector<char> compressed(PAGE_SIZE);
+  EXPECT_LT(Lz4Codec::Compress(table_page.data(), PAGE_SIZE, compressed.data(), PAGE_SIZE), PAGE_SIZE / 4);
+  // Incompressible data does not fit into less room than it takes.
+  EXPECT_EQ(0, Lz4Codec::Compress(random_bytes.data(), PAGE_SIZE, compressed.data(), PAGE_SIZE));
+
+  // Malformed blocks are rejected rather than read or written out of bounds.
+  char out[64];
+  const char bad_offset[] = {0x10, 'a', 0x05, 0x00};
+  EXPECT_EQ(-1, Lz4Codec::Decompress(bad_offset, sizeof(bad_offset), out, sizeof(out)));
+  const char too_long[] = {static_cast<char>(0xf0), 0x7f, 'a'};
+  EXPECT_EQ(-1, Lz4Codec::Decompress(too_long, sizeof(too_long), out, sizeof(out)));
+}
+
+#ifdef BUSTUB_HAVE_LZ4
+// The two entry points of the reference implementation, declared here so that only its library has to be installed.
+extern "C" {
+auto LZ4_compress_default(const char *src, char *dst, int src_size, int dst_capacity) -> int;
+auto LZ4_decompress_safe(const char *src, char *dst, int compressed_size, int dst_capacity) -> int;
+}
+
+// NOLINTNEXTLINE
+TEST(Lz4CodecTest, ReferenceImplementationTest) {
+  for (const auto &input : Lz4TestInputs()) {
+    auto size = static_cast<int>(input.size());
+    std::vector<char> compressed(input.size() + input.size() / 255 + 16);
+    std::string output(input.size(), 0);
+
+    // Blocks of the reference compressor decompress with Lz4Codec...
+    auto capacity = static_cast<int>(compressed.size());
+    int reference_size = LZ4_compress_default(input.data(), compressed.data(), size, capacity);
+    ASSERT_GT(reference_size, 0);
+    EXPECT_EQ(size, Lz4Codec::Decompress(compressed.data(), reference_size, output.data(), output.size()));
+    EXPECT_EQ(input, output);
+
+    // ...and the other way round.
+    size_t codec_size = Lz4Codec::Compress(input.data(), input.size(), compressed.data(), compressed.size());
+    ASSERT_GT(codec_size, 0);
+    std::fill(output.begin(), output.end(), 0);
+    EXPECT_EQ(size, LZ4_decompress_safe(compressed.data(), output.data(), static_cast<int>(codec_size), size));
+    EXPECT_EQ(input, output);
+  }
+}
+#endif
+
+// NOLINTNEXTLINE
+TEST_F(DiskManagerTest, CompressedPagesTest) {
+  const int num_pages = 64;
+  DiskManagerOptions options;
+  options.compress_pages_ = true;
+  std::string db_file("test.db");
+  char data[PAGE_SIZE];
+  char buf[PAGE_SIZE];
+  {
+    DiskManager dm(db_file, options);
+    EXPECT_TRUE(dm.IsCompressed());
+    for (page_id_t page_id = 0; page_id < num_pages; ++page_id) {
+      FillTablePage(data, page_id);
+      dm.WritePage(page_id, data);
+    }
+    EXPECT_EQ(num_pages, dm.GetNumPages());
+    EXPECT_LE(dm.GetNumBytesWritten(), num_pages * PAGE_SIZE / 4);
+
+    // An incompressible page is stored as it is.
+    std::mt19937 rng(15445);
+    for (auto &c : data) {
+      c = static_cast<char>(rng());
+    }
+    dm.WritePage(num_pages, data);
+    dm.ReadPage(num_pages, buf);
+    EXPECT_EQ(0, std::memcmp(buf, data, PAGE_SIZE));
+
+    // Pages that were never written read as zeroes.
+    dm.ReadPage(num_pages + 10, buf);
+    EXPECT_EQ(0, buf[0]);
+    dm.DeallocatePage(num_pages);
+    dm.Sync();
+    dm.ShutDown();
+
+    // A write that fails is reported as failed, and not counted as written.
+    uint64_t bytes_written = dm.GetNumBytesWritten();
+    EXPECT_FALSE(dm.WritePagesAsync(0, data, 1).get());
+    EXPECT_EQ(bytes_written, dm.GetNumBytesWritten());
+  }
+
+  // The format sticks to the file, whatever the options say.
+  DiskManager dm(db_file);
+  EXPECT_TRUE(dm.IsCompressed());
+  for (page_id_t page_id = 0; page_id < num_pages; ++page_id) {
+    FillTablePage(data, page_id);
+    dm.ReadPage(page_id, buf);
+    EXPECT_EQ(0, std::memcmp(buf, data, PAGE_SIZE));
+  }
+  dm.ReadPage(num_pages, buf);
+  EXPECT_EQ(0, buf[0]);
+
+  // Rewriting pages reuses the extents that were freed, so the file does not grow.
+  int64_t file_size = GetFileSizeOf(db_file);
+  for (int round = 0; round < 4; ++round) {
+    for (page_id_t page_id = 0; page_id < num_pages; ++page_id) {
+      FillTablePage(data, page_id + round);
+      dm.WritePage(page_id, data);
+    }
+    dm.Sync();
+  }
+  EXPECT_LE(GetFileSizeOf(db_file), file_size + num_pages * PAGE_SIZE / 4);
+
+  // The small extents of neighbouring pages merge once freed, so incompressible pages fit where they were.
+  for (page_id_t page_id = 0; page_id < num_pages; ++page_id) {
+    dm.DeallocatePage(page_id);
+  }
+  dm.Sync();
+  file_size = GetFileSizeOf(db_file);
+  std::mt19937 rng(15445);
+  for (page_id_t page_id = 0; page_id < num_pages / 8; ++page_id) {
+    for (auto &c : data) {
+      c = static_cast<char>(rng());
+    }
+    dm.WritePage(page_id, data);
+    dm.ReadPage(page_id, buf);
+    EXPECT_EQ(0, std::memcmp(buf, data, PAGE_SIZE));
+  }
+  dm.Sync();
+  EXPECT_EQ(file_size, GetFileSizeOf(db_file));
+  dm.ShutDown();
+}
+
+/** Write a table of half-empty pages, then time a scan and random point lookups. */
+static void MeasureDiskManager(bool compress_pages) {
+  const int num_pages = 16384;
+  const int num_lookups = 20000;
+  remove("test.db");
+  remove("test.pmap");
+  DiskManagerOptions options;
+  options.compress_pages_ = compress_pages;
+  DiskManager dm("test.db", options);
+  char data[PAGE_SIZE];
+  for (page_id_t page_id = 0; page_id < num_pages; ++page_id) {
+    FillTablePage(data, page_id);
+    dm.WritePage(page_id, data);
+  }
+  dm.Sync();
+
+  auto start = std::chrono::steady_clock::now();
+  for (page_id_t page_id = 0; page_id < num_pages; ++page_id) {
+    dm.ReadPage(page_id, data);
+  }
+  auto scan = std::chrono::steady_clock::now() - start;
+  uint64_t scan_bytes = dm.GetNumBytesRead();
+
+  std::mt19937 rng(15445);
+  start = std::chrono::steady_clock::now();
+  for (int i = 0; i < num_lookups; ++i) {
+    dm.ReadPage(rng() % num_pages, data);
+  }
+  auto lookups = std::chrono::steady_clock::now() - start;
+
+  std::cout << (compress_pages ? "compressed" : "plain     ") << ": wrote " << dm.GetNumBytesWritten() / 1024
+            << " KB, scan read " << scan_bytes / 1024 << " KB in "
+            << std::chrono::duration_cast<std::chrono::microseconds>(scan).count() << " us, point lookup "
+            << std::chrono::duration_cast<std::chrono::nanoseconds>(lookups).count() / num_lookups << " ns"
+            << std::endl;
+  dm.ShutDown();
+}
+
+// NOLINTNEXTLINE
+TEST_F(DiskManagerTest, DISABLED_CompressionBenchmark) {
+  MeasureDiskManager(false);
+  MeasureDiskManager(true);
+}
+
 }  // namespace bustub
@@ -0,0 +1,173 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// page_guard_test.cpp
+//
+// Identification: test/storage/page_guard_test.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include <cstdio>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+#include "buffer/buffer_pool_manager_instance.h"
+#include "buffer/parallel_buffer_pool_manager.h"
+#include "gtest/gtest.h"
+#include "storage/page/page_guard.h"
+
+namespace bustub {
+
+// NOLINTNEXTLINE
+TEST(PageGuardTest, UnpinOnDropTest) {
+  const std::string db_name = "test.db";
+  const size_t buffer_pool_size = 5;
+
+  auto *disk_manager = new DiskManager(db_name);
+  auto *bpm = new BufferPoolManagerInstance(buffer_pool_size, disk_manager);
+
+  page_id_t page_id;
+  {
+    BasicPageGuard guard = bpm->NewPageGuarded(&page_id);
+    ASSERT_TRUE(guard.IsValid());
+    EXPECT_EQ(page_id, guard.PageId());
+    EXPECT_EQ(1, guard.GetPage()->GetPinCount());
+    EXPECT_FALSE(guard.GetPage()->IsDirty());
+  }
+  {
+    // The guard unpinned the page when it went out of scope.
+    BasicPageGuard guard = bpm->FetchPageBasic(page_id);
+    ASSERT_TRUE(guard.IsValid());
+    Page *page = guard.GetPage();
+    EXPECT_EQ(1, page->GetPinCount());
+    // Dropping twice only unpins once.
+    guard.Drop();
+    EXPECT_FALSE(guard.IsValid());
+    guard.Drop();
+    EXPECT_EQ(0, page->GetPinCount());
+  }
+
+  // A page the pool cannot provide gives an invalid guard.
+  page_id_t other_page_id;
+  std::vector<Page *> pinned;
+  for (size_t i = 0; i < buffer_pool_size; ++i) {
+    pinned.push_back(bpm->NewPage(&other_page_id));
+  }
+  EXPECT_FALSE(bpm->FetchPageRead(page_id).IsValid());
+  EXPECT_FALSE(bpm->NewPageGuarded(&other_page_id).IsValid());
+  for (auto *page : pinned) {
+    EXPECT_TRUE(bpm->UnpinPage(page->GetPageId(), false));
+  }
+
+  disk_manager->ShutDown();
+  remove("test.db");
+
+  delete bpm;
+  delete disk_manager;
+}
+
+// NOLINTNEXTLINE
+TEST(PageGuardTest, MoveTest) {
+  const std::string db_name = "test.db";
+  const size_t buffer_pool_size = 5;
+
+  auto *disk_manager = new DiskManager(db_name);
+  auto *bpm = new BufferPoolManagerInstance(buffer_pool_size, disk_manager);
+
+  page_id_t page_id0;
+  page_id_t page_id1;
+  BasicPageGuard guard0 = bpm->NewPageGuarded(&page_id0);
+  BasicPageGuard guard1 = bpm->NewPageGuarded(&page_id1);
+  Page *page0 = guard0.GetPage();
+  Page *page1 = guard1.GetPage();
+
+  // Moving hands the pin over without unpinning.
+  BasicPageGuard moved(std::move(guard0));
+  EXPECT_FALSE(guard0.IsValid());  // NOLINT
+  EXPECT_EQ(1, page0->GetPinCount());
+
+  // Move assignment releases the page the target held.
+  moved = std::move(guard1);
+  EXPECT_EQ(0, page0->GetPinCount());
+  EXPECT_EQ(1, page1->GetPinCount());
+  EXPECT_EQ(page_id1, moved.PageId());
+
+  // Upgrading takes the latch and keeps the single pin.
+  WritePageGuard write_guard = moved.UpgradeWrite();
+  EXPECT_FALSE(moved.IsValid());  // NOLINT
+  EXPECT_EQ(1, page1->GetPinCount());
+  WritePageGuard other_write_guard(std::move(write_guard));
+  other_write_guard.Drop();
+  EXPECT_EQ(0, page1->GetPinCount());
+
+  // The write latch was released, so readers can share the page.
+  {
+    ReadPageGuard read_guard0 = bpm->FetchPageRead(page_id1);
+    ReadPageGuard read_guard1 = bpm->FetchPageRead(page_id1);
+    EXPECT_EQ(2, page1->GetPinCount());
+    read_guard0 = std::move(read_guard1);
+    EXPECT_EQ(1, page1->GetPinCount());
+  }
+  EXPECT_EQ(0, page1->GetPinCount());
+
+  disk_manager->ShutDown();
+  remove("test.db");
+
+  delete bpm;
+  delete disk_manager;
+}
+
+// NOLINTNEXTLINE
+TEST(PageGuardTest, DirtyTest) {
+  const std::string db_name = "test.db";
+  const size_t buffer_pool_size = 2;
+  const size_t num_instances = 2;
+
+  auto *disk_manager = new DiskManager(db_name);
+  auto *bpm = new ParallelBufferPoolManager(num_instances, buffer_pool_size, disk_manager);
+
+  page_id_t page_id;
+  {
+    WritePageGuard guard = bpm->NewPageGuarded(&page_id).UpgradeWrite();
+    snprintf(guard.GetDataMut(), PAGE_SIZE, "Hello");
+  }
+  {
+    // Reading through a guard does not mark the page dirty.
+    ReadPageGuard guard = bpm->FetchPageRead(page_id);
+    EXPECT_EQ(0, strcmp(guard.GetData(), "Hello"));
+    EXPECT_TRUE(guard.GetPage()->IsDirty());
+    EXPECT_TRUE(bpm->FlushPage(page_id));
+    EXPECT_FALSE(guard.GetPage()->IsDirty());
+  }
+  {
+    BasicPageGuard guard = bpm->FetchPageBasic(page_id);
+    EXPECT_EQ(0, strcmp(guard.As<char>(), "Hello"));
+    guard.Drop();
+    guard = bpm->FetchPageBasic(page_id);
+    EXPECT_FALSE(guard.GetPage()->IsDirty());
+    std::strcpy(guard.AsMut<char>(), "World");  // NOLINT
+  }
+
+  // Evict the page by filling the pool, then read it back from disk.
+  page_id_t other_page_id;
+  for (size_t i = 0; i < buffer_pool_size * num_instances; ++i) {
+    EXPECT_TRUE(bpm->NewPageGuarded(&other_page_id).IsValid());
+  }
+  {
+    ReadPageGuard guard = bpm->FetchPageRead(page_id);
+    ASSERT_TRUE(guard.IsValid());
+    EXPECT_EQ(0, strcmp(guard.GetData(), "World"));
+  }
+
+  disk_manager->ShutDown();
+  remove("test.db");
+
+  delete bpm;
+  delete disk_manager;
+}
+
+}  // namespace bustub
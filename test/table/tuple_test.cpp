@@ -13,6 +13,7 @@
 #include <algorithm>
 #include <cstdio>
 #include <iostream>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -71,4 +72,52 @@ TEST(TupleTest, DISABLED_TableHeapTest) {
   delete disk_manager;
 }
 
+// NOLINTNEXTLINE
+TEST(TupleTest, TableHeapAccessStrategyTest) {
+  Column col1{"a", TypeId::VARCHAR, 20};
+  Column col2{"b", TypeId::SMALLINT};
+  Column col3{"c", TypeId::BIGINT};
+  std::vector<Column> cols{col1, col2, col3};
+  Schema schema{cols};
+  Tuple tuple = ConstructTuple(&schema);
+
+  auto *transaction = new Transaction(0);
+  auto *disk_manager = new DiskManager("test.db");
+  auto *buffer_pool_manager = new BufferPoolManagerInstance(16, disk_manager);
+  auto *lock_manager = new LockManager();
+  auto *log_manager = new LogManager(disk_manager);
+  auto *table = new TableHeap(buffer_pool_manager, lock_manager, log_manager, transaction);
+
+  // The table ends up much larger than the buffer pool.
+  const int num_tuples = 5000;
+  BufferAccessStrategy bulk_write(BufferAccessStrategyType::BULKWRITE);
+  for (int i = 0; i < num_tuples; ++i) {
+    RID rid;
+    ASSERT_TRUE(table->InsertTuple(tuple, &rid, transaction, &bulk_write));
+  }
+
+  int scanned = 0;
+  auto bulk_read = std::make_shared<BufferAccessStrategy>(BufferAccessStrategyType::BULKREAD);
+  for (auto itr = table->Begin(transaction, bulk_read); itr != table->End(); ++itr) {
+    scanned++;
+  }
+  EXPECT_EQ(num_tuples, scanned);
+
+  scanned = 0;
+  for (auto itr = table->Begin(transaction); itr != table->End(); ++itr) {
+    scanned++;
+  }
+  EXPECT_EQ(num_tuples, scanned);
+
+  disk_manager->ShutDown();
+  remove("test.db");
+  remove("test.log");
+  delete table;
+  delete log_manager;
+  delete lock_manager;
+  delete buffer_pool_manager;
+  delete disk_manager;
+  delete transaction;
+}
+
 }  // namespace bustub